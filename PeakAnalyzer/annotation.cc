@@ -0,0 +1,693 @@
+#include <algorithm>
+#include <limits>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "annotation.h"
+#include "interval_tree.h"
+#include "parallel.h"
+
+#include "easylogging++.h"
+
+namespace
+{
+	using bioscripts::annotation::CodingSegment;
+	using bioscripts::annotation::CodingSequence;
+	using bioscripts::annotation::PeakAnnotation;
+
+	/**
+	 * @brief  Access to the records of a gff::Records, for the annotation below.
+	 */
+	struct RecordsAccess
+	{
+		const bioscripts::gff::Records& records;
+
+		std::span<const bioscripts::gff::Record> recordsOn(const std::string& sequence_id) const
+		{
+			if (!records.contains(sequence_id)) {
+				return {};
+			}
+			return records.data(sequence_id);
+		}
+
+		static bioscripts::Range span(const bioscripts::gff::Record& record)
+		{
+			return record.span;
+		}
+
+		std::string transcriptId(const bioscripts::gff::Record& record) const
+		{
+			return bioscripts::gff::extractAttribute(record, "ID=CDS");
+		}
+	};
+
+	/**
+	 * @brief  Access to the records of a memory mapped gff::RecordImage, for the annotation below.
+	 */
+	struct ImageAccess
+	{
+		const bioscripts::gff::RecordImage& image;
+
+		std::span<const bioscripts::gff::RecordImage::Entry> recordsOn(const std::string& sequence_id) const
+		{
+			return image.recordsOn(sequence_id);
+		}
+
+		static bioscripts::Range span(const bioscripts::gff::RecordImage::Entry& entry)
+		{
+			return entry.span();
+		}
+
+		std::string transcriptId(const bioscripts::gff::RecordImage::Entry& entry) const
+		{
+			return std::string{ image.transcriptId(entry) };
+		}
+	};
+
+	/**
+	 * @brief  Collect all CDS records of the transcript of @a records[@a first], in 5' to 3' order.
+	 *
+	 * Same as gff::collectCodingSequenceRecords, but records of another type or strand are skipped while walking
+	 * instead of being filtered out of a copy of the whole sequence first.
+	 */
+	template <typename Access, typename Entry>
+	CodingSequence collectCodingSequence(const Access& access, std::span<const Entry> records, std::size_t first)
+	{
+		const auto& starting_record = records[first];
+		const auto starting_start = Access::span(starting_record).start;
+		const auto starting_record_id = bioscripts::Identifier<bioscripts::Transcript>{ access.transcriptId(starting_record) };
+		LOG(DEBUG) << "Collecting all CDS records of " << starting_record_id.to_string();
+
+		auto toSegment = [&access](const Entry& record) {
+			return CodingSegment{ .transcript_id = access.transcriptId(record), .span = Access::span(record) };
+		};
+		auto belongsToOtherChain = [&starting_record](const Entry& record) {
+			return record.type != starting_record.type || record.strand != starting_record.strand;
+		};
+
+		CodingSequence coding_sequence{ toSegment(starting_record) };
+		const auto start_looking_from = static_cast<std::size_t>(std::partition_point(std::begin(records), std::end(records), [starting_start](const Entry& record) {
+			return Access::span(record).start < starting_start;
+		}) - std::begin(records));
+
+		if (starting_record.strand == bioscripts::Strand::Sense) {
+			for (auto i = start_looking_from; i < records.size(); ++i) {
+				if (belongsToOtherChain(records[i]) || Access::span(records[i]).start <= starting_start) {
+					continue;
+				}
+				if (bioscripts::Identifier<bioscripts::Transcript>{ access.transcriptId(records[i]) } != starting_record_id) {
+					break;
+				}
+				coding_sequence.push_back(toSegment(records[i]));
+			}
+		}
+		else if (starting_record.strand == bioscripts::Strand::Antisense) {
+			for (auto i = start_looking_from; i-- > 0;) {
+				if (belongsToOtherChain(records[i])) {
+					continue;
+				}
+				if (bioscripts::Identifier<bioscripts::Transcript>{ access.transcriptId(records[i]) } != starting_record_id) {
+					break;
+				}
+				coding_sequence.push_back(toSegment(records[i]));
+			}
+			//Because the records should appear 5' to 3' direction and because these records
+			//are on the antisense (3' to 5') strand, they need to be reversed.
+			std::reverse(std::begin(coding_sequence), std::end(coding_sequence));
+		}
+		return coding_sequence;
+	}
+
+	constexpr std::size_t strand_count = static_cast<std::size_t>(bioscripts::Strand::Unknown) + 1;
+
+	/**
+	 * @brief  The records of the sequences that carry peaks, each sequence with an interval tree over its records.
+	 *
+	 * Only CDS records are indexed. When the annotation is restricted to one strand, every sequence gets a tree per
+	 * strand instead, so looking up the records of one strand does not wade through those of the other.
+	 */
+	template <typename Access>
+	struct IndexedRecords
+	{
+		IndexedRecords(const Access& access, const std::unordered_set<std::string>& sequence_ids, const bioscripts::annotation::Settings& settings) : access(access)
+		{
+			const auto by_strand = settings.strand != bioscripts::annotation::StrandFilter::Any;
+			for (const auto& sequence_id : sequence_ids) {
+				const auto records = access.recordsOn(sequence_id);
+				std::vector<bioscripts::Interval> intervals;
+				std::vector<std::vector<bioscripts::Interval>> strand_intervals(by_strand ? strand_count : 0);
+				intervals.reserve(records.size());
+				auto& sequence_trees = trees[sequence_id];
+				for (std::size_t i = 0; i < records.size(); ++i) {
+					if (records[i].type != bioscripts::gff::Record::Type::CDS) {
+						continue;
+					}
+					auto gene = bioscripts::Identifier<bioscripts::Gene>{ access.transcriptId(records[i]) }.gene();
+					if (!gene.empty()) {
+						sequence_trees.gene_records[std::move(gene)].push_back(i);
+					}
+					const auto interval = bioscripts::Interval{ .span = Access::span(records[i]), .id = i };
+					if (by_strand) {
+						strand_intervals[static_cast<std::size_t>(records[i].strand)].push_back(interval);
+					}
+					else {
+						intervals.push_back(interval);
+					}
+				}
+
+				sequence_trees.all = bioscripts::IntervalTree{ std::move(intervals) };
+				for (auto& strand_interval : strand_intervals) {
+					sequence_trees.by_strand.emplace_back(std::move(strand_interval));
+				}
+			}
+		}
+
+		/**
+		 * @brief  Indices of the records on @a sequence_id that overlap @a query, in the order of the records. If
+		 *		   @a strand is given, only records on that strand are looked up.
+		 */
+		std::vector<std::size_t> overlapping(const std::string& sequence_id, const bioscripts::Range& query, std::optional<bioscripts::Strand> strand) const
+		{
+			const auto* found = tree(sequence_id, strand);
+			return found == nullptr ? std::vector<std::size_t>{} : found->overlapping(query);
+		}
+
+		/**
+		 * @brief  The record on @a sequence_id closest to @a position and no further than @a max_distance from it,
+		 *		   see IntervalTree::nearest.
+		 */
+		std::optional<std::size_t> nearest(const std::string& sequence_id, bioscripts::Position position, bioscripts::Distance max_distance, std::optional<bioscripts::Strand> strand) const
+		{
+			const auto* found = tree(sequence_id, strand);
+			if (found == nullptr) {
+				return std::nullopt;
+			}
+			const auto neighbours = found->nearest(position, 1, max_distance);
+			if (neighbours.empty()) {
+				return std::nullopt;
+			}
+			return neighbours.front().id;
+		}
+
+		/**
+		 * @brief  Indices of the CDS records of @a gene on @a sequence_id, in the order of the records.
+		 */
+		std::span<const std::size_t> recordsOfGene(const std::string& sequence_id, const std::string& gene) const
+		{
+			const auto sequence_trees = trees.find(sequence_id);
+			if (sequence_trees == std::end(trees)) {
+				return {};
+			}
+			const auto gene_records = sequence_trees->second.gene_records.find(gene);
+			if (gene_records == std::end(sequence_trees->second.gene_records)) {
+				return {};
+			}
+			return gene_records->second;
+		}
+
+		const bioscripts::IntervalTree* tree(const std::string& sequence_id, std::optional<bioscripts::Strand> strand) const
+		{
+			const auto sequence_trees = trees.find(sequence_id);
+			if (sequence_trees == std::end(trees)) {
+				return nullptr;
+			}
+			return strand ? &sequence_trees->second.by_strand[static_cast<std::size_t>(*strand)] : &sequence_trees->second.all;
+		}
+
+		struct SequenceTrees
+		{
+			bioscripts::IntervalTree all; //Only built when no strand filter is set
+			std::vector<bioscripts::IntervalTree> by_strand;
+			std::unordered_map<std::string, std::vector<std::size_t>> gene_records; //The CDS records of every gene
+		};
+
+		const Access& access;
+		std::unordered_map<std::string, SequenceTrees> trees;
+	};
+
+	/**
+	 * @brief  The strand the records for @a peak have to be on, or an empty optional if any strand will do.
+	 */
+	std::optional<bioscripts::Strand> candidateStrand(const bioscripts::peak::Peak& peak, bioscripts::annotation::StrandFilter filter)
+	{
+		switch (filter) {
+		case bioscripts::annotation::StrandFilter::Same:
+			return peak.strand;
+		case bioscripts::annotation::StrandFilter::Opposite:
+			if (peak.strand == bioscripts::Strand::Unknown) {
+				return bioscripts::Strand::Unknown;
+			}
+			return peak.strand == bioscripts::Strand::Sense ? bioscripts::Strand::Antisense : bioscripts::Strand::Sense;
+		default:
+			return std::nullopt;
+		}
+	}
+
+	template <typename Access>
+	PeakAnnotation annotateWith(const bioscripts::peak::Peak& peak, const IndexedRecords<Access>& indexed_records, const bioscripts::annotation::Settings& settings)
+	{
+		const auto& access = indexed_records.access;
+		const auto midpoint = static_cast<bioscripts::Position>(bioscripts::peak::midpoint(peak));
+		const auto whole_span = settings.query == bioscripts::annotation::Query::Span;
+		const auto query = whole_span ? peak.span : bioscripts::Range{ midpoint, midpoint + 1 };
+		LOG(DEBUG) << "Analysing peak with gene ID: " << peak.associated_identifier.to_string() << ", midpoint at " << midpoint;
+
+		//A peak of unknown strand has no same or opposite strand to look on
+		const auto strand = candidateStrand(peak, settings.strand);
+		if (strand == bioscripts::Strand::Unknown) {
+			return {};
+		}
+
+		const auto records = access.recordsOn(peak.sequence_id);
+		auto isCodingSequenceOfPeakGene = [&](const auto& record) {
+			return record.type == bioscripts::gff::Record::Type::CDS
+				&& (!strand || record.strand == *strand)
+				&& peak.associated_identifier == bioscripts::Identifier<bioscripts::Transcript>{ access.transcriptId(record) };
+		};
+		auto coversEnough = [&](const auto& record) {
+			const auto span = Access::span(record);
+			const auto overlap_length = (std::min)(span.end, query.end) - (std::max)(span.start, query.start);
+			return overlap_length >= settings.minimum_overlap * bioscripts::length(query);
+		};
+
+		std::vector<std::size_t> records_under_the_peak;
+		bool gene_under_the_peak = false;
+		for (const auto i : indexed_records.overlapping(peak.sequence_id, query, strand)) {
+			if (!isCodingSequenceOfPeakGene(records[i])) {
+				continue;
+			}
+			gene_under_the_peak = true;
+			if (coversEnough(records[i])) {
+				records_under_the_peak.push_back(i);
+			}
+		}
+		LOG(DEBUG) << records_under_the_peak.size() << " GFF records found under the peak";
+
+		//A span may cover several CDS records of one transcript, but every transcript is reported once, starting
+		//from the first of them in 5' to 3' order like a midpoint on that record would
+		if (whole_span) {
+			std::unordered_map<std::string, std::size_t> first_record_of_transcript;
+			for (const auto i : records_under_the_peak) {
+				const auto [first, inserted] = first_record_of_transcript.try_emplace(access.transcriptId(records[i]), i);
+				if (!inserted && records[i].strand == bioscripts::Strand::Antisense) {
+					first->second = i;
+				}
+			}
+			records_under_the_peak.clear();
+			for (const auto& [transcript_id, i] : first_record_of_transcript) {
+				records_under_the_peak.push_back(i);
+			}
+			std::sort(std::begin(records_under_the_peak), std::end(records_under_the_peak));
+		}
+
+		//If no record of the gene lies underneath the peak, find the closest record of the gene instead. Only the
+		//records of that gene are looked at, so peaks without a gene or far from it do not scan the whole sequence.
+		if (!gene_under_the_peak && !peak.associated_identifier.gene().empty()) {
+			auto smallest_distance = (std::numeric_limits<bioscripts::Distance>::max)();
+			for (const auto i : indexed_records.recordsOfGene(peak.sequence_id, peak.associated_identifier.gene())) {
+				if (strand && records[i].strand != *strand) {
+					continue;
+				}
+				const auto distance_to_record = whole_span ? bioscripts::distance(query, Access::span(records[i])) : bioscripts::distance(midpoint, Access::span(records[i]));
+				if (distance_to_record < smallest_distance) {
+					smallest_distance = distance_to_record;
+					records_under_the_peak.assign(1, i);
+				}
+			}
+		}
+
+		//Without any CDS of its own gene in reach, the peak may take the CDS of whichever gene lies under or closest to
+		//its midpoint, but only within the distance cap
+		if (records_under_the_peak.empty() && settings.any_gene_within) {
+			records_under_the_peak = indexed_records.overlapping(peak.sequence_id, bioscripts::Range{ midpoint, midpoint + 1 }, strand);
+			if (records_under_the_peak.empty()) {
+				if (const auto nearest = indexed_records.nearest(peak.sequence_id, midpoint, *settings.any_gene_within, strand)) {
+					records_under_the_peak.push_back(*nearest);
+				}
+			}
+			LOG(DEBUG) << records_under_the_peak.size() << " GFF records of any gene found near the peak";
+		}
+
+		PeakAnnotation annotation;
+		for (const auto first : records_under_the_peak) {
+			annotation.push_back(collectCodingSequence(access, records, first));
+		}
+		return annotation;
+	}
+
+	/**
+	 * @brief  Index of the CDS record of @a segment among @a records, or an empty optional if it is not there.
+	 */
+	template <typename Access, typename Entry>
+	std::optional<std::size_t> findSegment(const Access& access, std::span<const Entry> records, const CodingSegment& segment)
+	{
+		auto i = static_cast<std::size_t>(std::partition_point(std::begin(records), std::end(records), [&segment](const Entry& record) {
+			return Access::span(record).start < segment.span.start;
+		}) - std::begin(records));
+		for (; i < records.size() && Access::span(records[i]).start == segment.span.start; ++i) {
+			if (records[i].type == bioscripts::gff::Record::Type::CDS && Access::span(records[i]) == segment.span && access.transcriptId(records[i]) == segment.transcript_id) {
+				return i;
+			}
+		}
+		return std::nullopt;
+	}
+
+	/**
+	 * @brief  Signed distance from @a position to the 5' end of the transcript of @a coding_sequence.
+	 *
+	 * Walks from the 5'-most collected record towards the 5' end over the records of the same transcript, the same
+	 * way collectCodingSequence walks towards the 3' end.
+	 */
+	template <typename Access, typename Entry>
+	std::optional<bioscripts::annotation::SignedDistance> distanceToFivePrime(const Access& access, std::span<const Entry> records, const CodingSequence& coding_sequence, bioscripts::Position position)
+	{
+		if (coding_sequence.empty()) {
+			return std::nullopt;
+		}
+		//The records of either strand are collected in increasing order, so the 5'-most record of an antisense
+		//transcript is the last one
+		auto first = findSegment(access, records, coding_sequence.front());
+		if (first && records[*first].strand != bioscripts::Strand::Sense) {
+			first = findSegment(access, records, coding_sequence.back());
+		}
+		if (!first) {
+			return std::nullopt;
+		}
+
+		const auto& starting_record = records[*first];
+		const auto starting_record_id = bioscripts::Identifier<bioscripts::Transcript>{ access.transcriptId(starting_record) };
+		auto belongsToOtherChain = [&starting_record](const Entry& record) {
+			return record.type != starting_record.type || record.strand != starting_record.strand;
+		};
+
+		if (starting_record.strand == bioscripts::Strand::Sense) {
+			auto five_prime_end = Access::span(starting_record).start;
+			for (auto i = *first; i-- > 0;) {
+				if (belongsToOtherChain(records[i])) {
+					continue;
+				}
+				if (bioscripts::Identifier<bioscripts::Transcript>{ access.transcriptId(records[i]) } != starting_record_id) {
+					break;
+				}
+				five_prime_end = (std::min)(five_prime_end, Access::span(records[i]).start);
+			}
+			return static_cast<bioscripts::annotation::SignedDistance>(position) - static_cast<bioscripts::annotation::SignedDistance>(five_prime_end);
+		}
+
+		auto five_prime_end = Access::span(starting_record).end - 1;
+		for (auto i = *first + 1; i < records.size(); ++i) {
+			if (belongsToOtherChain(records[i])) {
+				continue;
+			}
+			if (bioscripts::Identifier<bioscripts::Transcript>{ access.transcriptId(records[i]) } != starting_record_id) {
+				break;
+			}
+			five_prime_end = (std::max)(five_prime_end, Access::span(records[i]).end - 1);
+		}
+		return static_cast<bioscripts::annotation::SignedDistance>(five_prime_end) - static_cast<bioscripts::annotation::SignedDistance>(position);
+	}
+
+	template <typename Access>
+	std::vector<std::vector<std::optional<bioscripts::annotation::SignedDistance>>> distancesToFivePrime(const bioscripts::peak::Peaks& peaks, const std::vector<PeakAnnotation>& annotations, const Access& access)
+	{
+		std::vector<std::vector<std::optional<bioscripts::annotation::SignedDistance>>> distances;
+		distances.reserve(annotations.size());
+		std::size_t peak_index = 0;
+		for (const auto& peak : peaks) {
+			const auto midpoint = static_cast<bioscripts::Position>(bioscripts::peak::midpoint(peak));
+			const auto records = access.recordsOn(peak.sequence_id);
+			auto& peak_distances = distances.emplace_back();
+			for (const auto& coding_sequence : annotations[peak_index]) {
+				const auto distance = distanceToFivePrime(access, records, coding_sequence, midpoint);
+				if (!distance) {
+					LOG(WARNING) << "Could not find the 5' end of " << coding_sequence.front().transcript_id << " on sequence " << peak.sequence_id;
+				}
+				peak_distances.push_back(distance);
+			}
+			++peak_index;
+		}
+		return distances;
+	}
+
+	/**
+	 * @brief  The peaks of one or more samples reduced to one peak per distinct query key.
+	 */
+	struct UniqueQueries
+	{
+		std::vector<const bioscripts::peak::Peak*> peaks;
+		std::vector<std::vector<std::size_t>> query_of_peak; //Per sample and peak, the index of its query in peaks
+	};
+
+	UniqueQueries collapseDuplicates(const std::vector<const bioscripts::peak::Peaks*>& samples, const bioscripts::annotation::Settings& settings)
+	{
+		UniqueQueries queries;
+		std::unordered_map<std::string, std::size_t> query_of_key;
+		std::size_t total_nr_of_peaks = 0;
+		for (const auto* peaks : samples) {
+			auto& query_of_peak = queries.query_of_peak.emplace_back();
+			query_of_peak.reserve(peaks->size());
+			for (const auto& peak : *peaks) {
+				const auto [query, inserted] = query_of_key.try_emplace(bioscripts::annotation::queryKey(peak, settings), queries.peaks.size());
+				if (inserted) {
+					queries.peaks.push_back(&peak);
+				}
+				query_of_peak.push_back(query->second);
+			}
+			total_nr_of_peaks += peaks->size();
+		}
+		LOG(INFO) << queries.peaks.size() << " of " << total_nr_of_peaks << " peaks have distinct query keys";
+		return queries;
+	}
+
+	/**
+	 * @brief  Copy the annotation of every query to each of the peaks that share it.
+	 */
+	std::vector<PeakAnnotation> fanOut(const std::vector<std::size_t>& query_of_peak, const std::vector<PeakAnnotation>& query_annotations)
+	{
+		std::vector<PeakAnnotation> annotations;
+		annotations.reserve(query_of_peak.size());
+		for (const auto query : query_of_peak) {
+			annotations.push_back(query_annotations[query]);
+		}
+		return annotations;
+	}
+
+	template <typename Access>
+	std::vector<PeakAnnotation> annotateAll(const bioscripts::peak::Peaks& peaks, const IndexedRecords<Access>& indexed_records, const bioscripts::annotation::Settings& settings)
+	{
+		const auto queries = collapseDuplicates({ &peaks }, settings);
+		std::vector<PeakAnnotation> query_annotations;
+		query_annotations.reserve(queries.peaks.size());
+		const auto total_nr_of_queries = queries.peaks.size();
+		for (const auto* peak : queries.peaks) {
+			if (query_annotations.size() % 1000 == 0) {
+				LOG(DEBUG) << "Analysing peak " << query_annotations.size() << "\\" << total_nr_of_queries;
+			}
+			query_annotations.push_back(annotateWith(*peak, indexed_records, settings));
+		}
+		return fanOut(queries.query_of_peak.front(), query_annotations);
+	}
+
+	template <typename Access>
+	std::vector<std::vector<PeakAnnotation>> annotateSamples(const std::vector<bioscripts::peak::Peaks>& samples, const Access& access, const bioscripts::annotation::Settings& settings)
+	{
+		//Small enough for the batches of a single large sample to spread over all threads,
+		//large enough for handing out a batch to cost nothing next to annotating it
+		static constexpr std::size_t batch_size = 256;
+
+		std::vector<const bioscripts::peak::Peaks*> sample_peaks;
+		std::unordered_set<std::string> sequence_ids;
+		for (const auto& peaks : samples) {
+			sample_peaks.push_back(&peaks);
+			sequence_ids.merge(bioscripts::peak::sequenceIds(peaks));
+		}
+		const auto queries = collapseDuplicates(sample_peaks, settings);
+		const IndexedRecords indexed_records{ access, sequence_ids, settings };
+
+		std::vector<PeakAnnotation> query_annotations(queries.peaks.size());
+		const auto batch_count = (queries.peaks.size() + batch_size - 1) / batch_size;
+		helper::parallelFor(batch_count, [&](std::size_t batch) {
+			const auto batch_end = (std::min)((batch + 1) * batch_size, queries.peaks.size());
+			for (auto query = batch * batch_size; query < batch_end; ++query) {
+				query_annotations[query] = annotateWith(*queries.peaks[query], indexed_records, settings);
+			}
+		});
+
+		std::vector<std::vector<PeakAnnotation>> annotations;
+		annotations.reserve(samples.size());
+		for (const auto& query_of_peak : queries.query_of_peak) {
+			annotations.push_back(fanOut(query_of_peak, query_annotations));
+		}
+		return annotations;
+	}
+}
+
+namespace bioscripts
+{
+	namespace annotation
+	{
+		std::string queryKey(const peak::Peak& peak, const Settings& settings)
+		{
+			auto key = peak.sequence_id + '\t';
+			if (settings.query == Query::Span) {
+				key += std::to_string(peak.start()) + '\t' + std::to_string(peak.end());
+			}
+			else {
+				key += std::to_string(static_cast<Position>(peak::midpoint(peak)));
+			}
+			key += '\t' + peak.associated_identifier.gene();
+			if (settings.strand != StrandFilter::Any) {
+				key += peak.strand == Strand::Sense ? "\t+" : peak.strand == Strand::Antisense ? "\t-" : "\t.";
+			}
+			return key;
+		}
+
+		std::string describe(const Settings& settings)
+		{
+			auto description = settings.query == Query::Span ? "span\t" + std::to_string(settings.minimum_overlap) : std::string{ "midpoint" };
+			if (settings.strand == StrandFilter::Same) {
+				description += "\tsame strand";
+			}
+			else if (settings.strand == StrandFilter::Opposite) {
+				description += "\topposite strand";
+			}
+			if (settings.any_gene_within) {
+				description += "\tany gene within " + std::to_string(*settings.any_gene_within);
+			}
+			return description;
+		}
+
+		PeakAnnotation annotate(const peak::Peak& peak, const gff::Records& records, const Settings& settings)
+		{
+			const auto access = RecordsAccess{ records };
+			return annotateWith(peak, IndexedRecords{ access, { peak.sequence_id }, settings }, settings);
+		}
+
+		PeakAnnotation annotate(const peak::Peak& peak, const gff::RecordImage& image, const Settings& settings)
+		{
+			const auto access = ImageAccess{ image };
+			return annotateWith(peak, IndexedRecords{ access, { peak.sequence_id }, settings }, settings);
+		}
+
+		std::vector<PeakAnnotation> annotate(const peak::Peaks& peaks, const gff::Records& records, const Settings& settings)
+		{
+			const auto access = RecordsAccess{ records };
+			return annotateAll(peaks, IndexedRecords{ access, peak::sequenceIds(peaks), settings }, settings);
+		}
+
+		std::vector<PeakAnnotation> annotate(const peak::Peaks& peaks, const gff::RecordImage& image, const Settings& settings)
+		{
+			const auto access = ImageAccess{ image };
+			return annotateAll(peaks, IndexedRecords{ access, peak::sequenceIds(peaks), settings }, settings);
+		}
+
+		std::vector<std::vector<PeakAnnotation>> annotate(const std::vector<peak::Peaks>& samples, const gff::Records& records, const Settings& settings)
+		{
+			return annotateSamples(samples, RecordsAccess{ records }, settings);
+		}
+
+		std::vector<std::vector<PeakAnnotation>> annotate(const std::vector<peak::Peaks>& samples, const gff::RecordImage& image, const Settings& settings)
+		{
+			return annotateSamples(samples, ImageAccess{ image }, settings);
+		}
+
+		/**
+		 * @brief  The records behind a RecordsIndex. The index refers to the access, so both live here together.
+		 */
+		struct IndexState
+		{
+			IndexState(const gff::Records& records, const Settings& settings) : access{ records }, settings(settings), indexed_records{ access, allSequenceIds(records), settings }
+			{
+			}
+
+			static std::unordered_set<std::string> allSequenceIds(const gff::Records& records)
+			{
+				std::unordered_set<std::string> sequence_ids;
+				for (const auto& [sequence_id, sequence_records] : records) {
+					sequence_ids.insert(sequence_id);
+				}
+				return sequence_ids;
+			}
+
+			RecordsAccess access;
+			Settings settings;
+			IndexedRecords<RecordsAccess> indexed_records;
+		};
+
+		RecordsIndex::RecordsIndex(const gff::Records& records, const Settings& settings) : state(std::make_unique<IndexState>(records, settings))
+		{
+			LOG(INFO) << "Indexed " << size() << " GFF records";
+		}
+
+		RecordsIndex::~RecordsIndex() = default;
+
+		RecordsIndex::RecordsIndex(RecordsIndex&& other) noexcept = default;
+
+		RecordsIndex& RecordsIndex::operator=(RecordsIndex&& other) noexcept = default;
+
+		std::vector<PeakAnnotation> RecordsIndex::annotate(const peak::Peaks& peaks) const
+		{
+			return annotateAll(peaks, state->indexed_records, state->settings);
+		}
+
+		std::size_t RecordsIndex::size() const
+		{
+			return state->access.records.size();
+		}
+
+		std::vector<std::vector<std::optional<SignedDistance>>> fivePrimeDistances(const peak::Peaks& peaks, const std::vector<PeakAnnotation>& annotations, const gff::Records& records)
+		{
+			return distancesToFivePrime(peaks, annotations, RecordsAccess{ records });
+		}
+
+		std::vector<std::vector<std::optional<SignedDistance>>> fivePrimeDistances(const peak::Peaks& peaks, const std::vector<PeakAnnotation>& annotations, const gff::RecordImage& image)
+		{
+			return distancesToFivePrime(peaks, annotations, ImageAccess{ image });
+		}
+
+		void writeDistances(std::ostream& stream, const std::vector<PeakAnnotation>& annotations, const std::vector<std::vector<std::optional<SignedDistance>>>& distances)
+		{
+			std::size_t peak_id = 0;
+			for (std::size_t i = 0; i < annotations.size(); ++i) {
+				for (std::size_t transcript = 0; transcript < annotations[i].size(); ++transcript) {
+					stream << peak_id++ << "\t" << annotations[i][transcript].front().transcript_id << "\t";
+					if (const auto& distance = distances[i][transcript]) {
+						stream << *distance << "\n";
+					}
+					else {
+						stream << "-\n";
+					}
+				}
+			}
+		}
+
+		std::vector<TranscriptData> flatten(const std::vector<PeakAnnotation>& annotations)
+		{
+			std::vector<TranscriptData> data;
+			std::size_t peak_id = 0;
+			for (const auto& annotation : annotations) {
+				for (const auto& coding_sequence : annotation) {
+					for (const auto& segment : coding_sequence) {
+						data.push_back(TranscriptData{
+							.id = peak_id,
+							.start_pos = segment.span.start,
+							.end_pos = segment.span.end,
+							.transcript_id = segment.transcript_id
+							});
+					}
+					++peak_id;
+				}
+			}
+			return data;
+		}
+
+		void write(std::ostream& stream, const std::vector<TranscriptData>& data)
+		{
+			for (const auto& elem : data) {
+				stream << elem.id << "\t" << elem.transcript_id << "\t" << elem.start_pos << "\t" << elem.end_pos << "\n";
+			}
+		}
+	}
+}
@@ -0,0 +1,203 @@
+#ifndef BIOSCRIPTS_ANNOTATION_H
+#define BIOSCRIPTS_ANNOTATION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "gff.h"
+#include "peak.h"
+#include "record_image.h"
+#include "range.h"
+
+namespace bioscripts
+{
+	namespace annotation
+	{
+		/**
+		 * @brief  One row of the output: a CDS record of a transcript that a peak was assigned to.
+		 */
+		struct TranscriptData
+		{
+			std::size_t id;
+			std::size_t start_pos;
+			std::size_t end_pos;
+			std::string transcript_id;
+		};
+
+		/**
+		 * @brief  A single CDS record of an annotated transcript.
+		 */
+		struct CodingSegment
+		{
+			std::string transcript_id;
+			Range span;
+		};
+
+		/**
+		 * @brief  All CDS records of one transcript, in 5' to 3' order.
+		 */
+		using CodingSequence = std::vector<CodingSegment>;
+
+		/**
+		 * @brief  The transcripts a peak was assigned to, empty if none was found.
+		 */
+		using PeakAnnotation = std::vector<CodingSequence>;
+
+		/**
+		 * @brief  The part of a peak that is looked up among the CDS records.
+		 */
+		enum class Query : uint8_t
+		{
+			Midpoint,	//The single position at the centre of the peak
+			Span		//Every position of the peak
+		};
+
+		/**
+		 * @brief  The strand, relative to the peak's own, that CDS records have to be on.
+		 */
+		enum class StrandFilter : uint8_t
+		{
+			Any,
+			Same,
+			Opposite
+		};
+
+		/**
+		 * @brief  How peaks are matched to CDS records.
+		 */
+		struct Settings
+		{
+			Query query = Query::Midpoint;
+			double minimum_overlap = 0.0; //Fraction of the peak span a CDS record has to cover when matching the whole span
+			StrandFilter strand = StrandFilter::Any; //Peaks of unknown strand get no transcripts unless this is Any
+			std::optional<Distance> any_gene_within; //If set, peaks left without transcripts fall back to the CDS of any gene this close
+		};
+
+		/**
+		 * @brief  Distance from a peak to the 5' end of the coding sequence of a transcript, counted in the direction
+		 *		   the transcript is read: negative upstream of the 5' end, positive downstream of it.
+		 */
+		using SignedDistance = std::int64_t;
+
+		/**
+		 * @brief  The columns of @a peak that its annotation depends on: its sequence, its midpoint or its span, and
+		 *		   the gene it was called for. Peaks with the same key always get the same annotation.
+		 */
+		std::string queryKey(const peak::Peak& peak, const Settings& settings = {});
+
+		/**
+		 * @brief  A short text naming @a settings, which tells apart results obtained with different settings.
+		 */
+		std::string describe(const Settings& settings);
+
+		/**
+		 * @brief  Find the transcripts of the peak's gene whose CDS lies under the peak midpoint, or failing that the
+		 *		   closest CDS of that gene, and collect their complete coding sequences.
+		 *
+		 * When matching the whole span, every transcript with a CDS record covering at least the minimum fraction of
+		 * the peak is collected from the first such record onwards. The closest CDS is then only looked for if no CDS
+		 * of the gene overlaps the peak at all.
+		 * Peaks left without transcripts, e.g. because they carry no gene identifier, can fall back to the CDS records
+		 * of any gene under their midpoint, or else the single one closest to it within the distance cap.
+		 * Only reads @a records, so any number of peaks may be annotated against the same records concurrently.
+		 */
+		PeakAnnotation annotate(const peak::Peak& peak, const gff::Records& records, const Settings& settings = {});
+
+		/**
+		 * @brief  Annotate @a peak against the records of a shared @a image, with the same result as against the
+		 *		   records the image was built from.
+		 */
+		PeakAnnotation annotate(const peak::Peak& peak, const gff::RecordImage& image, const Settings& settings = {});
+
+		/**
+		 * @brief  Annotate every peak, looking up each distinct query key only once in an interval tree over the records
+		 *		   of its sequence.
+		 * @return  One annotation per peak, in the order of @a peaks.
+		 */
+		std::vector<PeakAnnotation> annotate(const peak::Peaks& peaks, const gff::Records& records, const Settings& settings = {});
+		std::vector<PeakAnnotation> annotate(const peak::Peaks& peaks, const gff::RecordImage& image, const Settings& settings = {});
+
+		/**
+		 * @brief  Annotate the peaks of several samples against the same records.
+		 *
+		 * Each distinct query key is looked up only once across all samples. The lookups are split into batches that are
+		 * annotated in parallel, which keeps every thread busy whether there are many small samples or a few large ones.
+		 * @return  The annotations of every sample, in the order of @a samples.
+		 */
+		std::vector<std::vector<PeakAnnotation>> annotate(const std::vector<peak::Peaks>& samples, const gff::Records& records, const Settings& settings = {});
+		std::vector<std::vector<PeakAnnotation>> annotate(const std::vector<peak::Peaks>& samples, const gff::RecordImage& image, const Settings& settings = {});
+
+		struct IndexState;
+
+		/**
+		 * @brief  The CDS records of every sequence indexed once, for annotating any number of peak sets against them.
+		 *
+		 * annotate() only indexes the sequences of the peaks it is given, and does so anew on every call. A process
+		 * answering many requests against the same records keeps one RecordsIndex instead, so every request only
+		 * costs its lookups.
+		 */
+		class RecordsIndex
+		{
+		public:
+			/**
+			 * @brief  Index @a records, which have to outlive the index, for annotating with @a settings.
+			 */
+			explicit RecordsIndex(const gff::Records& records, const Settings& settings = {});
+			~RecordsIndex();
+
+			RecordsIndex(RecordsIndex&& other) noexcept;
+			RecordsIndex& operator=(RecordsIndex&& other) noexcept;
+			RecordsIndex(const RecordsIndex&) = delete;
+			RecordsIndex& operator=(const RecordsIndex&) = delete;
+
+			/**
+			 * @brief  Annotate every peak, with the same result as annotate() against the records with the same settings.
+			 *		   Only reads the index, so any number of peak sets may be annotated concurrently.
+			 * @return  One annotation per peak, in the order of @a peaks.
+			 */
+			std::vector<PeakAnnotation> annotate(const peak::Peaks& peaks) const;
+
+			/**
+			 * @brief  Return the number of indexed records.
+			 */
+			std::size_t size() const;
+
+		private:
+			std::unique_ptr<IndexState> state;
+		};
+
+		/**
+		 * @brief  The signed distance from the midpoint of every peak to the 5' end of each transcript in its annotation.
+		 *
+		 * The annotation of a peak may start in the middle of a coding sequence, so the first CDS record of every
+		 * transcript is looked up in the records the annotations were made with.
+		 * @return  Per peak, one distance per transcript in its annotation, empty where the 5' end was not found.
+		 */
+		std::vector<std::vector<std::optional<SignedDistance>>> fivePrimeDistances(const peak::Peaks& peaks, const std::vector<PeakAnnotation>& annotations, const gff::Records& records);
+		std::vector<std::vector<std::optional<SignedDistance>>> fivePrimeDistances(const peak::Peaks& peaks, const std::vector<PeakAnnotation>& annotations, const gff::RecordImage& image);
+
+		/**
+		 * @brief  Write the distances as tab-delimited rows of the peak id used by flatten(), the transcript and the
+		 *		   signed distance, or "-" where the 5' end of the transcript was not found.
+		 */
+		void writeDistances(std::ostream& stream, const std::vector<PeakAnnotation>& annotations, const std::vector<std::vector<std::optional<SignedDistance>>>& distances);
+
+		/**
+		 * @brief  Turn the annotations into output rows. Every transcript found for a peak gets its own id, and
+		 *		   peaks without any transcript do not use one up.
+		 */
+		std::vector<TranscriptData> flatten(const std::vector<PeakAnnotation>& annotations);
+
+		/**
+		 * @brief  Write @a data as the tab-delimited rows of transcript_data.txt.
+		 */
+		void write(std::ostream& stream, const std::vector<TranscriptData>& data);
+	}
+}
+
+#endif // !BIOSCRIPTS_ANNOTATION_H
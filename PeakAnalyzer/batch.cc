@@ -0,0 +1,75 @@
+#include <set>
+#include <string>
+
+#include "batch.h"
+#include "helpers.h"
+#include "input.h"
+
+#include "easylogging++.h"
+
+namespace bioscripts
+{
+	namespace batch
+	{
+		std::optional<std::vector<Sample>> readManifest(const std::filesystem::path& manifest_file)
+		{
+			io::LineReader f{ manifest_file };
+			if (!f.is_open()) {
+				LOG(ERROR) << "Could not open manifest " << manifest_file.string();
+				return std::nullopt;
+			}
+
+			const auto manifest_directory = io::isStdin(manifest_file) ? std::filesystem::path{} : manifest_file.parent_path();
+			std::vector<Sample> samples;
+			std::set<std::filesystem::path> output_files;
+			std::string line;
+			while (f.getline(line)) {
+				if (line.empty() || line.starts_with('#')) {
+					continue;
+				}
+
+				const auto tokens = helper::tokenise(line, '\t');
+				if (tokens.empty()) {
+					continue;
+				}
+				const std::filesystem::path listed_peaks_file{ tokens[0] };
+				if (io::isStdin(listed_peaks_file)) {
+					LOG(ERROR) << "The peak files of a batch cannot be read from stdin";
+					return std::nullopt;
+				}
+
+				Sample sample;
+				sample.peaks_file = listed_peaks_file.is_absolute() ? listed_peaks_file : manifest_directory / listed_peaks_file;
+				if (tokens.size() > 1 && !tokens[1].empty()) {
+					sample.output_file = tokens[1];
+				}
+				else {
+					//Only the last extension is dropped, and a compression extension before it, so "rep1.day2.txt.gz"
+					//becomes "rep1.day2"
+					auto name = listed_peaks_file.filename();
+					if (name.extension() == ".gz" || name.extension() == ".bgz") {
+						name = name.stem();
+					}
+					sample.output_file = name.stem().string() + ".transcript_data.txt";
+				}
+
+				std::error_code error;
+				if (!std::filesystem::is_regular_file(sample.peaks_file, error)) {
+					LOG(ERROR) << "Peak file " << sample.peaks_file.string() << " listed in " << manifest_file.string() << " does not exist";
+					return std::nullopt;
+				}
+				if (!output_files.insert(std::filesystem::absolute(sample.output_file, error).lexically_normal()).second) {
+					LOG(ERROR) << "More than one sample in " << manifest_file.string() << " would be written to " << sample.output_file.string();
+					return std::nullopt;
+				}
+				samples.push_back(std::move(sample));
+			}
+
+			if (samples.empty()) {
+				LOG(ERROR) << "Manifest " << manifest_file.string() << " does not list any peak files";
+				return std::nullopt;
+			}
+			return samples;
+		}
+	}
+}
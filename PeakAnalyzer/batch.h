@@ -0,0 +1,33 @@
+#ifndef BIOSCRIPTS_BATCH_H
+#define BIOSCRIPTS_BATCH_H
+
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+namespace bioscripts
+{
+	namespace batch
+	{
+		struct Sample
+		{
+			std::filesystem::path peaks_file;
+			std::filesystem::path output_file;
+		};
+
+		/**
+		 * @brief  Read a manifest listing one sample per line: the path of its peak file, optionally followed by a tab and
+		 *		   the path of its output file.
+		 *
+		 * Relative peak file paths are relative to the manifest. A sample without an output path is written to
+		 * "<peak file name>.transcript_data.txt" in the working directory, where the peak file name loses its extension
+		 * and a .gz or .bgz extension before that.
+		 * Empty lines and lines starting with '#' are ignored.
+		 * @return  The samples, or an empty optional if the manifest cannot be read, lists a peak file that does not exist
+		 *			or lists two samples with the same output file.
+		 */
+		std::optional<std::vector<Sample>> readManifest(const std::filesystem::path& manifest_file);
+	}
+}
+
+#endif // !BIOSCRIPTS_BATCH_H
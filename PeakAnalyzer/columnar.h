@@ -0,0 +1,300 @@
+#ifndef BIOSCRIPTS_COLUMNAR_H
+#define BIOSCRIPTS_COLUMNAR_H
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*
+ * Reader of the binary columnar form of transcript_data.txt. It only depends on the standard library, so it can be
+ * copied into other projects on its own.
+ *
+ * Layout, in the byte order of the machine that wrote the file and with every column 8-byte aligned:
+ *	FileHeader
+ *	peak_id			uint64_t[row_count]
+ *	start_pos		uint64_t[row_count]
+ *	end_pos			uint64_t[row_count]
+ *	transcript_id	uint32_t[row_count], each an index into the dictionary
+ *	dictionary		uint64_t[dictionary_size + 1] offsets into the string pool, entry i spanning [offset i, offset i + 1)
+ *	string pool		the transcript identifiers, concatenated without separators
+ */
+namespace bioscripts
+{
+	namespace columnar
+	{
+		inline constexpr char file_magic[8] = { 'P', 'A', 'C', 'O', 'L', 'S', '\0', '\1' };
+		inline constexpr uint32_t byte_order_mark = 0x01020304;
+
+		struct FileHeader
+		{
+			char magic[8];
+			uint32_t byte_order;
+			uint32_t reserved;
+			uint64_t row_count;
+			uint64_t dictionary_size;
+			uint64_t peak_id_offset;
+			uint64_t start_pos_offset;
+			uint64_t end_pos_offset;
+			uint64_t transcript_id_offset;
+			uint64_t dictionary_offset;
+			uint64_t strings_offset;
+			uint64_t file_size;
+		};
+
+		static_assert(std::is_trivially_copyable_v<FileHeader> && std::is_standard_layout_v<FileHeader> && sizeof(FileHeader) % 8 == 0);
+
+		/**
+		 * @brief  The columns of a binary output read in place from memory. Only the header and the dictionary offsets
+		 *		   are checked, nothing is parsed or copied.
+		 */
+		class Columns
+		{
+		public:
+			/**
+			 * @brief  View the @a size bytes at @a data as columns. @a data must be 8-byte aligned and outlive the view.
+			 * @return  The columns, or an empty optional if the bytes are not a complete binary output of this machine or
+			 *		    a dictionary entry does not lie within the string pool.
+			 */
+			static std::optional<Columns> view(const char* data, std::size_t size)
+			{
+				FileHeader header;
+				if (data == nullptr || size < sizeof(header) || reinterpret_cast<std::uintptr_t>(data) % alignof(uint64_t) != 0) {
+					return std::nullopt;
+				}
+				std::memcpy(&header, data, sizeof(header));
+				if (std::memcmp(header.magic, file_magic, sizeof(file_magic)) != 0 || header.byte_order != byte_order_mark || header.file_size != size) {
+					return std::nullopt;
+				}
+
+				auto fits = [&header](uint64_t offset, uint64_t count, uint64_t width) {
+					return offset % width == 0 && offset <= header.file_size && count <= (header.file_size - offset) / width;
+				};
+				if (!fits(header.peak_id_offset, header.row_count, sizeof(uint64_t))
+					|| !fits(header.start_pos_offset, header.row_count, sizeof(uint64_t))
+					|| !fits(header.end_pos_offset, header.row_count, sizeof(uint64_t))
+					|| !fits(header.transcript_id_offset, header.row_count, sizeof(uint32_t))
+					|| header.dictionary_size == UINT64_MAX
+					|| !fits(header.dictionary_offset, header.dictionary_size + 1, sizeof(uint64_t))
+					|| header.strings_offset > header.file_size) {
+					return std::nullopt;
+				}
+
+				Columns columns;
+				columns.peak_ids = { reinterpret_cast<const uint64_t*>(data + header.peak_id_offset), header.row_count };
+				columns.start_positions = { reinterpret_cast<const uint64_t*>(data + header.start_pos_offset), header.row_count };
+				columns.end_positions = { reinterpret_cast<const uint64_t*>(data + header.end_pos_offset), header.row_count };
+				columns.transcript_codes = { reinterpret_cast<const uint32_t*>(data + header.transcript_id_offset), header.row_count };
+				columns.dictionary = { reinterpret_cast<const uint64_t*>(data + header.dictionary_offset), header.dictionary_size + 1 };
+				columns.strings = { data + header.strings_offset, header.file_size - header.strings_offset };
+				//Every identifier has to lie within the string pool, so the offsets may never decrease nor run past it
+				for (std::size_t code = 0; code < header.dictionary_size; ++code) {
+					if (columns.dictionary[code] > columns.dictionary[code + 1]) {
+						return std::nullopt;
+					}
+				}
+				if (columns.dictionary.back() > columns.strings.size()) {
+					return std::nullopt;
+				}
+				return columns;
+			}
+
+			std::size_t size() const
+			{
+				return peak_ids.size();
+			}
+
+			std::span<const uint64_t> peakIds() const
+			{
+				return peak_ids;
+			}
+
+			std::span<const uint64_t> startPositions() const
+			{
+				return start_positions;
+			}
+
+			std::span<const uint64_t> endPositions() const
+			{
+				return end_positions;
+			}
+
+			/**
+			 * @brief  The dictionary codes of the transcript identifiers, see transcriptName().
+			 */
+			std::span<const uint32_t> transcriptCodes() const
+			{
+				return transcript_codes;
+			}
+
+			std::size_t dictionarySize() const
+			{
+				return dictionary.size() - 1;
+			}
+
+			/**
+			 * @brief  The transcript identifier with dictionary code @a code, empty if there is no such code.
+			 */
+			std::string_view transcriptName(uint32_t code) const
+			{
+				if (code >= dictionarySize() || dictionary[code] > dictionary[code + 1] || dictionary[code + 1] > strings.size()) {
+					return {};
+				}
+				return strings.substr(dictionary[code], dictionary[code + 1] - dictionary[code]);
+			}
+
+			std::string_view transcriptId(std::size_t row) const
+			{
+				return transcriptName(transcript_codes[row]);
+			}
+
+		private:
+			Columns() = default;
+
+			std::span<const uint64_t> peak_ids;
+			std::span<const uint64_t> start_positions;
+			std::span<const uint64_t> end_positions;
+			std::span<const uint32_t> transcript_codes;
+			std::span<const uint64_t> dictionary;
+			std::string_view strings;
+		};
+
+		/**
+		 * @brief  A binary output file mapped into memory and viewed as columns, unmapped when it goes out of scope.
+		 */
+		class MappedColumns
+		{
+		public:
+			/**
+			 * @brief  Map @a path read-only.
+			 * @return  The columns, or an empty optional if the file cannot be mapped or is not a binary output.
+			 */
+			static std::optional<MappedColumns> open(const std::filesystem::path& path)
+			{
+				MappedColumns mapped;
+#ifdef _WIN32
+				const auto file = ::CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+				if (file == INVALID_HANDLE_VALUE) {
+					return std::nullopt;
+				}
+				LARGE_INTEGER file_size;
+				if (::GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0) {
+					const auto mapping = ::CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+					if (mapping != nullptr) {
+						mapped.data = static_cast<const char*>(::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+						mapped.size = mapped.data == nullptr ? 0 : static_cast<std::size_t>(file_size.QuadPart);
+						::CloseHandle(mapping);
+					}
+				}
+				::CloseHandle(file);
+#else
+				const auto fd = ::open(path.c_str(), O_RDONLY);
+				if (fd < 0) {
+					return std::nullopt;
+				}
+				struct stat file_status;
+				if (::fstat(fd, &file_status) == 0 && file_status.st_size > 0) {
+					auto* view = ::mmap(nullptr, static_cast<std::size_t>(file_status.st_size), PROT_READ, MAP_SHARED, fd, 0);
+					if (view != MAP_FAILED) {
+						mapped.data = static_cast<const char*>(view);
+						mapped.size = static_cast<std::size_t>(file_status.st_size);
+					}
+				}
+				::close(fd);
+#endif
+				mapped.columns = Columns::view(mapped.data, mapped.size);
+				if (!mapped.columns) {
+					return std::nullopt;
+				}
+				return mapped;
+			}
+
+			~MappedColumns()
+			{
+				unmap();
+			}
+
+			MappedColumns(MappedColumns&& other) noexcept
+				: data(std::exchange(other.data, nullptr)), size(std::exchange(other.size, 0)), columns(std::exchange(other.columns, std::nullopt))
+			{
+			}
+
+			MappedColumns& operator=(MappedColumns&& other) noexcept
+			{
+				if (this != &other) {
+					unmap();
+					data = std::exchange(other.data, nullptr);
+					size = std::exchange(other.size, 0);
+					columns = std::exchange(other.columns, std::nullopt);
+				}
+				return *this;
+			}
+
+			MappedColumns(const MappedColumns&) = delete;
+			MappedColumns& operator=(const MappedColumns&) = delete;
+
+			const Columns& operator*() const
+			{
+				return *columns;
+			}
+
+			const Columns* operator->() const
+			{
+				return &*columns;
+			}
+
+		private:
+			MappedColumns() = default;
+
+			void unmap()
+			{
+				if (data == nullptr) {
+					return;
+				}
+#ifdef _WIN32
+				::UnmapViewOfFile(data);
+#else
+				::munmap(const_cast<char*>(data), size);
+#endif
+				data = nullptr;
+				size = 0;
+			}
+
+			const char* data = nullptr;
+			std::size_t size = 0;
+			std::optional<Columns> columns;
+		};
+
+		/**
+		 * @brief  Write @a columns as the tab-delimited rows of transcript_data.txt.
+		 */
+		inline void writeTsv(std::ostream& stream, const Columns& columns)
+		{
+			const auto peak_ids = columns.peakIds();
+			const auto start_positions = columns.startPositions();
+			const auto end_positions = columns.endPositions();
+			for (std::size_t row = 0; row < columns.size(); ++row) {
+				stream << peak_ids[row] << "\t" << columns.transcriptId(row) << "\t" << start_positions[row] << "\t" << end_positions[row] << "\n";
+			}
+		}
+	}
+}
+
+#endif // !BIOSCRIPTS_COLUMNAR_H
@@ -0,0 +1,100 @@
+#include <fstream>
+#include <string>
+#include <unordered_map>
+
+#include "columnar_writer.h"
+
+#include "easylogging++.h"
+
+namespace
+{
+	/**
+	 * @brief  Offset of the column that follows @a count values of @a width bytes at @a offset, kept 8-byte aligned.
+	 */
+	uint64_t nextColumn(uint64_t offset, std::size_t count, std::size_t width)
+	{
+		const auto end = offset + count * width;
+		return (end + 7) / 8 * 8;
+	}
+
+	template <typename T>
+	void writeColumn(std::ofstream& f, const std::vector<T>& column, uint64_t next_column_offset)
+	{
+		f.write(reinterpret_cast<const char*>(column.data()), column.size() * sizeof(T));
+		const auto padding = static_cast<std::streamoff>(next_column_offset) - f.tellp();
+		for (std::streamoff i = 0; i < padding; ++i) {
+			f.put('\0');
+		}
+	}
+}
+
+namespace bioscripts
+{
+	namespace columnar
+	{
+		bool write(const std::filesystem::path& binary_file, const std::vector<annotation::TranscriptData>& data)
+		{
+			std::vector<uint64_t> peak_ids;
+			std::vector<uint64_t> start_positions;
+			std::vector<uint64_t> end_positions;
+			std::vector<uint32_t> transcript_codes;
+			std::vector<uint64_t> dictionary{ 0 };
+			std::string strings;
+			std::unordered_map<std::string_view, uint32_t> codes;
+			peak_ids.reserve(data.size());
+			start_positions.reserve(data.size());
+			end_positions.reserve(data.size());
+			transcript_codes.reserve(data.size());
+			for (const auto& row : data) {
+				//The rows outlive the map, so their identifiers can serve as its keys
+				const auto [code, inserted] = codes.try_emplace(row.transcript_id, static_cast<uint32_t>(codes.size()));
+				if (inserted) {
+					strings += row.transcript_id;
+					dictionary.push_back(strings.size());
+				}
+				peak_ids.push_back(row.id);
+				start_positions.push_back(row.start_pos);
+				end_positions.push_back(row.end_pos);
+				transcript_codes.push_back(code->second);
+			}
+
+			FileHeader header = {};
+			std::copy(std::begin(file_magic), std::end(file_magic), header.magic);
+			header.byte_order = byte_order_mark;
+			header.row_count = data.size();
+			header.dictionary_size = dictionary.size() - 1;
+			header.peak_id_offset = sizeof(FileHeader);
+			header.start_pos_offset = nextColumn(header.peak_id_offset, data.size(), sizeof(uint64_t));
+			header.end_pos_offset = nextColumn(header.start_pos_offset, data.size(), sizeof(uint64_t));
+			header.transcript_id_offset = nextColumn(header.end_pos_offset, data.size(), sizeof(uint64_t));
+			header.dictionary_offset = nextColumn(header.transcript_id_offset, data.size(), sizeof(uint32_t));
+			header.strings_offset = header.dictionary_offset + dictionary.size() * sizeof(uint64_t);
+			header.file_size = header.strings_offset + strings.size();
+
+			std::ofstream f{ binary_file, std::ios::binary | std::ios::trunc };
+			if (!f.is_open()) {
+				LOG(ERROR) << "Could not write " << binary_file.string();
+				return false;
+			}
+			f.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			writeColumn(f, peak_ids, header.start_pos_offset);
+			writeColumn(f, start_positions, header.end_pos_offset);
+			writeColumn(f, end_positions, header.transcript_id_offset);
+			writeColumn(f, transcript_codes, header.dictionary_offset);
+			writeColumn(f, dictionary, header.strings_offset);
+			f.write(strings.data(), strings.size());
+			if (!f) {
+				LOG(ERROR) << "Could not write " << binary_file.string();
+				return false;
+			}
+			LOG(INFO) << "Wrote " << data.size() << " rows with " << header.dictionary_size << " distinct transcript identifiers to " << binary_file.string();
+			return true;
+		}
+
+		std::filesystem::path binaryPath(const std::filesystem::path& output_file)
+		{
+			auto binary_file = output_file;
+			return binary_file.replace_extension(".bin");
+		}
+	}
+}
@@ -0,0 +1,29 @@
+#ifndef BIOSCRIPTS_COLUMNAR_WRITER_H
+#define BIOSCRIPTS_COLUMNAR_WRITER_H
+
+#include <filesystem>
+#include <vector>
+
+#include "annotation.h"
+#include "columnar.h"
+
+namespace bioscripts
+{
+	namespace columnar
+	{
+		/**
+		 * @brief  Write @a data in the binary columnar layout described in columnar.h.
+		 *
+		 * Transcript identifiers are numbered in the order they first appear, so every identifier is stored once however
+		 * many rows refer to it.
+		 */
+		bool write(const std::filesystem::path& binary_file, const std::vector<annotation::TranscriptData>& data);
+
+		/**
+		 * @brief  Location of the binary form of @a output_file.
+		 */
+		std::filesystem::path binaryPath(const std::filesystem::path& output_file);
+	}
+}
+
+#endif // !BIOSCRIPTS_COLUMNAR_WRITER_H
@@ -0,0 +1,289 @@
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+#include <map>
+#include <numeric>
+#include <string>
+#include <tuple>
+
+#include "context.h"
+#include "helpers.h"
+#include "parallel.h"
+#include "range_set.h"
+
+#include "easylogging++.h"
+
+namespace
+{
+	using bioscripts::context::Feature;
+
+	constexpr std::size_t classify_chunk_size = std::size_t{ 1 } << 14;
+
+	constexpr std::array<Feature, bioscripts::context::feature_count> default_order = {
+		Feature::CDS,
+		Feature::FivePrimeUTR,
+		Feature::ThreePrimeUTR,
+		Feature::Exon,
+		Feature::Intron,
+		Feature::Intergenic
+	};
+
+	/**
+	 * @brief  The feature a record of @a type stands for, or an empty optional if it is no part of a transcript.
+	 */
+	std::optional<Feature> featureOf(bioscripts::gff::Record::Type type)
+	{
+		switch (type) {
+		case bioscripts::gff::Record::Type::five_prime_UTR:
+			return Feature::FivePrimeUTR;
+		case bioscripts::gff::Record::Type::CDS:
+			return Feature::CDS;
+		case bioscripts::gff::Record::Type::three_prime_UTR:
+			return Feature::ThreePrimeUTR;
+		case bioscripts::gff::Record::Type::exon:
+			return Feature::Exon;
+		default:
+			return std::nullopt;
+		}
+	}
+
+	/**
+	 * @brief  The gaps between the @a pieces of a transcript, where overlapping or adjacent pieces leave no gap.
+	 */
+	std::vector<bioscripts::Range> gapsBetween(std::vector<bioscripts::Range> pieces)
+	{
+		std::vector<bioscripts::Range> gaps;
+		std::sort(std::begin(pieces), std::end(pieces));
+		bioscripts::gaps(pieces, std::back_inserter(gaps));
+		return gaps;
+	}
+}
+
+namespace bioscripts
+{
+	namespace context
+	{
+		std::string_view name(Feature feature)
+		{
+			switch (feature) {
+			case Feature::FivePrimeUTR:
+				return "5UTR";
+			case Feature::CDS:
+				return "CDS";
+			case Feature::ThreePrimeUTR:
+				return "3UTR";
+			case Feature::Exon:
+				return "exon";
+			case Feature::Intron:
+				return "intron";
+			default:
+				return "intergenic";
+			}
+		}
+
+		std::optional<Feature> parseFeature(std::string_view feature_name)
+		{
+			auto equalIgnoringCase = [](std::string_view lhs, std::string_view rhs) {
+				return std::equal(std::begin(lhs), std::end(lhs), std::begin(rhs), std::end(rhs), [](char l, char r) {
+					return std::tolower(static_cast<unsigned char>(l)) == std::tolower(static_cast<unsigned char>(r));
+				});
+			};
+			for (const auto feature : default_order) {
+				if (equalIgnoringCase(feature_name, name(feature))) {
+					return feature;
+				}
+			}
+			return std::nullopt;
+		}
+
+		Precedence::Precedence() : Precedence(std::vector<Feature>{})
+		{
+		}
+
+		Precedence::Precedence(const std::vector<Feature>& order)
+		{
+			constexpr uint8_t unranked = feature_count;
+			ranks.fill(unranked);
+			uint8_t next_rank = 0;
+			auto rank = [&](Feature feature) {
+				auto& feature_rank = ranks[static_cast<std::size_t>(feature)];
+				if (feature != Feature::Intergenic && feature_rank == unranked) {
+					feature_rank = next_rank++;
+				}
+			};
+			std::for_each(std::begin(order), std::end(order), rank);
+			std::for_each(std::begin(default_order), std::end(default_order), rank);
+			ranks[static_cast<std::size_t>(Feature::Intergenic)] = next_rank;
+		}
+
+		std::optional<Precedence> Precedence::parse(std::string_view order)
+		{
+			std::vector<Feature> features;
+			for (const auto& feature_name : helper::tokenise(std::string{ order }, ',')) {
+				const auto feature = parseFeature(feature_name);
+				if (!feature || std::find(std::begin(features), std::end(features), *feature) != std::end(features)) {
+					return std::nullopt;
+				}
+				features.push_back(*feature);
+			}
+			return Precedence{ features };
+		}
+
+		bool Precedence::before(Feature lhs, Feature rhs) const
+		{
+			return ranks[static_cast<std::size_t>(lhs)] < ranks[static_cast<std::size_t>(rhs)];
+		}
+
+		std::array<Feature, feature_count> Precedence::order() const
+		{
+			std::array<Feature, feature_count> features;
+			for (std::size_t i = 0; i < feature_count; ++i) {
+				features[ranks[i]] = static_cast<Feature>(i);
+			}
+			return features;
+		}
+
+		ContextIndex::ContextIndex(const gff::Records& records, const gff::Hierarchy& hierarchy)
+		{
+			std::unordered_map<gff::Hierarchy::Node, std::size_t> transcript_numbers;
+			for (const auto& [sequence_id, sequence_records] : records) {
+				struct TranscriptPieces
+				{
+					std::vector<Range> exons;
+					std::vector<Range> coding_or_untranslated; //The UTR and CDS records
+				};
+				std::map<std::size_t, TranscriptPieces> transcripts; //Ordered by transcript number, so ties between features are always broken alike
+
+				auto& features = sequences[sequence_id];
+				std::vector<Interval> intervals;
+				auto addSegment = [&](Feature feature, std::size_t transcript, Range span) {
+					intervals.push_back(Interval{ .span = span, .id = features.segments.size() });
+					features.segments.push_back(Segment{ .feature = feature, .transcript = transcript });
+				};
+				const auto first_node = hierarchy.node(sequence_id, 0);
+				for (std::size_t i = 0; i < sequence_records.size(); ++i) {
+					const auto& record = sequence_records[i];
+					const auto feature = featureOf(record.type);
+					const auto transcript = feature ? hierarchy.parent(static_cast<gff::Hierarchy::Node>(*first_node + i)) : gff::Hierarchy::no_node;
+					if (transcript == gff::Hierarchy::no_node) {
+						continue;
+					}
+					const auto [transcript_number, inserted] = transcript_numbers.try_emplace(transcript, transcript_ids.size());
+					if (inserted) {
+						transcript_ids.emplace_back(hierarchy.name(transcript));
+					}
+					auto& pieces = transcripts[transcript_number->second];
+					if (*feature == Feature::Exon) {
+						pieces.exons.push_back(record.span);
+					}
+					else {
+						pieces.coding_or_untranslated.push_back(record.span);
+						addSegment(*feature, transcript_number->second, record.span);
+					}
+				}
+				for (const auto& [transcript, pieces] : transcripts) {
+					//The exons of a coding transcript are covered by its UTR and CDS records, so they are only
+					//features of their own for non-coding transcripts
+					if (pieces.coding_or_untranslated.empty()) {
+						for (const auto& exon : pieces.exons) {
+							addSegment(Feature::Exon, transcript, exon);
+						}
+					}
+					for (const auto& intron : gapsBetween(pieces.exons.empty() ? pieces.coding_or_untranslated : pieces.exons)) {
+						addSegment(Feature::Intron, transcript, intron);
+					}
+				}
+				features.tree = IntervalTree{ std::move(intervals) };
+			}
+			LOG(INFO) << "Indexed " << size() << " features of " << transcript_ids.size() << " transcripts on " << sequences.size() << " sequences";
+		}
+
+		Context ContextIndex::at(const std::string& sequence_id, Position position, const Precedence& precedence) const
+		{
+			const auto features = sequences.find(sequence_id);
+			if (features == std::end(sequences)) {
+				return Context{};
+			}
+			std::vector<std::size_t> overlapping;
+			return at(features->second, position, precedence, overlapping);
+		}
+
+		Context ContextIndex::at(const SequenceFeatures& features, Position position, const Precedence& precedence, std::vector<std::size_t>& overlapping) const
+		{
+			overlapping.clear();
+			features.tree.overlapping(Range{ position, position + 1 }, overlapping);
+			const Segment* best = nullptr;
+			for (const auto id : overlapping) {
+				if (best == nullptr || precedence.before(features.segments[id].feature, best->feature)) {
+					best = &features.segments[id];
+				}
+			}
+			if (best == nullptr) {
+				return Context{};
+			}
+			return Context{ .feature = best->feature, .transcript_id = transcript_ids[best->transcript] };
+		}
+
+		std::vector<Context> ContextIndex::classify(const peak::Peaks& peaks, const Precedence& precedence) const
+		{
+			std::vector<const peak::Peak*> peak_pointers;
+			std::vector<Position> midpoints;
+			for (const auto& peak : peaks) {
+				peak_pointers.push_back(&peak);
+				midpoints.push_back(static_cast<Position>(peak::midpoint(peak)));
+			}
+			std::vector<std::size_t> order(peak_pointers.size());
+			std::iota(std::begin(order), std::end(order), std::size_t{ 0 });
+			std::sort(std::begin(order), std::end(order), [&](std::size_t lhs, std::size_t rhs) {
+				return std::tie(peak_pointers[lhs]->sequence_id, midpoints[lhs]) < std::tie(peak_pointers[rhs]->sequence_id, midpoints[rhs]);
+			});
+
+			//Every chunk writes the contexts of its own peaks only, so the chunks need no synchronisation
+			std::vector<Context> contexts(peak_pointers.size());
+			helper::parallelFor((order.size() + classify_chunk_size - 1) / classify_chunk_size, [&](std::size_t chunk) {
+				const auto chunk_end = (std::min)(order.size(), (chunk + 1) * classify_chunk_size);
+				std::vector<std::size_t> overlapping;
+				const std::string* current_sequence_id = nullptr;
+				const SequenceFeatures* features = nullptr;
+				for (auto o = chunk * classify_chunk_size; o < chunk_end; ++o) {
+					const auto i = order[o];
+					const auto& peak = *peak_pointers[i];
+					if (current_sequence_id == nullptr || *current_sequence_id != peak.sequence_id) {
+						current_sequence_id = &peak.sequence_id;
+						const auto found = sequences.find(peak.sequence_id);
+						features = found == std::end(sequences) ? nullptr : &found->second;
+					}
+					if (features != nullptr) {
+						contexts[i] = at(*features, midpoints[i], precedence, overlapping);
+					}
+				}
+			});
+			return contexts;
+		}
+
+		std::size_t ContextIndex::size() const
+		{
+			std::size_t segment_count = 0;
+			for (const auto& [sequence_id, features] : sequences) {
+				segment_count += features.segments.size();
+			}
+			return segment_count;
+		}
+
+		void write(std::ostream& stream, const peak::Peaks& peaks, const std::vector<Context>& contexts)
+		{
+			std::size_t i = 0;
+			for (const auto& peak : peaks) {
+				const auto& context = contexts[i];
+				stream << i++ << "\t" << peak.sequence_id << "\t" << static_cast<Position>(peak::midpoint(peak)) << "\t" << name(context.feature) << "\t";
+				if (context.transcript_id.empty()) {
+					stream << "-";
+				}
+				else {
+					stream << context.transcript_id;
+				}
+				stream << "\n";
+			}
+		}
+	}
+}
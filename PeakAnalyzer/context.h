@@ -0,0 +1,161 @@
+#ifndef BIOSCRIPTS_CONTEXT_H
+#define BIOSCRIPTS_CONTEXT_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "gff.h"
+#include "hierarchy.h"
+#include "interval_tree.h"
+#include "peak.h"
+#include "range.h"
+
+namespace bioscripts
+{
+	namespace context
+	{
+		/**
+		 * @brief  The part of a gene model a position lies in.
+		 */
+		enum class Feature : uint8_t
+		{
+			FivePrimeUTR,
+			CDS,
+			ThreePrimeUTR,
+			Exon,		//An exon not covered by any UTR or CDS record, i.e. of a non-coding transcript
+			Intron,		//Between two consecutive exons of a transcript
+			Intergenic	//Not within any transcript
+		};
+
+		inline constexpr std::size_t feature_count = static_cast<std::size_t>(Feature::Intergenic) + 1;
+
+		/**
+		 * @brief  The name of @a feature in the output, e.g. "5UTR" or "intron".
+		 */
+		std::string_view name(Feature feature);
+
+		/**
+		 * @brief  The feature named @a feature_name, as written by name() and matched regardless of case.
+		 */
+		std::optional<Feature> parseFeature(std::string_view feature_name);
+
+		/**
+		 * @brief  The order in which features win when a position lies in several of them at once, e.g. in the CDS
+		 *		   of one transcript and the intron of another.
+		 */
+		class Precedence
+		{
+		public:
+			/**
+			 * @brief  CDS first, then the 5' UTR, the 3' UTR, other exons and introns.
+			 */
+			Precedence();
+
+			/**
+			 * @brief  The features of @a order first, in that order, and any others after them in the default order.
+			 *		   Intergenic always comes last, as it only applies where no other feature does.
+			 */
+			explicit Precedence(const std::vector<Feature>& order);
+
+			/**
+			 * @brief  Parse a comma separated list of feature names, e.g. "5UTR,CDS,3UTR".
+			 * @return  The precedence, or an empty optional if a name is unknown or repeated.
+			 */
+			static std::optional<Precedence> parse(std::string_view order);
+
+			/**
+			 * @brief  Whether @a lhs wins over @a rhs.
+			 */
+			bool before(Feature lhs, Feature rhs) const;
+
+			/**
+			 * @brief  The features from the first to win to the last, for describing the precedence.
+			 */
+			std::array<Feature, feature_count> order() const;
+
+		private:
+			std::array<uint8_t, feature_count> ranks;
+		};
+
+		/**
+		 * @brief  The feature a position lies in, and the transcript it belongs to, empty for intergenic positions.
+		 */
+		struct Context
+		{
+			Feature feature = Feature::Intergenic;
+			std::string_view transcript_id;
+		};
+
+		/**
+		 * @brief  Index over the UTR, CDS and exon records of a gff::Records, together with the introns between the
+		 *		   exons of every transcript, answering which feature a position lies in with a single lookup.
+		 *
+		 * The records are grouped into the transcripts a gff::Hierarchy links them to. Introns are the gaps between the
+		 * consecutive exons of a transcript, or between its UTR and CDS records if it has no exon records. All
+		 * features of a sequence are held in one interval tree, so a lookup sees every feature type at once instead
+		 * of one getRecordsAt() call per type. Only the transcript identifiers are copied out of the records.
+		 */
+		class ContextIndex
+		{
+		public:
+			/**
+			 * @brief  Index the features of @a records, with @a hierarchy built from the same records.
+			 */
+			ContextIndex(const gff::Records& records, const gff::Hierarchy& hierarchy);
+
+			/**
+			 * @brief  The feature at @a position on @a sequence_id that comes first in @a precedence. Of several
+			 *		   transcripts with that feature, the one whose feature starts first is taken.
+			 */
+			Context at(const std::string& sequence_id, Position position, const Precedence& precedence = {}) const;
+
+			/**
+			 * @brief  The context of the midpoint of every peak, looked up in passes over the peaks ordered by
+			 *		   sequence and midpoint, so that consecutive lookups stay within the same part of the same tree.
+			 *
+			 * The ordered peaks are split into chunks that are classified in parallel, each reusing one buffer for
+			 * all of its lookups.
+			 * @return  One context per peak, in the order of @a peaks.
+			 */
+			std::vector<Context> classify(const peak::Peaks& peaks, const Precedence& precedence = {}) const;
+
+			/**
+			 * @brief  Return the number of features held, introns included.
+			 */
+			std::size_t size() const;
+
+		private:
+			struct Segment
+			{
+				Feature feature;
+				std::size_t transcript; //Index into transcript_ids
+			};
+
+			struct SequenceFeatures
+			{
+				IntervalTree tree;
+				std::vector<Segment> segments; //Indexed by the interval ids of the tree
+			};
+
+			Context at(const SequenceFeatures& features, Position position, const Precedence& precedence, std::vector<std::size_t>& overlapping) const;
+
+			std::vector<std::string> transcript_ids;
+			std::unordered_map<std::string, SequenceFeatures> sequences;
+		};
+
+		/**
+		 * @brief  Write the contexts as tab-delimited rows of the peak's number in the input, its sequence, its
+		 *		   midpoint, the feature and the transcript, "-" for intergenic peaks.
+		 */
+		void write(std::ostream& stream, const peak::Peaks& peaks, const std::vector<Context>& contexts);
+	}
+}
+
+#endif // !BIOSCRIPTS_CONTEXT_H
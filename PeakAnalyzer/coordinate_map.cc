@@ -0,0 +1,237 @@
+#include <algorithm>
+
+#include "coordinate_map.h"
+#include "parallel.h"
+
+#include "easylogging++.h"
+
+namespace
+{
+	constexpr std::size_t batch_chunk_size = std::size_t{ 1 } << 16;
+}
+
+namespace bioscripts
+{
+	namespace coordinates
+	{
+		CoordinateMap::CoordinateMap(const gff::Records& records)
+		{
+			std::vector<std::vector<Range>> transcript_segments;
+			for (const auto& [sequence_id, sequence_records] : records) {
+				const auto sequence = sequence_ids.size();
+				sequence_ids.push_back(sequence_id);
+				for (const auto& record : sequence_records) {
+					if (record.type != gff::Record::Type::CDS) {
+						continue;
+					}
+					auto transcript_id = gff::extractAttribute(record, "ID=CDS");
+					if (transcript_id.empty()) {
+						continue;
+					}
+					const auto [transcript_number, inserted] = transcript_numbers.try_emplace(std::move(transcript_id), transcripts.size());
+					if (inserted) {
+						transcripts.push_back(Transcript{ .strand = record.strand, .sequence = sequence, .first_segment = 0, .segment_count = 0 });
+						transcript_segments.emplace_back();
+					}
+					transcript_segments[transcript_number->second].push_back(record.span);
+				}
+			}
+			layOut(transcript_segments);
+		}
+
+		CoordinateMap::CoordinateMap(const gff::Records& records, const gff::Hierarchy& hierarchy, gff::Record::Type type)
+		{
+			//Transcripts are told apart by their node, so their identifier is only copied once for each of them
+			std::unordered_map<gff::Hierarchy::Node, std::size_t> transcripts_by_node;
+			std::vector<std::vector<Range>> transcript_segments;
+			for (const auto& [sequence_id, sequence_records] : records) {
+				const auto sequence = sequence_ids.size();
+				sequence_ids.push_back(sequence_id);
+				const auto first_node = hierarchy.node(sequence_id, 0);
+				for (std::size_t i = 0; i < sequence_records.size(); ++i) {
+					const auto& record = sequence_records[i];
+					if (record.type != type) {
+						continue;
+					}
+					const auto transcript = hierarchy.parent(static_cast<gff::Hierarchy::Node>(*first_node + i));
+					if (transcript == gff::Hierarchy::no_node) {
+						continue;
+					}
+					const auto [transcript_number, inserted] = transcripts_by_node.try_emplace(transcript, transcripts.size());
+					if (inserted) {
+						transcript_numbers.try_emplace(std::string{ hierarchy.name(transcript) }, transcripts.size());
+						transcripts.push_back(Transcript{ .strand = record.strand, .sequence = sequence, .first_segment = 0, .segment_count = 0 });
+						transcript_segments.emplace_back();
+					}
+					transcript_segments[transcript_number->second].push_back(record.span);
+				}
+			}
+			layOut(transcript_segments);
+		}
+
+		void CoordinateMap::layOut(std::vector<std::vector<Range>>& transcript_segments)
+		{
+			for (std::size_t t = 0; t < transcripts.size(); ++t) {
+				auto& pieces = transcript_segments[t];
+				std::sort(std::begin(pieces), std::end(pieces));
+				pieces.erase(std::unique(std::begin(pieces), std::end(pieces)), std::end(pieces));
+				if (transcripts[t].strand == Strand::Antisense) {
+					std::reverse(std::begin(pieces), std::end(pieces));
+				}
+
+				transcripts[t].first_segment = segments.size();
+				transcripts[t].segment_count = pieces.size();
+				Position offset = 0;
+				for (const auto& piece : pieces) {
+					segments.push_back(piece);
+					offsets.push_back(offset);
+					offset += length(piece);
+				}
+			}
+			LOG(INFO) << "Mapped " << segments.size() << " records of " << transcripts.size() << " transcripts";
+		}
+
+		std::optional<std::size_t> CoordinateMap::find(std::string_view transcript_id) const
+		{
+			const auto transcript_number = transcript_numbers.find(transcript_id);
+			if (transcript_number == std::end(transcript_numbers)) {
+				return std::nullopt;
+			}
+			return transcript_number->second;
+		}
+
+		std::optional<TranscriptPosition> CoordinateMap::toTranscript(std::size_t transcript, Position position) const
+		{
+			const auto& t = transcripts[transcript];
+			const auto transcript_segments = segmentsOf(transcript);
+			//The segment that could hold the position is the last one starting at or before it in genomic order,
+			//which is the first such one for antisense transcripts as their segments run backwards
+			std::size_t k = 0;
+			if (t.strand == Strand::Antisense) {
+				k = static_cast<std::size_t>(std::partition_point(std::begin(transcript_segments), std::end(transcript_segments), [position](const Range& segment) {
+					return segment.start > position;
+				}) - std::begin(transcript_segments));
+				if (k == transcript_segments.size()) {
+					return std::nullopt;
+				}
+			}
+			else {
+				k = static_cast<std::size_t>(std::partition_point(std::begin(transcript_segments), std::end(transcript_segments), [position](const Range& segment) {
+					return segment.start <= position;
+				}) - std::begin(transcript_segments));
+				if (k-- == 0) {
+					return std::nullopt;
+				}
+			}
+
+			const auto& segment = transcript_segments[k];
+			if (position >= segment.end) {
+				return std::nullopt;
+			}
+			const auto offset = offsets[t.first_segment + k] + (t.strand == Strand::Antisense ? segment.end - 1 - position : position - segment.start);
+			return TranscriptPosition{ .offset = offset, .codon = offset / codon_length, .codon_position = static_cast<uint8_t>(offset % codon_length) };
+		}
+
+		std::optional<Position> CoordinateMap::toGenome(std::size_t transcript, Position offset) const
+		{
+			if (offset >= codingLength(transcript)) {
+				return std::nullopt;
+			}
+			const auto& t = transcripts[transcript];
+			const auto transcript_offsets = std::span{ offsets }.subspan(t.first_segment, t.segment_count);
+			const auto k = static_cast<std::size_t>(std::upper_bound(std::begin(transcript_offsets), std::end(transcript_offsets), offset) - std::begin(transcript_offsets)) - 1;
+			const auto& segment = segments[t.first_segment + k];
+			const auto bases_into_segment = offset - transcript_offsets[k];
+			return t.strand == Strand::Antisense ? segment.end - 1 - bases_into_segment : segment.start + bases_into_segment;
+		}
+
+		std::vector<std::optional<TranscriptPosition>> CoordinateMap::toTranscript(std::span<const GenomicQuery> queries) const
+		{
+			std::vector<std::optional<TranscriptPosition>> positions(queries.size());
+			const auto chunk_count = (queries.size() + batch_chunk_size - 1) / batch_chunk_size;
+			helper::parallelFor(chunk_count, [&](std::size_t chunk) {
+				const auto chunk_end = (std::min)(queries.size(), (chunk + 1) * batch_chunk_size);
+				for (auto i = chunk * batch_chunk_size; i < chunk_end; ++i) {
+					positions[i] = toTranscript(queries[i].transcript, queries[i].position);
+				}
+			});
+			return positions;
+		}
+
+		Length CoordinateMap::codingLength(std::size_t transcript) const
+		{
+			const auto& t = transcripts[transcript];
+			if (t.segment_count == 0) {
+				return 0;
+			}
+			const auto last = t.first_segment + t.segment_count - 1;
+			return offsets[last] + length(segments[last]);
+		}
+
+		Strand CoordinateMap::strand(std::size_t transcript) const
+		{
+			return transcripts[transcript].strand;
+		}
+
+		const std::string& CoordinateMap::sequenceId(std::size_t transcript) const
+		{
+			return sequence_ids[transcripts[transcript].sequence];
+		}
+
+		std::span<const Range> CoordinateMap::segmentsOf(std::size_t transcript) const
+		{
+			return std::span{ segments }.subspan(transcripts[transcript].first_segment, transcripts[transcript].segment_count);
+		}
+
+		std::size_t CoordinateMap::size() const
+		{
+			return transcripts.size();
+		}
+
+		std::vector<std::vector<std::optional<TranscriptPosition>>> peakPositions(const peak::Peaks& peaks, const std::vector<annotation::PeakAnnotation>& annotations, const CoordinateMap& map)
+		{
+			std::vector<GenomicQuery> queries;
+			std::vector<std::vector<std::optional<std::size_t>>> query_of_transcript;
+			std::size_t peak_index = 0;
+			for (const auto& peak : peaks) {
+				const auto midpoint = static_cast<Position>(peak::midpoint(peak));
+				auto& peak_queries = query_of_transcript.emplace_back();
+				for (const auto& coding_sequence : annotations[peak_index]) {
+					const auto transcript = coding_sequence.empty() ? std::nullopt : map.find(coding_sequence.front().transcript_id);
+					peak_queries.push_back(transcript ? std::optional<std::size_t>{ queries.size() } : std::nullopt);
+					if (transcript) {
+						queries.push_back(GenomicQuery{ .transcript = *transcript, .position = midpoint });
+					}
+				}
+				++peak_index;
+			}
+
+			const auto mapped = map.toTranscript(queries);
+			std::vector<std::vector<std::optional<TranscriptPosition>>> positions;
+			positions.reserve(query_of_transcript.size());
+			for (const auto& peak_queries : query_of_transcript) {
+				auto& peak_positions = positions.emplace_back();
+				for (const auto& query : peak_queries) {
+					peak_positions.push_back(query ? mapped[*query] : std::nullopt);
+				}
+			}
+			return positions;
+		}
+
+		void write(std::ostream& stream, const std::vector<annotation::PeakAnnotation>& annotations, const std::vector<std::vector<std::optional<TranscriptPosition>>>& positions)
+		{
+			std::size_t peak_id = 0;
+			for (std::size_t i = 0; i < annotations.size(); ++i) {
+				for (std::size_t transcript = 0; transcript < annotations[i].size(); ++transcript) {
+					stream << peak_id++ << "\t" << annotations[i][transcript].front().transcript_id << "\t";
+					if (const auto& position = positions[i][transcript]) {
+						stream << position->offset << "\t" << position->codon << "\t" << static_cast<unsigned>(position->codon_position) << "\n";
+					}
+					else {
+						stream << "-\t-\t-\n";
+					}
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,169 @@
+#ifndef BIOSCRIPTS_COORDINATE_MAP_H
+#define BIOSCRIPTS_COORDINATE_MAP_H
+
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "annotation.h"
+#include "gff.h"
+#include "hierarchy.h"
+#include "peak.h"
+#include "range.h"
+#include "strand.h"
+
+namespace bioscripts
+{
+	namespace coordinates
+	{
+		inline constexpr Length codon_length = 3;
+
+		/**
+		 * @brief  A position within the spliced coding sequence of a transcript.
+		 */
+		struct TranscriptPosition
+		{
+			Position offset;		//0-based, counted from the first base of the CDS in the direction the transcript is read
+			std::size_t codon;		//0-based number of the codon holding the base, offset / 3
+			uint8_t codon_position;	//0, 1 or 2 for the first, second or third base of that codon
+		};
+
+		/**
+		 * @brief  A genomic position on one of the transcripts of a CoordinateMap, for the batch mapping.
+		 */
+		struct GenomicQuery
+		{
+			std::size_t transcript;	//As returned by CoordinateMap::find
+			Position position;
+		};
+
+		/**
+		 * @brief  Maps positions between the genome and the spliced coding sequences of transcripts.
+		 *
+		 * The CDS records of every transcript are stored in the order the transcript is read, 5' to 3', each with the
+		 * number of coding bases before it. These prefix sums turn both directions into a binary search over the
+		 * segments of one transcript, whichever strand it is on. Codon positions assume every coding sequence starts
+		 * with a complete codon, as the CDS records of a full gene model do.
+		 */
+		class CoordinateMap
+		{
+		public:
+			/**
+			 * @brief  Collect the CDS records of every transcript in @a records.
+			 *
+			 * The CDS records are told apart by their ID=CDS attribute like in the annotation, so @a records need not
+			 * hold the transcripts themselves.
+			 */
+			explicit CoordinateMap(const gff::Records& records);
+
+			/**
+			 * @brief  Collect the records of @a type of every transcript that @a hierarchy, built from @a records, links
+			 *		   them to.
+			 *
+			 * The segments can be the records of any type, e.g. the 5' UTR, which are then mapped the same way as the CDS.
+			 */
+			CoordinateMap(const gff::Records& records, const gff::Hierarchy& hierarchy, gff::Record::Type type = gff::Record::Type::CDS);
+
+			/**
+			 * @brief  The number that the other functions know the transcript @a transcript_id by.
+			 * @return  The number, or an empty optional if there are no CDS records of that transcript.
+			 */
+			std::optional<std::size_t> find(std::string_view transcript_id) const;
+
+			/**
+			 * @brief  The spliced coding position of the genomic @a position on @a transcript.
+			 * @return  The position, or an empty optional if @a position lies outside every CDS record of the transcript.
+			 */
+			std::optional<TranscriptPosition> toTranscript(std::size_t transcript, Position position) const;
+
+			/**
+			 * @brief  The genomic position of the base @a offset bases into the coding sequence of @a transcript.
+			 * @return  The position, or an empty optional if the coding sequence is not that long.
+			 */
+			std::optional<Position> toGenome(std::size_t transcript, Position offset) const;
+
+			/**
+			 * @brief  Map every one of @a queries as toTranscript() does, spreading them over all cores.
+			 * @return  One result per query, in the order of @a queries.
+			 */
+			std::vector<std::optional<TranscriptPosition>> toTranscript(std::span<const GenomicQuery> queries) const;
+
+			/**
+			 * @brief  Number of bases in the coding sequence of @a transcript.
+			 */
+			Length codingLength(std::size_t transcript) const;
+
+			Strand strand(std::size_t transcript) const;
+
+			/**
+			 * @brief  The sequence, e.g. the chromosome, that @a transcript lies on.
+			 */
+			const std::string& sequenceId(std::size_t transcript) const;
+
+			/**
+			 * @brief  The segments of @a transcript in the order it is read, 5' to 3'.
+			 */
+			std::span<const Range> segmentsOf(std::size_t transcript) const;
+
+			/**
+			 * @brief  Return the number of transcripts held.
+			 */
+			std::size_t size() const;
+
+		private:
+			struct Transcript
+			{
+				Strand strand;
+				std::size_t sequence; //Index into sequence_ids
+				std::size_t first_segment; //Index into segments and offsets, followed by the transcript's other segments
+				std::size_t segment_count;
+			};
+
+			/**
+			 * @brief  Store the collected @a transcript_segments of every transcript 5' to 3', each with the coding bases
+			 *		   before it.
+			 */
+			void layOut(std::vector<std::vector<Range>>& transcript_segments);
+
+			std::vector<Transcript> transcripts;
+			std::vector<std::string> sequence_ids;
+			std::vector<Range> segments;		//The CDS records of every transcript, 5' to 3'
+			std::vector<Position> offsets;		//Per segment, the coding bases of its transcript before it
+			/**
+			 * @brief  Hashes transcript identifiers held in any kind of string alike, so they are looked up without a copy.
+			 */
+			struct TranscriptIdHash
+			{
+				using is_transparent = void;
+
+				std::size_t operator()(std::string_view transcript_id) const
+				{
+					return std::hash<std::string_view>{}(transcript_id);
+				}
+			};
+
+			std::unordered_map<std::string, std::size_t, TranscriptIdHash, std::equal_to<>> transcript_numbers;
+		};
+
+		/**
+		 * @brief  The spliced coding position of the midpoint of every peak on each transcript in its annotation.
+		 * @return  Per peak, one position per transcript in its annotation, empty where the midpoint is not coding.
+		 */
+		std::vector<std::vector<std::optional<TranscriptPosition>>> peakPositions(const peak::Peaks& peaks, const std::vector<annotation::PeakAnnotation>& annotations, const CoordinateMap& map);
+
+		/**
+		 * @brief  Write the positions as tab-delimited rows of the peak id used by annotation::flatten(), the
+		 *		   transcript, the coding offset, the codon and the position within it, or "-" for the last three
+		 *		   where the midpoint is not coding.
+		 */
+		void write(std::ostream& stream, const std::vector<annotation::PeakAnnotation>& annotations, const std::vector<std::vector<std::optional<TranscriptPosition>>>& positions);
+	}
+}
+
+#endif // !BIOSCRIPTS_COORDINATE_MAP_H
@@ -0,0 +1,208 @@
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+#include "fasta.h"
+#include "helpers.h"
+
+#include "easylogging++.h"
+
+namespace
+{
+	/**
+	 * @brief  The complement of every byte, N for anything that is not a base.
+	 */
+	constexpr std::array<char, 256> complements = []() {
+		std::array<char, 256> table{};
+		table.fill('N');
+		constexpr std::string_view bases = "ACGTNacgtn";
+		constexpr std::string_view complemented = "TGCANtgcan";
+		for (std::size_t i = 0; i < bases.size(); ++i) {
+			table[static_cast<unsigned char>(bases[i])] = complemented[i];
+		}
+		return table;
+	}();
+
+	/**
+	 * @brief  Byte offset of base @a position of the sequence of @a entry within the FASTA file.
+	 */
+	uint64_t byteOffset(const bioscripts::fasta::FaiEntry& entry, bioscripts::Position position)
+	{
+		return entry.offset + (position / entry.line_bases) * entry.line_width + position % entry.line_bases;
+	}
+}
+
+namespace bioscripts
+{
+	namespace fasta
+	{
+		std::optional<FaiEntry> parseFaiLine(const std::string& line)
+		{
+			const auto tokens = helper::tokenise(line, '\t');
+			if (tokens.size() < 5) {
+				return std::nullopt;
+			}
+			try {
+				FaiEntry entry{
+					.name = tokens[0],
+					.length = std::stoull(tokens[1]),
+					.offset = std::stoull(tokens[2]),
+					.line_bases = std::stoull(tokens[3]),
+					.line_width = std::stoull(tokens[4])
+				};
+				if (entry.line_bases == 0 || entry.line_width < entry.line_bases) {
+					return std::nullopt;
+				}
+				return entry;
+			}
+			catch (const std::logic_error&) {
+				return std::nullopt;
+			}
+		}
+
+		std::filesystem::path faiPath(const std::filesystem::path& fasta_file)
+		{
+			auto fai_file = fasta_file;
+			fai_file += ".fai";
+			return fai_file;
+		}
+
+		std::optional<IndexedFasta> IndexedFasta::open(const std::filesystem::path& fasta_file)
+		{
+			io::LineReader f{ faiPath(fasta_file) };
+			if (!f.is_open()) {
+				LOG(ERROR) << "Could not open " << faiPath(fasta_file).string() << ", index the genome with samtools faidx first";
+				return std::nullopt;
+			}
+			std::vector<FaiEntry> entries;
+			std::string line;
+			while (f.getline(line)) {
+				auto entry = parseFaiLine(line);
+				if (!entry) {
+					LOG(ERROR) << "Malformed row \"" << line << "\" in " << faiPath(fasta_file).string();
+					return std::nullopt;
+				}
+				entries.push_back(std::move(*entry));
+			}
+
+			io::MappedFile file{ fasta_file };
+			if (!file.is_open()) {
+				LOG(ERROR) << "Could not map " << fasta_file.string();
+				return std::nullopt;
+			}
+			IndexedFasta fasta{ std::string_view{ file.data(), file.size() }, entries };
+			if (fasta.entries.size() != entries.size()) {
+				LOG(ERROR) << faiPath(fasta_file).string() << " does not belong to " << fasta_file.string();
+				return std::nullopt;
+			}
+			fasta.file = std::move(file);
+			return fasta;
+		}
+
+		IndexedFasta::IndexedFasta(std::string_view contents, const std::vector<FaiEntry>& entries) : contents(contents)
+		{
+			for (const auto& entry : entries) {
+				if (entry.length > 0 && byteOffset(entry, entry.length - 1) >= contents.size()) {
+					LOG(WARNING) << "Sequence " << entry.name << " reaches beyond the end of the FASTA file, ignoring it";
+					continue;
+				}
+				this->entries.insert_or_assign(entry.name, entry);
+			}
+		}
+
+		std::optional<std::string_view> IndexedFasta::view(const std::string& sequence_id, const Range& span) const
+		{
+			const auto* found = entry(sequence_id, span);
+			if (found == nullptr || span.start / found->line_bases != (span.end - 1) / found->line_bases) {
+				return std::nullopt;
+			}
+			return contents.substr(byteOffset(*found, span.start), bioscripts::length(span));
+		}
+
+		bool IndexedFasta::append(const std::string& sequence_id, const Range& span, std::string& bases) const
+		{
+			const auto* found = entry(sequence_id, span);
+			if (found == nullptr) {
+				return false;
+			}
+			bases.reserve(bases.size() + bioscripts::length(span));
+			for (auto position = span.start; position < span.end;) {
+				//The rest of the span, or of the line the position is on if the span goes beyond it
+				const auto line_end = (position / found->line_bases + 1) * found->line_bases;
+				const auto piece_end = (std::min)(span.end, line_end);
+				bases.append(contents.substr(byteOffset(*found, position), piece_end - position));
+				position = piece_end;
+			}
+			return true;
+		}
+
+		std::optional<Length> IndexedFasta::length(const std::string& sequence_id) const
+		{
+			const auto found = entries.find(sequence_id);
+			if (found == std::end(entries)) {
+				return std::nullopt;
+			}
+			return found->second.length;
+		}
+
+		const FaiEntry* IndexedFasta::entry(const std::string& sequence_id, const Range& span) const
+		{
+			const auto found = entries.find(sequence_id);
+			if (found == std::end(entries) || span.start >= span.end || span.end > found->second.length) {
+				return nullptr;
+			}
+			return &found->second;
+		}
+
+		void reverseComplement(std::string& bases)
+		{
+			std::reverse(std::begin(bases), std::end(bases));
+			for (auto& base : bases) {
+				base = complements[static_cast<unsigned char>(base)];
+			}
+		}
+
+		CodingSequenceCache::CodingSequenceCache(const IndexedFasta& genome, const coordinates::CoordinateMap& map)
+			: genome(genome), map(map), extracted(std::make_unique<std::once_flag[]>(map.size())), sequences(map.size())
+		{
+		}
+
+		const std::string* CodingSequenceCache::get(std::size_t transcript)
+		{
+			std::call_once(extracted[transcript], [this, transcript]() {
+				const auto& sequence_id = map.sequenceId(transcript);
+				const auto antisense = map.strand(transcript) == Strand::Antisense;
+				std::string bases;
+				for (const auto& segment : map.segmentsOf(transcript)) {
+					//GFF positions count from 1, FASTA offsets from 0. An antisense transcript reads every segment
+					//from its end, on the opposite strand.
+					std::string segment_bases;
+					if (segment.start == 0 || !genome.append(sequence_id, Range{ segment.start - 1, segment.end - 1 }, antisense ? segment_bases : bases)) {
+						LOG(WARNING) << "The genome lacks the bases " << segment.start << "-" << segment.end << " of sequence " << sequence_id;
+						return;
+					}
+					if (antisense) {
+						reverseComplement(segment_bases);
+						bases += segment_bases;
+					}
+				}
+				sequences[transcript] = std::make_unique<const std::string>(std::move(bases));
+				++extracted_count;
+			});
+			return sequences[transcript].get();
+		}
+
+		std::size_t CodingSequenceCache::size() const
+		{
+			return extracted_count;
+		}
+
+		void write(std::ostream& stream, std::string_view name, std::string_view bases, std::size_t line_width)
+		{
+			stream << '>' << name << '\n';
+			for (std::size_t line_start = 0; line_start < bases.size(); line_start += line_width) {
+				stream << bases.substr(line_start, line_width) << '\n';
+			}
+		}
+	}
+}
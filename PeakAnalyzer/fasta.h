@@ -0,0 +1,144 @@
+#ifndef BIOSCRIPTS_FASTA_H
+#define BIOSCRIPTS_FASTA_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "coordinate_map.h"
+#include "input.h"
+#include "range.h"
+
+namespace bioscripts
+{
+	namespace fasta
+	{
+		/**
+		 * @brief  One row of a samtools .fai index: where the bases of a sequence start in the FASTA file and how its
+		 *		   lines are wrapped.
+		 */
+		struct FaiEntry
+		{
+			std::string name;
+			uint64_t length;		//Number of bases
+			uint64_t offset;		//Byte offset of the first base
+			uint64_t line_bases;	//Bases per full line
+			uint64_t line_width;	//Bytes per full line, line break included
+		};
+
+		/**
+		 * @brief  Turn a single tab-delimited row of a .fai index into an entry.
+		 * @return  The entry, or an empty optional if the row is malformed.
+		 */
+		std::optional<FaiEntry> parseFaiLine(const std::string& line);
+
+		/**
+		 * @brief  Location of the .fai index of @a fasta_file, as written by samtools faidx.
+		 */
+		std::filesystem::path faiPath(const std::filesystem::path& fasta_file);
+
+		/**
+		 * @brief  Random access to the bases of an uncompressed FASTA file through its .fai index.
+		 *
+		 * The file is memory mapped, and the byte offset of any base follows from the index without scanning, since
+		 * every line of a sequence but its last holds the same number of bases. Bases within one line are returned
+		 * in place.
+		 */
+		class IndexedFasta
+		{
+		public:
+			/**
+			 * @brief  Map @a fasta_file and read the index next to it.
+			 * @return  The reader, or an empty optional if either file is unreadable or the index does not fit the file.
+			 */
+			static std::optional<IndexedFasta> open(const std::filesystem::path& fasta_file);
+
+			/**
+			 * @brief  Read the sequences that @a entries describe out of @a contents, which must outlive the reader.
+			 *
+			 * Entries pointing beyond @a contents are dropped.
+			 */
+			IndexedFasta(std::string_view contents, const std::vector<FaiEntry>& entries);
+
+			/**
+			 * @brief  The bases of @a span on @a sequence_id, counting from 0, without copying them.
+			 * @return  The bases, or an empty optional if the span is not within the sequence or crosses a line break.
+			 */
+			std::optional<std::string_view> view(const std::string& sequence_id, const Range& span) const;
+
+			/**
+			 * @brief  Append the bases of @a span on @a sequence_id to @a bases, one copy per line the span touches.
+			 * @return  False, leaving @a bases unchanged, if the span is not within the sequence.
+			 */
+			bool append(const std::string& sequence_id, const Range& span, std::string& bases) const;
+
+			/**
+			 * @brief  Number of bases of @a sequence_id, or an empty optional if the index does not list it.
+			 */
+			std::optional<Length> length(const std::string& sequence_id) const;
+
+		private:
+			const FaiEntry* entry(const std::string& sequence_id, const Range& span) const;
+
+			io::MappedFile file;
+			std::string_view contents;
+			std::unordered_map<std::string, FaiEntry> entries;
+		};
+
+		/**
+		 * @brief  Turn @a bases into the bases of the opposite strand, read in its own 5' to 3' direction.
+		 *
+		 * Soft-masked (lowercase) bases stay lowercase, anything but A, C, G, T and N becomes N.
+		 */
+		void reverseComplement(std::string& bases);
+
+		/**
+		 * @brief  The spliced coding sequences of the transcripts of a coordinates::CoordinateMap, each extracted
+		 *		   from the genome the first time it is asked for and kept from then on.
+		 *
+		 * Any number of threads may ask for sequences at once. Each transcript is only ever extracted by one of them,
+		 * the others wait for it.
+		 */
+		class CodingSequenceCache
+		{
+		public:
+			CodingSequenceCache(const IndexedFasta& genome, const coordinates::CoordinateMap& map);
+
+			/**
+			 * @brief  The CDS of @a transcript as it is read, 5' to 3', reverse complemented for antisense transcripts.
+			 *
+			 * The segments of the map are taken as GFF positions, which count from 1.
+			 * @return  The bases, or nullptr if the genome lacks some of them.
+			 */
+			const std::string* get(std::size_t transcript);
+
+			/**
+			 * @brief  Number of transcripts extracted so far.
+			 */
+			std::size_t size() const;
+
+		private:
+			const IndexedFasta& genome;
+			const coordinates::CoordinateMap& map;
+			std::unique_ptr<std::once_flag[]> extracted;
+			std::vector<std::unique_ptr<const std::string>> sequences;
+			std::atomic<std::size_t> extracted_count = 0;
+		};
+
+		/**
+		 * @brief  Write @a bases as a FASTA record named @a name, wrapped after @a line_width bases.
+		 */
+		void write(std::ostream& stream, std::string_view name, std::string_view bases, std::size_t line_width = 60);
+	}
+}
+
+#endif // !BIOSCRIPTS_FASTA_H
@@ -1,14 +1,16 @@
-#include <fstream>
 #include <cmath>
 #include <cassert>
 
 
 #include <iostream>
 #include <algorithm>
+#include <chrono>
+#include <tuple>
 
 #include "identifier.h"
 #include "helpers.h"
 #include "gff.h"
+#include "input.h"
 #include "range.h"
 
 #include "easylogging++.h"
@@ -69,6 +71,54 @@ namespace {
 		}
 	}
 
+	/**
+	 * @brief  Turn a single tab-delimited GFF line into a record.
+	 * @return  The parsed record, or an empty optional if the line is malformed or describes a feature we do not handle.
+	 */
+	std::optional<bioscripts::gff::Record> parseRecord(const std::string& line)
+	{
+		const auto tokens = helper::tokenise(line, '\t');
+		if (tokens.size() != 9) {
+			return std::nullopt;
+		}
+
+		const auto& sequence_id = tokens[0];
+
+		const auto type = deduceType(tokens[2]);
+		if (type == bioscripts::gff::Record::Type::Unknown) {
+			return std::nullopt;
+		}
+
+		std::size_t start_pos = std::stoull(tokens[3]);
+		std::size_t end_pos = std::stoull(tokens[4]);
+
+		//Add one to end-pos because Range is 0-based [start, end)
+		//but GFF coordinates are [start, end]
+		auto record_span = bioscripts::Range{ start_pos, end_pos + 1 };
+
+		const auto strand = bioscripts::deduceStrand(tokens[6]);
+		if (strand == bioscripts::Strand::Unknown) {
+			return std::nullopt;
+		}
+
+		const auto& attributes = tokens[8];
+
+		return bioscripts::gff::Record{
+			.type = type,
+			.strand = strand,
+			.span = record_span,
+			.sequence_id = sequence_id,
+			.attributes = attributes
+		};
+	}
+
+	std::shared_future<std::unordered_set<std::string>> makeReady(const std::unordered_set<std::string>& sequence_ids)
+	{
+		std::promise<std::unordered_set<std::string>> ready_sequence_ids;
+		ready_sequence_ids.set_value(sequence_ids);
+		return ready_sequence_ids.get_future().share();
+	}
+
 	///**
 	// * @brief  Calculate the absolute distance between record and @a genomic_position
 	// * 
@@ -93,65 +143,133 @@ namespace bioscripts
 {
 	namespace gff
 	{
-		Records::Records(const std::filesystem::path& gff_records)
+		Records::Records(const std::filesystem::path& gff_records) : Records(gff_records, std::unordered_set<std::string>{})
+		{
+		}
+
+		Records::Records(const std::filesystem::path& gff_records, const std::unordered_set<std::string>& sequence_ids) : Records(gff_records, makeReady(sequence_ids))
+		{
+		}
+
+		Records::Records(const std::filesystem::path& gff_records, std::shared_future<std::unordered_set<std::string>> sequence_ids)
 		{
 			//LOG(DEBUG) << "Parsing GFF records from " << gff_records.string();
-			std::ifstream f{ gff_records };
+			io::LineReader f{ gff_records };
 			if (!f.is_open()) {
 				//LOG(ERROR) << "Failed to open " << gff_records.string();
 				return;
 			}
 
+			//Polling the future is cheap but not free, so it is only checked every so many lines until it is ready
+			static constexpr std::size_t filter_poll_interval = 4096;
+			const std::unordered_set<std::string>* sequence_filter = nullptr;
+			bool filter_pending = true;
+			std::size_t line_number = 0;
+
 			std::string line;
-			std::getline(f, line); /* Skips the header in database file */
-			while (std::getline(f, line)) {
+			f.getline(line); /* Skips the header in database file */
+			while (f.getline(line)) {
+				if (filter_pending && (line_number++ % filter_poll_interval == 0) && sequence_ids.wait_for(std::chrono::seconds{ 0 }) == std::future_status::ready) {
+					filter_pending = false;
+					if (!sequence_ids.get().empty()) {
+						sequence_filter = &sequence_ids.get();
+					}
+				}
+
 				static constexpr auto comment_token = '#';
 				if (line.starts_with(comment_token)) {
 					continue;
 				}
 
-				const auto tokens = helper::tokenise(line, '\t');
-				if (tokens.size() != 9) {
-					continue;
+				//The sequence identifier is the first column, so a line for an unwanted sequence
+				//can be dropped before paying for the tokenisation of the remaining columns.
+				if (sequence_filter != nullptr) {
+					const auto first_tab = line.find('\t');
+					if (first_tab == std::string::npos || !sequence_filter->contains(line.substr(0, first_tab))) {
+						continue;
+					}
 				}
 
-				const auto& sequence_id = tokens[0];
-
-				const auto type = deduceType(tokens[2]);
-				if (type == bioscripts::gff::Record::Type::Unknown) {
+				auto record = parseRecord(line);
+				if (!record) {
 					continue;
 				}
+				this->records[record->sequence_id.to_string()].push_back(std::move(*record));
+			}
 
-				std::size_t start_pos = std::stoull(tokens[3]);
-				std::size_t end_pos = std::stoull(tokens[4]);
+			//Lines read while the filter was still pending may have added records of unwanted sequences
+			if (!sequence_ids.get().empty()) {
+				std::erase_if(records, [&sequence_ids](const auto& entry) {
+					return !sequence_ids.get().contains(entry.first);
+				});
+			}
 
-				//Add one to end-pos because Range is 0-based [start, end)
-				//but GFF coordinates are [start, end]
-				auto record_span = Range{ start_pos, end_pos + 1 };
+			sort();
+		}
 
-				const auto strand = deduceStrand(tokens[6]);
-				if (strand == bioscripts::Strand::Unknown) {
-					continue;
+		Records::Records(const std::filesystem::path& gff_records, const RegionIndex& index, std::vector<Region> regions)
+		{
+			io::LineReader f{ gff_records };
+			if (!f.is_open()) {
+				return;
+			}
+
+			//Overlapping regions are merged so that no part of the file is read twice
+			std::sort(std::begin(regions), std::end(regions), [](const auto& first, const auto& second) {
+				return std::tie(first.sequence_id, first.span.start) < std::tie(second.sequence_id, second.span.start);
+			});
+			std::vector<Region> merged_regions;
+			for (auto& region : regions) {
+				if (!merged_regions.empty() && merged_regions.back().sequence_id == region.sequence_id && merged_regions.back().span.end >= region.span.start) {
+					merged_regions.back().span.end = (std::max)(merged_regions.back().span.end, region.span.end);
 				}
+				else {
+					merged_regions.push_back(std::move(region));
+				}
+			}
 
-				const auto& attributes = tokens[8];
+			std::string line;
+			for (const auto& region : merged_regions) {
+				for (const auto& chunk : index.chunks(region)) {
+					if (!f.seek(chunk.begin)) {
+						LOG(ERROR) << "Could not seek to the indexed records of " << region.sequence_id << " in " << gff_records.string();
+						break;
+					}
 
-				this->records[sequence_id].push_back(Record{
-					.type = type,
-					.strand = strand,
-					.span = record_span,
-					.sequence_id = sequence_id,
-					.attributes = attributes
-					});
+					while (f.tell() < chunk.end && f.getline(line)) {
+						if (line.starts_with('#')) {
+							continue;
+						}
+
+						auto record = parseRecord(line);
+						if (!record) {
+							continue;
+						}
+						//The file is sorted, so nothing after this record can overlap the region either
+						if (record->start() >= region.span.end) {
+							break;
+						}
+						if (!overlap(region, record->sequence_id.to_string(), record->span)) {
+							continue;
+						}
+						this->records[record->sequence_id.to_string()].push_back(std::move(*record));
+					}
+				}
 			}
 
+			sort();
+		}
+
+		void Records::sort()
+		{
+			//Records are already grouped by sequence, so only the start position matters. The sort is stable so that
+			//records starting at the same position keep their file order, no matter how many records were loaded.
 			auto Comparator = [](const auto& first, const auto& second) {
-				return (first.sequence_id.to_string() < second.sequence_id.to_string())
-					&& (first.start() < second.start());
+				return first.start() < second.start();
 			};
 
 			for (auto& [chromosome_id, entries] : records) {
-				std::sort(std::begin(entries), std::end(entries), Comparator);
+				std::stable_sort(std::begin(entries), std::end(entries), Comparator);
 			}
 		}
 
@@ -164,6 +282,11 @@ namespace bioscripts
 			return records_number;
 		}
 
+		bool Records::contains(const Identifier<Full>& sequence_id) const
+		{
+			return records.contains(sequence_id.to_string());
+		}
+
 		/**
 		 * @brief  Extract the attribute value of the given @a attribute_name
 		 * @return  Value of the given @a attribute_name associated with the @record,
@@ -188,16 +311,38 @@ namespace bioscripts
 			return record.attributes.substr(attribute_value_start_pos, substring_length);
 		}
 
+		std::string parentTranscript(const Record& record)
+		{
+			auto parent = extractAttribute(record, "Parent");
+			parent.erase((std::min)(parent.find(','), parent.size()));
+			const auto prefix_end = parent.find(':');
+			if (prefix_end != std::string::npos) {
+				parent.erase(0, prefix_end + 1);
+			}
+			return parent;
+		}
+
 		Records::pointer Records::findClosestRecord(std::size_t genomic_position, const Identifier<Full>& sequence_id, const Identifier<Gene>& peak_gene_id, const Record::Type type)
+		{
+			const auto& const_this = *this;
+			return const_cast<Records::pointer>(const_this.findClosestRecord(genomic_position, sequence_id, peak_gene_id, type));
+		}
+
+		Records::const_pointer Records::findClosestRecord(std::size_t genomic_position, const Identifier<Full>& sequence_id, const Identifier<Gene>& peak_gene_id, const Record::Type type) const
 		{
 			/* Closest record is defined as follows :
 				a) Record whose end position is closest to the genomic_position if that end position < genomic_position OR
 				b) Record whose start position is closest to the genomic_position if that start position > genomic_position
 			 */
 			 LOG(DEBUG) << "Finding closest record to " << genomic_position << " on sequence \"" << sequence_id.to_string() << "\", peak gene identifier is " << peak_gene_id.to_string();
-			std::int64_t current_smallest_distance = (std::numeric_limits<std::int64_t>::max)();
-			Records::pointer closest_record = nullptr;
-			for (auto& record : records[sequence_id.to_string()]) {
+			Distance current_smallest_distance = (std::numeric_limits<Distance>::max)();
+			Records::const_pointer closest_record = nullptr;
+			const auto same_sequence_records = records.find(sequence_id.to_string());
+			if (same_sequence_records == std::end(records)) {
+				LOG(DEBUG) << "No records on sequence \"" << sequence_id.to_string() << "\"";
+				return closest_record;
+			}
+			for (const auto& record : same_sequence_records->second) {
 				if (record.type != type) {
 					continue;
 				}
@@ -220,7 +365,7 @@ namespace bioscripts
 			return closest_record;
 		}
 
-		std::vector<Record> Records::getRecordsAt(const std::size_t genomic_position, const Identifier<Full>& sequence_id)
+		std::vector<Record> Records::getRecordsAt(const std::size_t genomic_position, const Identifier<Full>& sequence_id) const
 		{
 			//LOG(DEBUG) << "Finding underlying record at position " << genomic_position << " on sequence \"" << sequence_id.to_string() << "\n";
 			if (!records.contains(sequence_id.to_string())) {
@@ -228,7 +373,7 @@ namespace bioscripts
 			}
 
 			std::vector<Record> results;
-			for (const auto& record : records[sequence_id.to_string()]) {
+			for (const auto& record : records.at(sequence_id.to_string())) {
 				if (overlap(genomic_position, record.span)) {
 					//LOG(DEBUG) << "Found a record, attributes are " << record.attributes << "\n";
 					results.push_back(record);
@@ -238,7 +383,7 @@ namespace bioscripts
 			return results;
 		}
 
-		std::vector<Record> Records::getRecordsAt(const std::size_t genomic_position, const Identifier<Full>& sequence_id, const Record::Type type)
+		std::vector<Record> Records::getRecordsAt(const std::size_t genomic_position, const Identifier<Full>& sequence_id, const Record::Type type) const
 		{
 			auto results = getRecordsAt(genomic_position, sequence_id);
 
@@ -246,9 +391,7 @@ namespace bioscripts
 				return (elem.type != type);
 			};
 			//LOG(DEBUG) << "Found " << results.size() << " underlying records\n";
-			for (const auto& record : results) {
-				std::erase_if(results, IsWrongFeatureType);
-			}
+			std::erase_if(results, IsWrongFeatureType);
 			//LOG(DEBUG) << "After removing records of incorrect type, there are " << results.size() << " underlying records\n";
 			return results;
 		}
@@ -317,6 +460,101 @@ namespace bioscripts
 
 
 
+		Records collapseIsoforms(const Records& records)
+		{
+			struct GeneSpan
+			{
+				std::string gene;
+				Strand strand;
+				Range span;
+			};
+
+			Records collapsed_records;
+			std::size_t cds_record_count = 0;
+			for (const auto& [sequence_id, sequence_records] : records) {
+				std::vector<GeneSpan> gene_spans;
+				for (const auto& record : sequence_records) {
+					if (record.type != Record::Type::CDS) {
+						continue;
+					}
+					const auto transcript_id = extractAttribute(record, "ID=CDS");
+					if (transcript_id.empty()) {
+						continue;
+					}
+					gene_spans.push_back(GeneSpan{ .gene = Identifier<Gene>{ transcript_id }.gene(), .strand = record.strand, .span = record.span });
+				}
+				cds_record_count += gene_spans.size();
+				std::sort(std::begin(gene_spans), std::end(gene_spans), [](const auto& first, const auto& second) {
+					return std::tie(first.gene, first.strand, first.span.start) < std::tie(second.gene, second.strand, second.span.start);
+				});
+
+				std::vector<Record> collapsed;
+				const GeneSpan* previous = nullptr;
+				for (const auto& gene_span : gene_spans) {
+					if (previous != nullptr && previous->gene == gene_span.gene && previous->strand == gene_span.strand && gene_span.span.start <= collapsed.back().span.end) {
+						collapsed.back().span.end = (std::max)(collapsed.back().span.end, gene_span.span.end);
+					}
+					else {
+						const auto transcript_id = gene_span.gene + '.' + std::string{ collapsed_version };
+						collapsed.push_back(Record{
+							.type = Record::Type::CDS,
+							.strand = gene_span.strand,
+							.span = gene_span.span,
+							.sequence_id = sequence_id,
+							.attributes = "ID=CDS:" + transcript_id + ";Parent=transcript:" + transcript_id
+						});
+					}
+					previous = &gene_span;
+				}
+
+				std::stable_sort(std::begin(collapsed), std::end(collapsed), [](const auto& first, const auto& second) {
+					return first.start() < second.start();
+				});
+				for (auto& record : collapsed) {
+					collapsed_records.add(std::move(record));
+				}
+			}
+			LOG(INFO) << "Collapsed " << cds_record_count << " CDS records into " << collapsed_records.size();
+			return collapsed_records;
+		}
+
+		bool widenToFeatures(std::vector<Region>& regions, const Records& records)
+		{
+			auto isFeature = [](const Record& record) {
+				switch (record.type) {
+				case Record::Type::gene:
+				case Record::Type::mRNA:
+				case Record::Type::five_prime_UTR:
+				case Record::Type::CDS:
+				case Record::Type::three_prime_UTR:
+					return true;
+				default:
+					return false;
+				}
+			};
+
+			bool widened = false;
+			for (auto& region : regions) {
+				if (!records.contains(region.sequence_id)) {
+					continue;
+				}
+				//A feature the region grew over may in turn overlap others that stick out of it
+				bool region_widened = true;
+				while (region_widened) {
+					region_widened = false;
+					for (const auto& record : records.data(region.sequence_id)) {
+						if (isFeature(record) && overlap(region.span, record.span) && (record.start() < region.span.start || record.end() > region.span.end)) {
+							region.span.start = (std::min)(region.span.start, record.start());
+							region.span.end = (std::max)(region.span.end, record.end());
+							region_widened = true;
+							widened = true;
+						}
+					}
+				}
+			}
+			return widened;
+		}
+
 		////TODO: Template this so it can accept both forward and reverse iterators
 		//std::vector<bioscripts::gff::Record> findSubsequentRecords(const std::vector<Record>::iterator start, const std::vector<Record>::iterator end, const bioscripts::gff::Record::Type type)
 		//{
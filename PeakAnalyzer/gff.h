@@ -3,14 +3,19 @@
 
 #include <cstdint>
 #include <filesystem>
+#include <future>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
+#include "gff_index.h"
 #include "identifier.h"
 #include "peak.h"
 #include "range.h"
+#include "region.h"
 
 namespace bioscripts
 {
@@ -70,12 +75,42 @@ namespace bioscripts
 
 		std::string extractAttribute(const Record& record, const std::string& attribute_name);
 
+		/**
+		 * @brief  The transcript @a record belongs to: the first of its parents, without a type prefix such as "transcript:".
+		 * @return  The transcript identifier, or an empty string if @a record has no parent.
+		 */
+		std::string parentTranscript(const Record& record);
+
 		class Records
 		{
 		public:
 			Records() = default;
 			Records(const std::filesystem::path& gff_records);
 
+			/**
+			 * @brief  Parse only the GFF records whose sequence identifier is contained in @a sequence_ids.
+			 *
+			 * Lines belonging to any other sequence are discarded as soon as their first column has been read,
+			 * so the cost of loading scales with the part of the annotation that is actually needed. An empty
+			 * @a sequence_ids loads every sequence.
+			 */
+			Records(const std::filesystem::path& gff_records, const std::unordered_set<std::string>& sequence_ids);
+
+			/**
+			 * @brief  Parse only the GFF records whose sequence identifier is contained in @a sequence_ids, which
+			 *		   may still be computed by another thread while parsing starts.
+			 *
+			 * Lines read before @a sequence_ids becomes ready are parsed unfiltered, the rest are filtered as above.
+			 * Records of unwanted sequences are dropped at the end, so the result is the same as with a ready set.
+			 */
+			Records(const std::filesystem::path& gff_records, std::shared_future<std::unordered_set<std::string>> sequence_ids);
+
+			/**
+			 * @brief  Load only the GFF records that overlap one of the @a regions, reading just the parts of the
+			 *		   BGZF compressed @a gff_records that the positional @a index points to.
+			 */
+			Records(const std::filesystem::path& gff_records, const RegionIndex& index, std::vector<Region> regions);
+
 			using iterator = std::unordered_map<std::string, std::vector<Record>>::iterator;
 			using const_iterator = std::unordered_map<std::string, std::vector<Record>>::const_iterator;
 			using reference = Record&;
@@ -98,32 +133,67 @@ namespace bioscripts
 			/**
 			 * @brief  Find all GFF records that overlap the @a genomic position with the same @sequence id
 			 */
-			std::vector<Record> getRecordsAt(const std::size_t genomic_position, const Identifier<Full>& sequence_id);
+			std::vector<Record> getRecordsAt(const std::size_t genomic_position, const Identifier<Full>& sequence_id) const;
 
 			/**
 			 * @brief  Find all GFF records that overlap the @a genomic position with the same @sequence id and @a type
 			 */
-			std::vector<Record> getRecordsAt(const std::size_t genomic_position, const Identifier<Full>& sequence_id, const Record::Type type);
+			std::vector<Record> getRecordsAt(const std::size_t genomic_position, const Identifier<Full>& sequence_id, const Record::Type type) const;
 
 			/**
 			 * @brief  Find the closest record to @a genomic_position with the same gene identifier as @a peak_gene_id; as well as same @a sequence_id and @a type
 			 * @return  The closest record, or nullptr if no record could not be 
 			 */
 			pointer findClosestRecord(std::size_t genomic_position, const Identifier<Full>& sequence_id, const Identifier<Gene>& peak_gene_id, Record::Type type);
+			const_pointer findClosestRecord(std::size_t genomic_position, const Identifier<Full>& sequence_id, const Identifier<Gene>& peak_gene_id, Record::Type type) const;
 
 			/**
 			 * @brief  Return the number of records currently held.
 			 */
 			std::size_t size() const;
 
+			/**
+			 * @brief  Determines whether any records are held for @a sequence_id.
+			 */
+			bool contains(const Identifier<Full>& sequence_id) const;
+
 
 			//iterator find(const std::string& sequence_id, );
 		private:
+			/**
+			 * @brief  Order the records of every sequence by their start position.
+			 */
+			void sort();
+
 			std::unordered_map<std::string, std::vector<Record>> records;
 		};
 
 		Records fetchRecords(Records records, Record::Type type);
 
+		/**
+		 * @brief  The version that the transcript of a gene collapsed by collapseIsoforms() is given.
+		 */
+		inline constexpr std::string_view collapsed_version = "union";
+
+		/**
+		 * @brief  Collapse the CDS records of all isoforms of every gene into the union of their spans.
+		 *
+		 * The CDS records of each gene and strand are swept in order of their start, merging every span that overlaps
+		 * or abuts the one before it. Each merged span becomes a CDS record of the single transcript "GENE.union", so
+		 * a peak is annotated with at most one coding sequence per gene.
+		 * @return  The collapsed records, ordered by their start on every sequence. Records of other types are dropped.
+		 */
+		Records collapseIsoforms(const Records& records);
+
+		/**
+		 * @brief  Widen every one of the @a regions to the complete span of the genes, transcripts, CDS and UTR records
+		 *		   of @a records it overlaps, until no region grows any further.
+		 *
+		 * Chromosome records and other features are ignored, as they would widen any region to the whole sequence.
+		 * @return  Whether any region was widened.
+		 */
+		bool widenToFeatures(std::vector<Region>& regions, const Records& records);
+
 		std::vector<bioscripts::gff::Record> collectCodingSequenceRecords(const bioscripts::gff::Record& starting_record, const bioscripts::gff::Records& records);
 	}
 }
@@ -0,0 +1,336 @@
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+#include "gff_index.h"
+
+#include "easylogging++.h"
+
+namespace
+{
+	constexpr char index_magic[4] = { 'P', 'A', 'I', '\2' };
+	constexpr unsigned linear_window_shift = 14; //16 kb windows
+
+	/**
+	 * @brief  Smallest UCSC bin that fully contains [@a beg, @a end).
+	 */
+	uint32_t regionToBin(uint64_t beg, uint64_t end)
+	{
+		--end;
+		if (beg >> 14 == end >> 14) return static_cast<uint32_t>(((1 << 15) - 1) / 7 + (beg >> 14));
+		if (beg >> 17 == end >> 17) return static_cast<uint32_t>(((1 << 12) - 1) / 7 + (beg >> 17));
+		if (beg >> 20 == end >> 20) return static_cast<uint32_t>(((1 << 9) - 1) / 7 + (beg >> 20));
+		if (beg >> 23 == end >> 23) return static_cast<uint32_t>(((1 << 6) - 1) / 7 + (beg >> 23));
+		if (beg >> 26 == end >> 26) return static_cast<uint32_t>(((1 << 3) - 1) / 7 + (beg >> 26));
+		return 0;
+	}
+
+	/**
+	 * @brief  All UCSC bins that may hold intervals overlapping [@a beg, @a end).
+	 */
+	std::vector<uint32_t> regionToBins(uint64_t beg, uint64_t end)
+	{
+		--end;
+		std::vector<uint32_t> bins{ 0 };
+		for (auto k = 1 + (beg >> 26); k <= 1 + (end >> 26); ++k) bins.push_back(static_cast<uint32_t>(k));
+		for (auto k = 9 + (beg >> 23); k <= 9 + (end >> 23); ++k) bins.push_back(static_cast<uint32_t>(k));
+		for (auto k = 73 + (beg >> 20); k <= 73 + (end >> 20); ++k) bins.push_back(static_cast<uint32_t>(k));
+		for (auto k = 585 + (beg >> 17); k <= 585 + (end >> 17); ++k) bins.push_back(static_cast<uint32_t>(k));
+		for (auto k = 4681 + (beg >> 14); k <= 4681 + (end >> 14); ++k) bins.push_back(static_cast<uint32_t>(k));
+		return bins;
+	}
+
+	/**
+	 * @brief  Extract the sequence identifier and the span of a GFF line without tokenising the attributes.
+	 * @return  False if the line is not a well-formed feature line.
+	 */
+	bool parseLocation(const std::string& line, std::string& sequence_id, uint64_t& beg, uint64_t& end)
+	{
+		std::size_t column_starts[5] = { 0 };
+		for (std::size_t column = 1; column < 5; ++column) {
+			const auto tab = line.find('\t', column_starts[column - 1]);
+			if (tab == std::string::npos) {
+				return false;
+			}
+			column_starts[column] = tab + 1;
+		}
+
+		try {
+			sequence_id.assign(line, 0, column_starts[1] - 1);
+			beg = std::stoull(line.substr(column_starts[3], column_starts[4] - column_starts[3] - 1));
+			//Same convention as the records: [start, end + 1) of the inclusive GFF coordinates
+			end = std::stoull(line.substr(column_starts[4])) + 1;
+		}
+		catch (const std::logic_error&) {
+			return false;
+		}
+		return beg < end;
+	}
+
+	void writeValue(std::ofstream& f, uint64_t value, std::size_t bytes)
+	{
+		for (std::size_t i = 0; i < bytes; ++i) {
+			f.put(static_cast<char>((value >> (8 * i)) & 0xff));
+		}
+	}
+
+	/**
+	 * @brief  Modification time of @a gff_file in the ticks of the file clock, or 0 if it cannot be read.
+	 */
+	int64_t modificationTime(const std::filesystem::path& gff_file)
+	{
+		std::error_code error;
+		const auto modification_time = std::filesystem::last_write_time(gff_file, error);
+		return error ? 0 : static_cast<int64_t>(modification_time.time_since_epoch().count());
+	}
+
+	uint64_t readValue(std::ifstream& f, std::size_t bytes)
+	{
+		uint64_t value = 0;
+		for (std::size_t i = 0; i < bytes; ++i) {
+			value |= static_cast<uint64_t>(static_cast<unsigned char>(f.get())) << (8 * i);
+		}
+		return value;
+	}
+}
+
+namespace bioscripts
+{
+	namespace gff
+	{
+		std::filesystem::path indexPath(const std::filesystem::path& gff_file)
+		{
+			auto index_file = gff_file;
+			index_file += ".pai";
+			return index_file;
+		}
+
+		std::optional<RegionIndex> RegionIndex::build(const std::filesystem::path& gff_file)
+		{
+			io::LineReader f{ gff_file };
+			if (!f.is_open()) {
+				return std::nullopt;
+			}
+			if (f.compression() != io::Compression::Bgzf || io::isStdin(gff_file)) {
+				LOG(ERROR) << "Only a BGZF compressed file can be indexed, recompress " << gff_file.string() << " with bgzip";
+				return std::nullopt;
+			}
+
+			RegionIndex index;
+			index.indexed_file_size = std::filesystem::file_size(gff_file);
+			index.indexed_modification_time = modificationTime(gff_file);
+
+			std::string line;
+			std::string sequence_id;
+			std::string previous_sequence_id;
+			uint64_t previous_start = 0;
+			auto line_begin = f.tell();
+			while (f.getline(line)) {
+				const auto line_end = f.tell();
+				const auto current_line_begin = line_begin;
+				line_begin = line_end;
+
+				uint64_t beg = 0;
+				uint64_t end = 0;
+				if (line.starts_with('#') || !parseLocation(line, sequence_id, beg, end)) {
+					continue;
+				}
+				if (end > max_position) {
+					LOG(ERROR) << "Record on " << sequence_id << " ends beyond the " << max_position << " coordinates that can be indexed";
+					return std::nullopt;
+				}
+
+				if (sequence_id != previous_sequence_id) {
+					if (index.sequences.contains(sequence_id)) {
+						LOG(ERROR) << gff_file.string() << " is not sorted by sequence, records of " << sequence_id << " are not contiguous";
+						return std::nullopt;
+					}
+					previous_sequence_id = sequence_id;
+					previous_start = 0;
+				}
+				if (beg < previous_start) {
+					LOG(ERROR) << gff_file.string() << " is not sorted by start position on " << sequence_id;
+					return std::nullopt;
+				}
+				previous_start = beg;
+
+				auto& sequence = index.sequences[sequence_id];
+				auto& bin_chunks = sequence.bins[regionToBin(beg, end)];
+				if (!bin_chunks.empty() && bin_chunks.back().end == current_line_begin) {
+					bin_chunks.back().end = line_end;
+				}
+				else {
+					bin_chunks.push_back(Chunk{ .begin = current_line_begin, .end = line_end });
+				}
+
+				const auto last_window = (end - 1) >> linear_window_shift;
+				if (sequence.linear.size() <= last_window) {
+					sequence.linear.resize(last_window + 1, (std::numeric_limits<io::VirtualOffset>::max)());
+				}
+				for (auto window = beg >> linear_window_shift; window <= last_window; ++window) {
+					sequence.linear[window] = (std::min)(sequence.linear[window], current_line_begin);
+				}
+			}
+
+			//Windows without records inherit the offset of the window before them, which keeps it a valid lower bound
+			for (auto& [id, sequence] : index.sequences) {
+				io::VirtualOffset previous = 0;
+				for (auto& offset : sequence.linear) {
+					if (offset == (std::numeric_limits<io::VirtualOffset>::max)()) {
+						offset = previous;
+					}
+					previous = offset;
+				}
+			}
+			return index;
+		}
+
+		std::optional<RegionIndex> RegionIndex::load(const std::filesystem::path& gff_file)
+		{
+			if (io::isStdin(gff_file)) {
+				return std::nullopt;
+			}
+
+			const auto index_file = indexPath(gff_file);
+			std::error_code error;
+			if (!std::filesystem::exists(index_file, error)) {
+				return std::nullopt;
+			}
+
+			std::ifstream f{ index_file, std::ios::binary };
+			char magic[sizeof(index_magic)] = {};
+			f.read(magic, sizeof(magic));
+			if (!f || !std::equal(std::begin(magic), std::end(magic), std::begin(index_magic))) {
+				LOG(WARNING) << index_file.string() << " is not a PeakAnalyzer index, ignoring it";
+				return std::nullopt;
+			}
+
+			RegionIndex index;
+			index.indexed_file_size = readValue(f, 8);
+			index.indexed_modification_time = static_cast<int64_t>(readValue(f, 8));
+			//A file rewritten in place with the same size still moves its records, so the time has to match as well
+			if (index.indexed_file_size != std::filesystem::file_size(gff_file, error) || index.indexed_modification_time != modificationTime(gff_file)) {
+				LOG(WARNING) << index_file.string() << " is older than " << gff_file.string() << ", ignoring it";
+				return std::nullopt;
+			}
+
+			const auto sequence_count = readValue(f, 4);
+			for (uint64_t s = 0; s < sequence_count && f; ++s) {
+				std::string sequence_id(readValue(f, 4), '\0');
+				f.read(sequence_id.data(), sequence_id.size());
+				auto& sequence = index.sequences[sequence_id];
+
+				const auto bin_count = readValue(f, 4);
+				for (uint64_t b = 0; b < bin_count && f; ++b) {
+					const auto bin = static_cast<uint32_t>(readValue(f, 4));
+					auto& bin_chunks = sequence.bins[bin];
+					bin_chunks.resize(readValue(f, 4));
+					for (auto& chunk : bin_chunks) {
+						chunk.begin = readValue(f, 8);
+						chunk.end = readValue(f, 8);
+					}
+				}
+
+				sequence.linear.resize(readValue(f, 4));
+				for (auto& offset : sequence.linear) {
+					offset = readValue(f, 8);
+				}
+			}
+
+			if (!f) {
+				LOG(WARNING) << index_file.string() << " is truncated, ignoring it";
+				return std::nullopt;
+			}
+			return index;
+		}
+
+		bool RegionIndex::save(const std::filesystem::path& gff_file) const
+		{
+			const auto index_file = indexPath(gff_file);
+			std::ofstream f{ index_file, std::ios::binary };
+			if (!f.is_open()) {
+				LOG(ERROR) << "Could not write " << index_file.string();
+				return false;
+			}
+
+			f.write(index_magic, sizeof(index_magic));
+			writeValue(f, indexed_file_size, 8);
+			writeValue(f, static_cast<uint64_t>(indexed_modification_time), 8);
+			writeValue(f, sequences.size(), 4);
+			for (const auto& [sequence_id, sequence] : sequences) {
+				writeValue(f, sequence_id.size(), 4);
+				f.write(sequence_id.data(), sequence_id.size());
+
+				writeValue(f, sequence.bins.size(), 4);
+				for (const auto& [bin, bin_chunks] : sequence.bins) {
+					writeValue(f, bin, 4);
+					writeValue(f, bin_chunks.size(), 4);
+					for (const auto& chunk : bin_chunks) {
+						writeValue(f, chunk.begin, 8);
+						writeValue(f, chunk.end, 8);
+					}
+				}
+
+				writeValue(f, sequence.linear.size(), 4);
+				for (const auto offset : sequence.linear) {
+					writeValue(f, offset, 8);
+				}
+			}
+			return static_cast<bool>(f);
+		}
+
+		std::vector<RegionIndex::Chunk> RegionIndex::chunks(const Region& region) const
+		{
+			const auto sequence = sequences.find(region.sequence_id);
+			if (sequence == std::end(sequences)) {
+				return {};
+			}
+
+			const auto beg = (std::min)(region.span.start, max_position - 1);
+			const auto end = (std::min)(region.span.end, max_position);
+			if (beg >= end) {
+				return {};
+			}
+
+			//Records that end before this offset cannot overlap the region
+			const auto& linear = sequence->second.linear;
+			io::VirtualOffset min_offset = 0;
+			if (!linear.empty()) {
+				min_offset = linear[(std::min)(static_cast<std::size_t>(beg >> linear_window_shift), linear.size() - 1)];
+			}
+
+			std::vector<Chunk> found;
+			for (const auto bin : regionToBins(beg, end)) {
+				const auto bin_chunks = sequence->second.bins.find(bin);
+				if (bin_chunks == std::end(sequence->second.bins)) {
+					continue;
+				}
+				for (const auto& chunk : bin_chunks->second) {
+					if (chunk.end > min_offset) {
+						found.push_back(chunk);
+					}
+				}
+			}
+
+			std::sort(std::begin(found), std::end(found), [](const auto& first, const auto& second) {
+				return first.begin < second.begin;
+			});
+			std::vector<Chunk> merged;
+			for (const auto& chunk : found) {
+				if (!merged.empty() && chunk.begin <= merged.back().end) {
+					merged.back().end = (std::max)(merged.back().end, chunk.end);
+				}
+				else {
+					merged.push_back(chunk);
+				}
+			}
+			return merged;
+		}
+
+		bool RegionIndex::contains(const std::string& sequence_id) const
+		{
+			return sequences.contains(sequence_id);
+		}
+	}
+}
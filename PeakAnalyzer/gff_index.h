@@ -0,0 +1,83 @@
+#ifndef BIOSCRIPTS_GFF_INDEX_H
+#define BIOSCRIPTS_GFF_INDEX_H
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "input.h"
+#include "region.h"
+
+namespace bioscripts
+{
+	namespace gff
+	{
+		/**
+		 * @brief  Tabix-style positional index over a coordinate-sorted, BGZF compressed GFF file.
+		 *
+		 * Every record is assigned to the smallest UCSC bin that contains it, and each bin keeps the ranges of
+		 * virtual file offsets ("chunks") its records occupy. A linear index additionally stores, for every 16 kb
+		 * window, the smallest virtual offset of any record overlapping that window, which lets a query skip the
+		 * chunks of large bins that lie entirely before the region.
+		 */
+		class RegionIndex
+		{
+		public:
+			struct Chunk
+			{
+				io::VirtualOffset begin;
+				io::VirtualOffset end;
+			};
+
+			/**
+			 * @brief  Largest coordinate the binning scheme can address (512 Mb).
+			 */
+			static constexpr Position max_position = Position{ 1 } << 29;
+
+			/**
+			 * @brief  Build the index by reading the whole @a gff_file once.
+			 * @return  The index, or an empty optional if the file is not BGZF compressed or not coordinate-sorted.
+			 */
+			static std::optional<RegionIndex> build(const std::filesystem::path& gff_file);
+
+			/**
+			 * @brief  Load the sidecar index of @a gff_file, if one exists and still matches the size and
+			 *		   modification time of the file.
+			 */
+			static std::optional<RegionIndex> load(const std::filesystem::path& gff_file);
+
+			/**
+			 * @brief  Write the index next to @a gff_file.
+			 */
+			bool save(const std::filesystem::path& gff_file) const;
+
+			/**
+			 * @brief  Find the sorted, non-overlapping chunks that may contain records overlapping @a region.
+			 */
+			std::vector<Chunk> chunks(const Region& region) const;
+
+			bool contains(const std::string& sequence_id) const;
+
+		private:
+			struct SequenceIndex
+			{
+				std::unordered_map<uint32_t, std::vector<Chunk>> bins;
+				std::vector<io::VirtualOffset> linear;
+			};
+
+			std::unordered_map<std::string, SequenceIndex> sequences;
+			uint64_t indexed_file_size = 0;
+			int64_t indexed_modification_time = 0;
+		};
+
+		/**
+		 * @brief  Location of the sidecar index belonging to @a gff_file.
+		 */
+		std::filesystem::path indexPath(const std::filesystem::path& gff_file);
+	}
+}
+
+#endif // !BIOSCRIPTS_GFF_INDEX_H
@@ -0,0 +1,161 @@
+#include <algorithm>
+#include <string_view>
+
+#include "hierarchy.h"
+
+#include "easylogging++.h"
+
+namespace
+{
+	/**
+	 * @brief  Value of the attribute @a name in the semicolon separated @a attributes, matching the whole name only.
+	 * @return  The value, or an empty view if the attribute is not present.
+	 */
+	std::string_view attributeValue(std::string_view attributes, std::string_view name)
+	{
+		while (!attributes.empty()) {
+			const auto end = (std::min)(attributes.find(';'), attributes.size());
+			const auto attribute = attributes.substr(0, end);
+			if (attribute.size() > name.size() && attribute.starts_with(name) && attribute[name.size()] == '=') {
+				return attribute.substr(name.size() + 1);
+			}
+			attributes.remove_prefix((std::min)(end + 1, attributes.size()));
+		}
+		return {};
+	}
+}
+
+namespace bioscripts
+{
+	namespace gff
+	{
+		Hierarchy::Hierarchy(const Records& records)
+		{
+			//Sequences are numbered in the order of their identifiers so the nodes do not depend on how they are hashed
+			std::vector<const std::string*> sequence_ids;
+			for (const auto& [sequence_id, sequence_records] : records) {
+				sequence_ids.push_back(&sequence_id);
+			}
+			std::sort(std::begin(sequence_ids), std::end(sequence_ids), [](const auto* first, const auto* second) {
+				return *first < *second;
+			});
+			for (const auto* sequence_id : sequence_ids) {
+				const auto& sequence_records = records.data(*sequence_id);
+				sequence_nodes.emplace(*sequence_id, SequenceNodes{ .first = static_cast<Node>(this->records.size()), .count = static_cast<Node>(sequence_records.size()) });
+				for (const auto& record : sequence_records) {
+					const auto id = attributeValue(record.attributes, "ID");
+					if (!id.empty()) {
+						ids.try_emplace(std::string{ id }, static_cast<Node>(this->records.size()));
+					}
+					this->records.push_back(&record);
+				}
+			}
+
+			std::size_t unresolved_count = 0;
+			std::vector<Node> child_counts(this->records.size(), 0);
+			parent_offsets.reserve(this->records.size() + 1);
+			parent_offsets.push_back(0);
+			for (const auto* record : this->records) {
+				auto parent_ids = attributeValue(record->attributes, "Parent");
+				while (!parent_ids.empty()) {
+					const auto end = (std::min)(parent_ids.find(','), parent_ids.size());
+					const auto parent = ids.find(std::string{ parent_ids.substr(0, end) });
+					if (parent != std::end(ids)) {
+						parent_nodes.push_back(parent->second);
+						++child_counts[parent->second];
+					}
+					else {
+						++unresolved_count;
+					}
+					parent_ids.remove_prefix((std::min)(end + 1, parent_ids.size()));
+				}
+				parent_offsets.push_back(static_cast<Node>(parent_nodes.size()));
+			}
+
+			//The children of every node start where those of the nodes before it end
+			child_offsets.reserve(this->records.size() + 1);
+			child_offsets.push_back(0);
+			for (const auto count : child_counts) {
+				child_offsets.push_back(child_offsets.back() + count);
+			}
+			child_nodes.resize(parent_nodes.size());
+			auto next_child = std::vector<Node>(std::begin(child_offsets), std::end(child_offsets) - 1);
+			for (Node node = 0; node < this->records.size(); ++node) {
+				for (const auto parent : parents(node)) {
+					child_nodes[next_child[parent]++] = node;
+				}
+			}
+
+			LOG(INFO) << "Linked " << this->records.size() << " records by " << parent_nodes.size() << " parent links";
+			if (unresolved_count > 0) {
+				LOG(WARNING) << unresolved_count << " parents are not among the loaded records";
+			}
+		}
+
+		std::optional<Hierarchy::Node> Hierarchy::node(const std::string& sequence_id, std::size_t record_index) const
+		{
+			const auto nodes = sequence_nodes.find(sequence_id);
+			if (nodes == std::end(sequence_nodes) || record_index >= nodes->second.count) {
+				return std::nullopt;
+			}
+			return static_cast<Node>(nodes->second.first + record_index);
+		}
+
+		std::optional<Hierarchy::Node> Hierarchy::find(const std::string& id) const
+		{
+			const auto found = ids.find(id);
+			if (found == std::end(ids)) {
+				return std::nullopt;
+			}
+			return found->second;
+		}
+
+		const Record& Hierarchy::record(Node node) const
+		{
+			return *records[node];
+		}
+
+		std::string_view Hierarchy::name(Node node) const
+		{
+			auto id = attributeValue(records[node]->attributes, "ID");
+			const auto prefix_end = id.find(':');
+			if (prefix_end != std::string_view::npos) {
+				id.remove_prefix(prefix_end + 1);
+			}
+			return id;
+		}
+
+		Hierarchy::Node Hierarchy::parent(Node node) const
+		{
+			return parent_offsets[node] == parent_offsets[node + 1] ? no_node : parent_nodes[parent_offsets[node]];
+		}
+
+		std::span<const Hierarchy::Node> Hierarchy::parents(Node node) const
+		{
+			return std::span{ parent_nodes }.subspan(parent_offsets[node], parent_offsets[node + 1] - parent_offsets[node]);
+		}
+
+		std::span<const Hierarchy::Node> Hierarchy::children(Node node) const
+		{
+			return std::span{ child_nodes }.subspan(child_offsets[node], child_offsets[node + 1] - child_offsets[node]);
+		}
+
+		Hierarchy::Node Hierarchy::ancestor(Node node, Record::Type type) const
+		{
+			//Every record is part of at most a gene and a transcript, so this takes a few steps at most. A malformed
+			//file could link records in a cycle, which the step limit guards against.
+			for (std::size_t steps = 0; node != no_node && steps <= records.size(); ++steps) {
+				if (records[node]->type == type) {
+					return node;
+				}
+				node = parent(node);
+			}
+			return no_node;
+		}
+
+		std::size_t Hierarchy::size() const
+		{
+			return records.size();
+		}
+	}
+}
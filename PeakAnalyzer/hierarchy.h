@@ -0,0 +1,106 @@
+#ifndef BIOSCRIPTS_HIERARCHY_H
+#define BIOSCRIPTS_HIERARCHY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "gff.h"
+
+namespace bioscripts
+{
+	namespace gff
+	{
+		/**
+		 * @brief  The gene models of a set of records: which records every record is part of, and which ones are part
+		 *		   of it, as given by their ID and Parent attributes.
+		 *
+		 * Every record is a node numbered from 0, and the links between them are resolved into node numbers once,
+		 * when the hierarchy is built. The parents and the children of all nodes are each stored back to back in one
+		 * array, with an array of offsets marking where the links of every node start, so looking them up is two
+		 * array reads without any string work. Parents that are not among the records, e.g. because their sequence
+		 * was not loaded, are left out. The records of every sequence get consecutive nodes, in the order of
+		 * Records::data().
+		 */
+		class Hierarchy
+		{
+		public:
+			using Node = uint32_t;
+			static constexpr Node no_node = (std::numeric_limits<Node>::max)();
+
+			/**
+			 * @brief  Link the records of @a records, which must outlive the hierarchy and not be changed while it exists.
+			 */
+			explicit Hierarchy(const Records& records);
+
+			/**
+			 * @brief  The node of record @a record_index of @a sequence_id, in the order of Records::data().
+			 * @return  The node, or an empty optional if there is no such record.
+			 */
+			std::optional<Node> node(const std::string& sequence_id, std::size_t record_index) const;
+
+			/**
+			 * @brief  The node of the first record whose ID attribute is @a id, e.g. "gene:AT1G01010".
+			 */
+			std::optional<Node> find(const std::string& id) const;
+
+			const Record& record(Node node) const;
+
+			/**
+			 * @brief  The ID attribute of @a node without its type prefix, e.g. "AT1G01010.1" for "transcript:AT1G01010.1".
+			 * @return  The identifier, or an empty view if the record has no ID.
+			 */
+			std::string_view name(Node node) const;
+
+			/**
+			 * @brief  The first parent of @a node, or no_node if it has none.
+			 */
+			Node parent(Node node) const;
+
+			/**
+			 * @brief  All parents of @a node, in the order of its Parent attribute.
+			 */
+			std::span<const Node> parents(Node node) const;
+
+			/**
+			 * @brief  The nodes whose Parent attribute names @a node, in the order of the records.
+			 */
+			std::span<const Node> children(Node node) const;
+
+			/**
+			 * @brief  The closest node of type @a type that @a node is part of, following first parents, or @a node itself
+			 *		   if it is of that type.
+			 * @return  The node, or no_node if none of its ancestors is of type @a type.
+			 */
+			Node ancestor(Node node, Record::Type type) const;
+
+			/**
+			 * @brief  Number of nodes, one per record.
+			 */
+			std::size_t size() const;
+
+		private:
+			struct SequenceNodes
+			{
+				Node first;
+				Node count;
+			};
+
+			std::vector<const Record*> records;
+			std::unordered_map<std::string, SequenceNodes> sequence_nodes;
+			std::unordered_map<std::string, Node> ids;
+			std::vector<Node> parent_offsets;
+			std::vector<Node> parent_nodes;
+			std::vector<Node> child_offsets;
+			std::vector<Node> child_nodes;
+		};
+	}
+}
+
+#endif // !BIOSCRIPTS_HIERARCHY_H
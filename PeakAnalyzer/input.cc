@@ -0,0 +1,565 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <zlib.h>
+
+#include "input.h"
+#include "parallel.h"
+
+#include "easylogging++.h"
+
+namespace
+{
+	constexpr std::size_t read_chunk_size = 1 << 20;
+	constexpr std::size_t gzip_output_chunk_size = 1 << 20;
+	constexpr std::size_t bgzf_blocks_per_worker = 16;
+	constexpr unsigned virtual_offset_shift = 16;
+	constexpr uint64_t virtual_offset_mask = (uint64_t{ 1 } << virtual_offset_shift) - 1;
+
+	//Every gzip member starts with these two bytes
+	constexpr unsigned char gzip_magic[] = { 0x1f, 0x8b };
+	constexpr unsigned char gzip_flag_extra = 0x04;
+	constexpr std::size_t gzip_fixed_header_size = 12; //Header up to and including XLEN
+	constexpr std::size_t gzip_trailer_size = 8; //CRC32 followed by ISIZE
+
+	uint16_t readLittleEndian16(const unsigned char* p)
+	{
+		return static_cast<uint16_t>(p[0] | (p[1] << 8));
+	}
+
+	uint32_t readLittleEndian32(const unsigned char* p)
+	{
+		return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+	}
+
+	/**
+	 * @brief  Find the total size of the BGZF block starting at @a header.
+	 *
+	 * A BGZF block is a gzip member whose extra field carries a "BC" subfield holding the block size minus one.
+	 * @a available must cover at least the fixed header and the extra field.
+	 * @return  The block size, or 0 if @a header is not the start of a BGZF block.
+	 */
+	std::size_t bgzfBlockSize(const unsigned char* header, std::size_t available)
+	{
+		if (available < gzip_fixed_header_size || header[0] != gzip_magic[0] || header[1] != gzip_magic[1] || !(header[3] & gzip_flag_extra)) {
+			return 0;
+		}
+
+		const auto extra_length = readLittleEndian16(header + 10);
+		if (available < gzip_fixed_header_size + extra_length) {
+			return 0;
+		}
+
+		const auto* subfield = header + gzip_fixed_header_size;
+		const auto* extra_end = subfield + extra_length;
+		while (subfield + 4 <= extra_end) {
+			const auto subfield_length = readLittleEndian16(subfield + 2);
+			if (subfield[0] == 'B' && subfield[1] == 'C' && subfield_length == 2 && subfield + 6 <= extra_end) {
+				return static_cast<std::size_t>(readLittleEndian16(subfield + 4)) + 1;
+			}
+			subfield += 4 + subfield_length;
+		}
+		return 0;
+	}
+
+	/**
+	 * @brief  Inflate a single, complete BGZF block into @a output.
+	 * @return  False if the block is corrupt.
+	 */
+	bool inflateBgzfBlock(const unsigned char* block, std::size_t block_size, std::string& output)
+	{
+		const auto extra_length = readLittleEndian16(block + 10);
+		const auto header_size = gzip_fixed_header_size + extra_length;
+		if (block_size < header_size + gzip_trailer_size) {
+			return false;
+		}
+
+		const auto expected_crc = readLittleEndian32(block + block_size - gzip_trailer_size);
+		const auto uncompressed_size = readLittleEndian32(block + block_size - 4);
+		output.resize(uncompressed_size);
+		if (uncompressed_size == 0) {
+			return true;
+		}
+
+		z_stream stream{};
+		if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+			return false;
+		}
+		stream.next_in = const_cast<Bytef*>(block + header_size);
+		stream.avail_in = static_cast<uInt>(block_size - header_size - gzip_trailer_size);
+		stream.next_out = reinterpret_cast<Bytef*>(output.data());
+		stream.avail_out = static_cast<uInt>(uncompressed_size);
+		const auto result = inflate(&stream, Z_FINISH);
+		inflateEnd(&stream);
+		if (result != Z_STREAM_END || stream.avail_out != 0) {
+			return false;
+		}
+
+		const auto actual_crc = crc32(crc32(0L, Z_NULL, 0), reinterpret_cast<const Bytef*>(output.data()), static_cast<uInt>(output.size()));
+		return actual_crc == expected_crc;
+	}
+}
+
+namespace bioscripts
+{
+	namespace io
+	{
+		struct LineReader::GzipState
+		{
+			z_stream stream{};
+			bool within_member = false; //Whether input of a member has been consumed without reaching its end
+
+			GzipState()
+			{
+				//Adding 32 to the window bits enables automatic gzip/zlib header detection
+				inflateInit2(&stream, MAX_WBITS + 32);
+			}
+
+			~GzipState()
+			{
+				inflateEnd(&stream);
+			}
+		};
+
+		bool isStdin(const std::filesystem::path& path)
+		{
+			return path == "-";
+		}
+
+		void prefetch(const std::filesystem::path& path)
+		{
+#if defined(__linux__)
+			if (isStdin(path)) {
+				return;
+			}
+			const auto fd = ::open(path.c_str(), O_RDONLY);
+			if (fd < 0) {
+				return;
+			}
+			//WILLNEED starts asynchronous readahead of the whole file; the pages stay cached after the descriptor is closed
+			::posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+			::close(fd);
+#else
+			(void)path;
+#endif
+		}
+
+		MappedFile::MappedFile(const std::filesystem::path& path)
+		{
+#ifdef _WIN32
+			const auto file = ::CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (file == INVALID_HANDLE_VALUE) {
+				return;
+			}
+			LARGE_INTEGER file_size;
+			if (::GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0) {
+				const auto mapping = ::CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+				if (mapping != nullptr) {
+					//The view keeps the mapping alive, so neither handle is needed once it exists
+					mapped = static_cast<const char*>(::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+					mapped_size = mapped != nullptr ? static_cast<std::size_t>(file_size.QuadPart) : 0;
+					::CloseHandle(mapping);
+				}
+			}
+			::CloseHandle(file);
+#else
+			const auto fd = ::open(path.c_str(), O_RDONLY);
+			if (fd < 0) {
+				return;
+			}
+			struct stat file_status;
+			if (::fstat(fd, &file_status) == 0 && file_status.st_size > 0) {
+				//The mapping stays valid after the descriptor is closed
+				auto* view = ::mmap(nullptr, static_cast<std::size_t>(file_status.st_size), PROT_READ, MAP_SHARED, fd, 0);
+				if (view != MAP_FAILED) {
+					mapped = static_cast<const char*>(view);
+					mapped_size = static_cast<std::size_t>(file_status.st_size);
+				}
+			}
+			::close(fd);
+#endif
+		}
+
+		MappedFile::~MappedFile()
+		{
+			unmap();
+		}
+
+		MappedFile::MappedFile(MappedFile&& other) noexcept : mapped(std::exchange(other.mapped, nullptr)), mapped_size(std::exchange(other.mapped_size, 0))
+		{
+		}
+
+		MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+		{
+			if (this != &other) {
+				unmap();
+				mapped = std::exchange(other.mapped, nullptr);
+				mapped_size = std::exchange(other.mapped_size, 0);
+			}
+			return *this;
+		}
+
+		bool MappedFile::is_open() const
+		{
+			return mapped != nullptr;
+		}
+
+		const char* MappedFile::data() const
+		{
+			return mapped;
+		}
+
+		std::size_t MappedFile::size() const
+		{
+			return mapped_size;
+		}
+
+		void MappedFile::unmap()
+		{
+			if (mapped == nullptr) {
+				return;
+			}
+#ifdef _WIN32
+			::UnmapViewOfFile(mapped);
+#else
+			::munmap(const_cast<char*>(mapped), mapped_size);
+#endif
+			mapped = nullptr;
+			mapped_size = 0;
+		}
+
+		LineReader::LineReader(const std::filesystem::path& path) : blocks_per_batch(bgzf_blocks_per_worker * helper::workerCount())
+		{
+			if (isStdin(path)) {
+#ifdef _WIN32
+				_setmode(_fileno(stdin), _O_BINARY);
+#endif
+				file = stdin;
+			}
+			else {
+#ifdef _WIN32
+				file = _wfopen(path.c_str(), L"rb");
+#else
+				file = std::fopen(path.c_str(), "rb");
+#endif
+				owns_file = true;
+			}
+
+			if (file == nullptr) {
+				LOG(ERROR) << "Could not open " << path.string();
+				return;
+			}
+#if defined(__linux__)
+			if (owns_file) {
+				//Files are read front to back, so a larger readahead window pays off
+				::posix_fadvise(fileno(file), 0, 0, POSIX_FADV_SEQUENTIAL);
+			}
+#endif
+
+			//Sniff the first bytes to decide how the rest of the input has to be decoded
+			ensureRaw(gzip_fixed_header_size);
+			const auto available = raw.size();
+			if (available >= 2 && raw[0] == gzip_magic[0] && raw[1] == gzip_magic[1]) {
+				if (available >= gzip_fixed_header_size) {
+					ensureRaw(gzip_fixed_header_size + readLittleEndian16(raw.data() + 10));
+				}
+				if (bgzfBlockSize(raw.data(), raw.size()) != 0) {
+					input_compression = Compression::Bgzf;
+				}
+				else {
+					input_compression = Compression::Gzip;
+					gzip = std::make_unique<GzipState>();
+				}
+			}
+		}
+
+		LineReader::~LineReader()
+		{
+			if (owns_file && file != nullptr) {
+				std::fclose(file);
+			}
+		}
+
+		bool LineReader::is_open() const
+		{
+			return file != nullptr;
+		}
+
+		Compression LineReader::compression() const
+		{
+			return input_compression;
+		}
+
+		bool LineReader::getline(std::string& line)
+		{
+			if (file == nullptr) {
+				return false;
+			}
+
+			auto search_from = text_position;
+			while (true) {
+				const auto line_end = text.find('\n', search_from);
+				if (line_end != std::string::npos) {
+					line.assign(text, text_position, line_end - text_position);
+					text_position = line_end + 1;
+					break;
+				}
+
+				const auto pending = text.size() - text_position;
+				if (!fill()) {
+					if (pending == 0) {
+						return false;
+					}
+					//Last line of the input without a trailing line break
+					line.assign(text, text_position, pending);
+					text_position = text.size();
+					break;
+				}
+				search_from = pending;
+			}
+
+			if (line.ends_with('\r')) {
+				line.pop_back();
+			}
+			return true;
+		}
+
+		bool LineReader::fill()
+		{
+			if (input_compression == Compression::Bgzf) {
+				//Forget the blocks that have been consumed completely; the partially consumed one is kept
+				const auto consumed = static_cast<std::ptrdiff_t>(text_position);
+				auto first_unconsumed = std::find_if(std::begin(blocks_in_text), std::end(blocks_in_text), [consumed](const auto& block) {
+					return block.text_start > consumed;
+				});
+				if (first_unconsumed != std::begin(blocks_in_text)) {
+					--first_unconsumed;
+				}
+				blocks_in_text.erase(std::begin(blocks_in_text), first_unconsumed);
+				for (auto& block : blocks_in_text) {
+					block.text_start -= consumed;
+				}
+			}
+			text.erase(0, text_position);
+			text_position = 0;
+
+			switch (input_compression) {
+			case Compression::None:
+				return fillPlain();
+			case Compression::Gzip:
+				return fillGzip();
+			case Compression::Bgzf:
+				return fillBgzf();
+			}
+			return false;
+		}
+
+		bool LineReader::ensureRaw(std::size_t bytes)
+		{
+			while (raw.size() - raw_position < bytes && !end_of_input) {
+				const auto old_size = raw.size();
+				const auto wanted = (std::max)(read_chunk_size, bytes - (old_size - raw_position));
+				raw.resize(old_size + wanted);
+				const auto bytes_read = std::fread(raw.data() + old_size, 1, wanted, file);
+				raw.resize(old_size + bytes_read);
+				if (bytes_read < wanted) {
+					end_of_input = true;
+				}
+			}
+			return raw.size() - raw_position >= bytes;
+		}
+
+		bool LineReader::fillPlain()
+		{
+			if (raw_position < raw.size()) {
+				//Bytes that were read while sniffing the compression
+				text.append(reinterpret_cast<const char*>(raw.data() + raw_position), raw.size() - raw_position);
+				raw.clear();
+				raw_position = 0;
+				return true;
+			}
+			if (end_of_input) {
+				return false;
+			}
+
+			const auto old_size = text.size();
+			text.resize(old_size + read_chunk_size);
+			const auto bytes_read = std::fread(text.data() + old_size, 1, read_chunk_size, file);
+			text.resize(old_size + bytes_read);
+			if (bytes_read < read_chunk_size) {
+				end_of_input = true;
+			}
+			return bytes_read != 0;
+		}
+
+		bool LineReader::fillGzip()
+		{
+			auto& stream = gzip->stream;
+			const auto old_size = text.size();
+			while (text.size() == old_size) {
+				if (raw_position == raw.size()) {
+					raw.clear();
+					raw_position = 0;
+					if (!ensureRaw(1)) {
+						if (gzip->within_member) {
+							throw std::runtime_error("Truncated gzip input");
+						}
+						return false;
+					}
+				}
+
+				const auto available_in = raw.size() - raw_position;
+				const auto output_start = text.size();
+				text.resize(output_start + gzip_output_chunk_size);
+				stream.next_in = raw.data() + raw_position;
+				stream.avail_in = static_cast<uInt>(available_in);
+				stream.next_out = reinterpret_cast<Bytef*>(text.data() + output_start);
+				stream.avail_out = static_cast<uInt>(gzip_output_chunk_size);
+
+				const auto result = inflate(&stream, Z_NO_FLUSH);
+				raw_position += available_in - stream.avail_in;
+				text.resize(output_start + gzip_output_chunk_size - stream.avail_out);
+
+				if (result == Z_STREAM_END) {
+					//Concatenated gzip members are decoded as a single stream
+					inflateReset(&stream);
+					gzip->within_member = false;
+				}
+				else if (result != Z_OK && result != Z_BUF_ERROR) {
+					throw std::runtime_error(std::string{ "Corrupt gzip input: " } + (stream.msg ? stream.msg : "unknown error"));
+				}
+				else {
+					gzip->within_member = true;
+				}
+			}
+			return true;
+		}
+
+		bool LineReader::fillBgzf()
+		{
+			//Compact once up front, so the block offsets collected below stay valid while more input is read
+			raw.erase(std::begin(raw), std::begin(raw) + raw_position);
+			raw_file_offset += raw_position;
+			raw_position = 0;
+
+			struct Block
+			{
+				std::size_t offset;
+				std::size_t size;
+			};
+			std::vector<Block> blocks;
+			while (blocks.size() < blocks_per_batch && ensureRaw(1)) {
+				const auto has_header = ensureRaw(gzip_fixed_header_size) && ensureRaw(gzip_fixed_header_size + readLittleEndian16(raw.data() + raw_position + 10));
+				const auto block_size = has_header ? bgzfBlockSize(raw.data() + raw_position, raw.size() - raw_position) : 0;
+				if (block_size == 0 || !ensureRaw(block_size)) {
+					throw std::runtime_error("Corrupt or truncated BGZF block at file offset " + std::to_string(raw_file_offset + raw_position));
+				}
+				blocks.push_back(Block{ .offset = raw_position, .size = block_size });
+				raw_position += block_size;
+			}
+
+			if (blocks.empty()) {
+				return false;
+			}
+
+			std::vector<std::string> decompressed(blocks.size());
+			std::vector<char> corrupt(blocks.size(), false);
+			helper::parallelFor(blocks.size(), [&](std::size_t i) {
+				corrupt[i] = !inflateBgzfBlock(raw.data() + blocks[i].offset, blocks[i].size, decompressed[i]);
+			});
+			const auto first_corrupt = std::find(std::begin(corrupt), std::end(corrupt), true);
+			if (first_corrupt != std::end(corrupt)) {
+				const auto& block = blocks[static_cast<std::size_t>(first_corrupt - std::begin(corrupt))];
+				throw std::runtime_error("Corrupt BGZF block at file offset " + std::to_string(raw_file_offset + block.offset));
+			}
+
+			const auto old_size = text.size();
+			for (std::size_t i = 0; i < blocks.size(); ++i) {
+				blocks_in_text.push_back(BlockPosition{ .text_start = static_cast<std::ptrdiff_t>(text.size()), .file_offset = raw_file_offset + blocks[i].offset });
+				text += decompressed[i];
+			}
+			next_block_file_offset = raw_file_offset + raw_position;
+
+			//Batches start small after a seek, so a region query only inflates the blocks it needs
+			blocks_per_batch = (std::min)(blocks_per_batch * 2, bgzf_blocks_per_worker * helper::workerCount());
+
+			//Empty blocks (e.g. the BGZF end-of-file marker) produce no text, so keep going until something is produced or the input ends
+			return text.size() != old_size || fillBgzf();
+		}
+
+		VirtualOffset LineReader::tell() const
+		{
+			//The last block whose text starts at or before the read position holds the next unread byte,
+			//unless the read position is the very end of that block, in which case it belongs to the next block
+			const auto position = static_cast<std::ptrdiff_t>(text_position);
+			for (auto it = std::rbegin(blocks_in_text); it != std::rend(blocks_in_text); ++it) {
+				if (it->text_start <= position) {
+					const auto next_text_start = (it == std::rbegin(blocks_in_text)) ? static_cast<std::ptrdiff_t>(text.size()) : std::prev(it)->text_start;
+					if (position < next_text_start) {
+						return (it->file_offset << virtual_offset_shift) | static_cast<uint64_t>(position - it->text_start);
+					}
+					break;
+				}
+			}
+			return next_block_file_offset << virtual_offset_shift;
+		}
+
+		bool LineReader::seek(VirtualOffset virtual_offset)
+		{
+			if (file == nullptr || input_compression != Compression::Bgzf || file == stdin) {
+				return false;
+			}
+
+			const auto file_offset = virtual_offset >> virtual_offset_shift;
+			const auto within_block = static_cast<std::ptrdiff_t>(virtual_offset & virtual_offset_mask);
+
+			const auto in_text = std::find_if(std::begin(blocks_in_text), std::end(blocks_in_text), [file_offset](const auto& block) {
+				return block.file_offset == file_offset;
+			});
+			if (in_text != std::end(blocks_in_text) && in_text->text_start + within_block >= 0) {
+				//The block is already decompressed, e.g. when consecutive chunks share a block
+				text_position = static_cast<std::size_t>(in_text->text_start + within_block);
+				return true;
+			}
+
+#ifdef _WIN32
+			const auto seek_result = _fseeki64(file, static_cast<__int64>(file_offset), SEEK_SET);
+#else
+			const auto seek_result = fseeko(file, static_cast<off_t>(file_offset), SEEK_SET);
+#endif
+			if (seek_result != 0) {
+				return false;
+			}
+			raw.clear();
+			raw_position = 0;
+			raw_file_offset = file_offset;
+			text.clear();
+			text_position = 0;
+			blocks_in_text.clear();
+			next_block_file_offset = file_offset;
+			end_of_input = false;
+			blocks_per_batch = 1;
+
+			if (!fill() || static_cast<std::size_t>(within_block) > text.size()) {
+				return false;
+			}
+			text_position = static_cast<std::size_t>(within_block);
+			return true;
+		}
+	}
+}
@@ -0,0 +1,158 @@
+#ifndef BIOSCRIPTS_INPUT_H
+#define BIOSCRIPTS_INPUT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace bioscripts
+{
+	namespace io
+	{
+		enum class Compression : uint8_t
+		{
+			None,
+			Gzip,
+			Bgzf
+		};
+
+		using VirtualOffset = uint64_t;
+
+		/**
+		 * @brief  Reads text line by line from a plain file, a gzip or BGZF compressed file, or stdin.
+		 *
+		 * The compression is detected from the first bytes of the input rather than from the file name,
+		 * so the same code path serves ".gff3", ".gff3.gz" and a pipe. A path of "-" reads from stdin.
+		 * BGZF input is decompressed a batch of blocks at a time, with the blocks of a batch inflated in parallel.
+		 */
+		class LineReader
+		{
+		public:
+			explicit LineReader(const std::filesystem::path& path);
+			~LineReader();
+
+			LineReader(const LineReader&) = delete;
+			LineReader& operator=(const LineReader&) = delete;
+
+			bool is_open() const;
+
+			Compression compression() const;
+
+			/**
+			 * @brief  Read the next line into @a line, without the trailing line break.
+			 * @return  False once the input is exhausted.
+			 * @throws  std::runtime_error if the compressed input is corrupt or truncated, rather than end the input early.
+			 */
+			bool getline(std::string& line);
+
+			/**
+			 * @brief  BGZF virtual offset of the next unread byte: the file offset of its block in the upper 48 bits
+			 *		   and the offset within the uncompressed block in the lower 16 bits.
+			 * @pre  compression() == Compression::Bgzf
+			 */
+			VirtualOffset tell() const;
+
+			/**
+			 * @brief  Continue reading from the BGZF @a virtual_offset, as previously returned by tell().
+			 * @pre  compression() == Compression::Bgzf and the input is a seekable file.
+			 * @return  False if the position could not be reached.
+			 * @throws  std::runtime_error if the block at @a virtual_offset is corrupt.
+			 */
+			bool seek(VirtualOffset virtual_offset);
+
+		private:
+			/**
+			 * @brief  Append more decompressed text to the line buffer.
+			 * @return  False if no more text could be produced.
+			 */
+			bool fill();
+			bool fillPlain();
+			bool fillGzip();
+			bool fillBgzf();
+
+			/**
+			 * @brief  Make sure at least @a bytes unconsumed compressed bytes are buffered, reading more if needed.
+			 */
+			bool ensureRaw(std::size_t bytes);
+
+			/**
+			 * @brief  Where a decompressed BGZF block starts in the text buffer and in the compressed file.
+			 *
+			 * The text start becomes negative once the beginning of a partially read block has been discarded.
+			 */
+			struct BlockPosition
+			{
+				std::ptrdiff_t text_start;
+				uint64_t file_offset;
+			};
+
+			std::FILE* file = nullptr;
+			bool owns_file = false;
+			bool end_of_input = false;
+			Compression input_compression = Compression::None;
+
+			std::vector<unsigned char> raw;
+			std::size_t raw_position = 0;
+			uint64_t raw_file_offset = 0; //Offset of raw[0] within the file
+
+			std::vector<BlockPosition> blocks_in_text;
+			uint64_t next_block_file_offset = 0;
+			std::size_t blocks_per_batch;
+
+			std::string text;
+			std::size_t text_position = 0;
+
+			struct GzipState;
+			std::unique_ptr<GzipState> gzip;
+		};
+
+		/**
+		 * @brief  Read-only memory mapping of a whole file.
+		 *
+		 * The pages are shared with every other process mapping the same file, so data laid out for direct use
+		 * (offsets rather than pointers) can be read in place without being copied into the process.
+		 */
+		class MappedFile
+		{
+		public:
+			MappedFile() = default;
+			explicit MappedFile(const std::filesystem::path& path);
+			~MappedFile();
+
+			MappedFile(MappedFile&& other) noexcept;
+			MappedFile& operator=(MappedFile&& other) noexcept;
+			MappedFile(const MappedFile&) = delete;
+			MappedFile& operator=(const MappedFile&) = delete;
+
+			bool is_open() const;
+
+			const char* data() const;
+
+			std::size_t size() const;
+
+		private:
+			void unmap();
+
+			const char* mapped = nullptr;
+			std::size_t mapped_size = 0;
+		};
+
+		/**
+		 * @brief  Returns true if @a path names stdin rather than a file.
+		 */
+		bool isStdin(const std::filesystem::path& path);
+
+		/**
+		 * @brief  Ask the operating system to start reading @a path into the page cache in the background.
+		 *
+		 * This is only a hint: it returns immediately, and does nothing for stdin or on platforms without posix_fadvise.
+		 */
+		void prefetch(const std::filesystem::path& path);
+	}
+}
+
+#endif // !BIOSCRIPTS_INPUT_H
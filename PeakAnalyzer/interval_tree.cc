@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <numeric>
+#include <optional>
+
+#include "interval_tree.h"
+
+namespace
+{
+	/**
+	 * @brief  Distance from @a position to the closest base of @a span.
+	 */
+	bioscripts::Distance distanceTo(bioscripts::Position position, const bioscripts::Range& span)
+	{
+		if (span.end <= position) {
+			return position - (span.end - 1);
+		}
+		if (span.start > position) {
+			return span.start - position;
+		}
+		return 0;
+	}
+}
+
+namespace bioscripts
+{
+	IntervalTree::IntervalTree(std::vector<Interval> intervals) : intervals(std::move(intervals))
+	{
+		std::stable_sort(std::begin(this->intervals), std::end(this->intervals), [](const Interval& first, const Interval& second) {
+			return first.span.start < second.span.start;
+		});
+
+		const auto n = this->intervals.size();
+		by_end.resize(n);
+		std::iota(std::begin(by_end), std::end(by_end), std::size_t{ 0 });
+		std::stable_sort(std::begin(by_end), std::end(by_end), [this](std::size_t first, std::size_t second) {
+			return this->intervals[first].span.end < this->intervals[second].span.end;
+		});
+
+		subtree_ends.resize(n);
+		if (n == 0) {
+			return;
+		}
+
+		//Leaves sit at the even indices. The last node of every level may lack a right subtree within the array,
+		//so the largest end of the nodes past it is carried up separately.
+		std::size_t last_node = 0;
+		Position last_end = 0;
+		for (std::size_t i = 0; i < n; i += 2) {
+			last_node = i;
+			last_end = subtree_ends[i] = this->intervals[i].span.end;
+		}
+
+		int level = 1;
+		for (; (std::size_t{ 1 } << level) <= n; ++level) {
+			const std::size_t half = std::size_t{ 1 } << (level - 1);
+			const std::size_t first_node = (half << 1) - 1;
+			const std::size_t step = half << 2;
+			for (auto i = first_node; i < n; i += step) {
+				const auto left_end = subtree_ends[i - half];
+				const auto right_end = i + half < n ? subtree_ends[i + half] : last_end;
+				subtree_ends[i] = (std::max)({ this->intervals[i].span.end, left_end, right_end });
+			}
+			last_node = (last_node >> level & 1) ? last_node - half : last_node + half;
+			if (last_node < n) {
+				last_end = (std::max)(last_end, subtree_ends[last_node]);
+			}
+		}
+		root_level = level - 1;
+	}
+
+	std::vector<std::size_t> IntervalTree::overlapping(const Range& query) const
+	{
+		std::vector<std::size_t> ids;
+		overlapping(query, ids);
+		return ids;
+	}
+
+	void IntervalTree::overlapping(const Range& query, std::vector<std::size_t>& ids) const
+	{
+		const auto n = intervals.size();
+		if (n == 0) {
+			return;
+		}
+
+		struct Node
+		{
+			std::size_t index;
+			int level;
+			bool left_done;
+		};
+		//The tree is at most 64 levels deep, and at most two nodes per level are waiting at any time
+		Node pending[128];
+		int pending_count = 0;
+		pending[pending_count++] = Node{ (std::size_t{ 1 } << root_level) - 1, root_level, false };
+
+		while (pending_count > 0) {
+			const auto node = pending[--pending_count];
+			if (node.level <= 3) {
+				//Small subtrees are scanned in order rather than descended into
+				const auto first = node.index >> node.level << node.level;
+				const auto last = (std::min)(first + (std::size_t{ 1 } << (node.level + 1)) - 1, n);
+				for (auto i = first; i < last && intervals[i].span.start < query.end; ++i) {
+					if (query.start < intervals[i].span.end) {
+						ids.push_back(intervals[i].id);
+					}
+				}
+			}
+			else if (!node.left_done) {
+				const auto left = node.index - (std::size_t{ 1 } << (node.level - 1));
+				pending[pending_count++] = Node{ node.index, node.level, true };
+				//A left child past the end of the array still has nodes of its own within it
+				if (left >= n || subtree_ends[left] > query.start) {
+					pending[pending_count++] = Node{ left, node.level - 1, false };
+				}
+			}
+			else if (node.index < n && intervals[node.index].span.start < query.end) {
+				if (query.start < intervals[node.index].span.end) {
+					ids.push_back(intervals[node.index].id);
+				}
+				pending[pending_count++] = Node{ node.index + (std::size_t{ 1 } << (node.level - 1)), node.level - 1, false };
+			}
+		}
+	}
+
+	std::vector<std::size_t> IntervalTree::overlapping(Position position) const
+	{
+		return overlapping(Range{ position, position + 1 });
+	}
+
+	std::vector<NearbyInterval> IntervalTree::nearest(Position position, std::size_t k, Distance max_distance) const
+	{
+		std::vector<NearbyInterval> neighbours;
+		if (k == 0) {
+			return neighbours;
+		}
+
+		//Every interval either contains the position, ends at or before it, or starts after it
+		for (const auto id : overlapping(position)) {
+			if (neighbours.size() == k) {
+				return neighbours;
+			}
+			neighbours.push_back(NearbyInterval{ .id = id, .distance = 0 });
+		}
+
+		auto upstream = std::partition_point(std::begin(by_end), std::end(by_end), [&](std::size_t i) {
+			return intervals[i].span.end <= position;
+		}) - std::begin(by_end);
+		auto downstream = std::partition_point(std::begin(intervals), std::end(intervals), [&](const Interval& interval) {
+			return interval.span.start <= position;
+		}) - std::begin(intervals);
+
+		//Both sides are ordered by distance already, so the closer of their next intervals is the next neighbour
+		while (neighbours.size() < k) {
+			std::optional<Distance> upstream_distance;
+			if (upstream > 0) {
+				upstream_distance = distanceTo(position, intervals[by_end[upstream - 1]].span);
+			}
+			std::optional<Distance> downstream_distance;
+			if (static_cast<std::size_t>(downstream) < intervals.size()) {
+				downstream_distance = distanceTo(position, intervals[downstream].span);
+			}
+
+			if (upstream_distance && *upstream_distance <= max_distance && (!downstream_distance || *upstream_distance <= *downstream_distance)) {
+				--upstream;
+				neighbours.push_back(NearbyInterval{ .id = intervals[by_end[upstream]].id, .distance = *upstream_distance });
+			}
+			else if (downstream_distance && *downstream_distance <= max_distance) {
+				neighbours.push_back(NearbyInterval{ .id = intervals[downstream].id, .distance = *downstream_distance });
+				++downstream;
+			}
+			else {
+				break;
+			}
+		}
+		return neighbours;
+	}
+
+	std::size_t IntervalTree::size() const
+	{
+		return intervals.size();
+	}
+}
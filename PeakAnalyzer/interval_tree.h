@@ -0,0 +1,83 @@
+#ifndef BIOSCRIPTS_INTERVAL_TREE_H
+#define BIOSCRIPTS_INTERVAL_TREE_H
+
+#include <cstddef>
+#include <vector>
+
+#include "range.h"
+
+namespace bioscripts
+{
+	/**
+	 * @brief  A range tagged with the identifier of whatever it belongs to, e.g. the index of a GFF record.
+	 */
+	struct Interval
+	{
+		Range span;
+		std::size_t id;
+	};
+
+	/**
+	 * @brief  An interval found near a position, with its distance to that position.
+	 */
+	struct NearbyInterval
+	{
+		std::size_t id;
+		Distance distance;
+	};
+
+	/**
+	 * @brief  Static index answering which intervals overlap a range, or lie closest to a position, in O(log n + k).
+	 *
+	 * The intervals are kept sorted by start in one array, which doubles as an implicit balanced binary tree: the
+	 * node at index i lies on the level given by the number of trailing one bits of i, and every node stores the
+	 * largest end in its subtree. A query only descends into subtrees whose largest end reaches the query, so
+	 * long intervals do not make short queries scan everything that starts before them. A second array orders the
+	 * intervals by end, so the intervals upstream of a position can be visited closest first as well.
+	 */
+	class IntervalTree
+	{
+	public:
+		IntervalTree() = default;
+		explicit IntervalTree(std::vector<Interval> intervals);
+
+		/**
+		 * @brief  Find all intervals overlapping @a query.
+		 * @return  Their identifiers, ordered by the start of their interval and then by the order they were given in.
+		 */
+		std::vector<std::size_t> overlapping(const Range& query) const;
+
+		/**
+		 * @brief  Append the identifiers of all intervals overlapping @a query to @a ids, in the same order, so a caller
+		 *		   making many queries can reuse one buffer for all of them.
+		 */
+		void overlapping(const Range& query, std::vector<std::size_t>& ids) const;
+
+		/**
+		 * @brief  Find all intervals containing @a position.
+		 */
+		std::vector<std::size_t> overlapping(Position position) const;
+
+		/**
+		 * @brief  Find the @a k intervals closest to @a position and no further than @a max_distance from it.
+		 *
+		 * An interval containing @a position is at distance 0, any other interval is as far away as its base closest
+		 * to @a position. Of two intervals at the same distance the upstream one comes first.
+		 * @return  The intervals found, closest first.
+		 */
+		std::vector<NearbyInterval> nearest(Position position, std::size_t k, Distance max_distance) const;
+
+		/**
+		 * @brief  Return the number of intervals held.
+		 */
+		std::size_t size() const;
+
+	private:
+		std::vector<Interval> intervals;
+		std::vector<Position> subtree_ends;
+		std::vector<std::size_t> by_end; //Positions in intervals, ordered by the end of their interval
+		int root_level = 0;
+	};
+}
+
+#endif // !BIOSCRIPTS_INTERVAL_TREE_H
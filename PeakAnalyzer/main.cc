@@ -1,21 +1,40 @@
+#include "annotation.h"
+#include "batch.h"
+#include "columnar.h"
+#include "columnar_writer.h"
+#include "context.h"
+#include "coordinate_map.h"
+#include "fasta.h"
 #include "gff.h"
+#include "gff_index.h"
+#include "hierarchy.h"
+#include "input.h"
+#include "metagene.h"
+#include "normalized.h"
+#include "parallel.h"
 #include "peak.h"
+#include "peak_merge.h"
+#include "record_image.h"
+#include "region.h"
+#include "results_cache.h"
+#include "server.h"
+#include "shard.h"
+#include "translation.h"
 
+#include <array>
+#include <exception>
 #include <filesystem>
 #include <fstream>
+#include <future>
 #include <iostream>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 #include "easylogging++.h"
 INITIALIZE_EASYLOGGINGPP
 
-struct TranscriptData
-{
-	std::size_t id;
-	std::size_t start_pos;
-	std::size_t end_pos;
-	std::string transcript_id;
-};
-
 namespace
 {
 	void configureLogger(bool debug_enabled)
@@ -27,17 +46,142 @@ namespace
 			default_logging.set(el::Level::Debug, el::ConfigurationType::Filename, "debug.log");
 			default_logging.set(el::Level::Debug, el::ConfigurationType::ToStandardOutput, "false");
 		}
+		else {
+			default_logging.set(el::Level::Debug, el::ConfigurationType::Enabled, "false");
+		}
 		default_logging.set(el::Level::Info, el::ConfigurationType::ToStandardOutput, "false");
 		default_logging.set(el::Level::Info, el::ConfigurationType::Filename, "peaks.log");
 		default_logging.set(el::Level::Info, el::ConfigurationType::Format, "%datetime %level %msg");
 		el::Loggers::reconfigureLogger("default", default_logging);
 	}
 
-	void writeOutputFile(const std::filesystem::path& output_file, const std::vector<TranscriptData>& data) {
+	void writeOutputFile(const std::filesystem::path& output_file, const std::vector<bioscripts::annotation::TranscriptData>& data) {
 		std::ofstream of;
 		of.open(output_file);
-		for (const auto& elem : data) {
-			of << elem.id << "\t" << elem.transcript_id << "\t" << elem.start_pos << "\t" << elem.end_pos << "\n";
+		bioscripts::annotation::write(of, data);
+	}
+
+	struct Options
+	{
+		std::vector<std::string> positional;
+		std::vector<bioscripts::Region> regions;
+		std::filesystem::path socket = bioscripts::server::defaultSocketPath();
+		std::optional<std::filesystem::path> shared_image; //Empty path for the default location
+		std::optional<std::filesystem::path> fasta;
+		bioscripts::annotation::Settings settings;
+		bioscripts::context::Precedence precedence;
+		bool cache = false;
+		bool normalized = false;
+		bool binary = false;
+		bool coding_positions = false;
+		bool collapse_isoforms = false;
+		std::size_t processes = 1;
+		std::size_t bins = 100;
+		bioscripts::Distance gap = 0;
+		std::size_t shard = 0;
+		std::size_t shard_count = 0;
+	};
+
+	/**
+	 * @brief  Write the annotations of a run to @a output_file, or in the layout chosen by --normalized or --binary.
+	 * @return  The number of rows of the legacy layout, whichever one was written, or an empty optional if the
+	 *		    --normalized or --binary files could not be written.
+	 */
+	std::optional<std::size_t> writeAnnotations(const std::filesystem::path& output_file, const std::vector<bioscripts::annotation::PeakAnnotation>& annotations, const Options& options)
+	{
+		if (!options.normalized) {
+			const auto data_to_write = bioscripts::annotation::flatten(annotations);
+			if (!options.binary) {
+				writeOutputFile(output_file, data_to_write);
+			}
+			else if (!bioscripts::columnar::write(bioscripts::columnar::binaryPath(output_file), data_to_write)) {
+				std::cerr << "Could not write " << bioscripts::columnar::binaryPath(output_file).string() << "\n";
+				return std::nullopt;
+			}
+			return data_to_write.size();
+		}
+
+		const auto normalized_annotations = bioscripts::normalized::normalize(annotations);
+		const auto transcripts_file = bioscripts::normalized::transcriptsPath(output_file);
+		const auto references_file = bioscripts::normalized::referencesPath(output_file);
+		if (!bioscripts::normalized::write(transcripts_file, references_file, normalized_annotations)) {
+			std::cerr << "Could not write " << transcripts_file.string() << " and " << references_file.string() << "\n";
+			return std::nullopt;
+		}
+		std::size_t row_count = 0;
+		for (const auto& reference : normalized_annotations.references) {
+			row_count += normalized_annotations.transcripts[reference.transcript_number].size();
+		}
+		return row_count;
+	}
+
+
+	/**
+	 * @brief  Write where every peak lies relative to the 5' end of each of its transcripts to @a distances_file.
+	 */
+	void writeDistancesFile(const std::filesystem::path& distances_file, const std::vector<bioscripts::annotation::PeakAnnotation>& annotations, const std::vector<std::vector<std::optional<bioscripts::annotation::SignedDistance>>>& distances)
+	{
+		std::ofstream of{ distances_file };
+		bioscripts::annotation::writeDistances(of, annotations, distances);
+	}
+
+
+	/**
+	 * @brief  Write where the midpoint of every peak lies within the coding sequence of each of its transcripts to
+	 *		   @a positions_file.
+	 */
+	void writePositionsFile(const std::filesystem::path& positions_file, const bioscripts::peak::Peaks& peaks, const std::vector<bioscripts::annotation::PeakAnnotation>& annotations, const bioscripts::gff::Records& records)
+	{
+		const bioscripts::coordinates::CoordinateMap map{ records };
+		std::ofstream of{ positions_file };
+		bioscripts::coordinates::write(of, annotations, bioscripts::coordinates::peakPositions(peaks, annotations, map));
+	}
+
+
+	/**
+	 * @brief  Write the spliced coding sequence of every transcript in @a annotations to @a cds_file and its translation
+	 *		   to @a proteins_file, each once and in the order they are first hit, and the codon and amino acid under the
+	 *		   midpoint of every peak to @a codons_file.
+	 */
+	void writeCodingSequenceFiles(const std::filesystem::path& cds_file, const std::filesystem::path& proteins_file, const std::filesystem::path& codons_file, const bioscripts::peak::Peaks& peaks, const std::vector<bioscripts::annotation::PeakAnnotation>& annotations, const bioscripts::fasta::IndexedFasta& genome, const bioscripts::gff::Records& records)
+	{
+		const bioscripts::coordinates::CoordinateMap map{ records };
+		bioscripts::fasta::CodingSequenceCache coding_sequences{ genome, map };
+		std::unordered_set<std::size_t> written;
+		std::ofstream cds_of{ cds_file };
+		std::ofstream proteins_of{ proteins_file };
+		for (const auto& annotation : annotations) {
+			for (const auto& coding_sequence : annotation) {
+				const auto& transcript_id = coding_sequence.front().transcript_id;
+				const auto transcript = map.find(transcript_id);
+				if (!transcript || !written.insert(*transcript).second) {
+					continue;
+				}
+				if (const auto* bases = coding_sequences.get(*transcript)) {
+					bioscripts::fasta::write(cds_of, transcript_id, *bases);
+					bioscripts::fasta::write(proteins_of, transcript_id, bioscripts::translation::translate(*bases, bioscripts::translation::geneticCodeOf(transcript_id)));
+				}
+			}
+		}
+		LOG(INFO) << "Extracted the coding sequences of " << coding_sequences.size() << " transcripts";
+
+		const auto positions = bioscripts::coordinates::peakPositions(peaks, annotations, map);
+		std::ofstream codons_of{ codons_file };
+		std::size_t peak_id = 0;
+		for (std::size_t i = 0; i < annotations.size(); ++i) {
+			for (std::size_t t = 0; t < annotations[i].size(); ++t) {
+				const auto& transcript_id = annotations[i][t].front().transcript_id;
+				codons_of << peak_id++ << "\t" << transcript_id << "\t";
+				const auto& position = positions[i][t];
+				const auto* bases = position ? coding_sequences.get(*map.find(transcript_id)) : nullptr;
+				const auto codon_start = position ? position->codon * bioscripts::coordinates::codon_length : 0;
+				if (bases == nullptr || codon_start + bioscripts::coordinates::codon_length > bases->size()) {
+					codons_of << "-\t-\t-\n";
+					continue;
+				}
+				const auto codon = std::string_view{ *bases }.substr(codon_start, bioscripts::coordinates::codon_length);
+				codons_of << position->codon << "\t" << codon << "\t" << bioscripts::translation::translateCodon(codon, bioscripts::translation::geneticCodeOf(transcript_id)) << "\n";
+			}
 		}
 	}
 
@@ -48,96 +192,916 @@ namespace
 	};
 
 
-}
+	void printUsage(const char* program)
+	{
+		std::cerr << "Usage: " << program << " [options] [peaks_file] [gff_file]\n";
+		std::cerr << "       " << program << " index [gff_file]\n";
+		std::cerr << "       " << program << " batch [options] [manifest_file] [gff_file]\n";
+		std::cerr << "       " << program << " shard --shard I --shards N [options] [peaks_file] [gff_file]\n";
+		std::cerr << "       " << program << " merge [partial_file...]\n";
+		std::cerr << "       " << program << " context [--precedence LIST] [--region SEQ[:START[-END]]] [peaks_file] [gff_file]\n";
+		std::cerr << "       " << program << " metagene [--bins N] [--precedence LIST] [--region SEQ[:START[-END]]] [peaks_file] [gff_file]\n";
+		std::cerr << "       " << program << " merge-peaks [--gap N] [options] [peaks_file...] [gff_file]\n";
+		std::cerr << "       " << program << " expand [transcripts_file] [references_file]\n";
+		std::cerr << "       " << program << " to-tsv [binary_file]\n";
+		std::cerr << "       " << program << " serve [--socket PATH] [gff_file]\n";
+		std::cerr << "       " << program << " client [--socket PATH] [peaks_file]\n";
+		std::cerr << "Either file may be gzip or BGZF compressed, and one of them may be \"-\" to read from stdin.\n";
+		std::cerr << "Options:\n";
+		std::cerr << "  --region SEQ[:START[-END]]  Only analyse peaks in this region, may be given more than once\n";
+		std::cerr << "  --span                      Match CDS records against the whole peak span instead of its midpoint\n";
+		std::cerr << "  --min-overlap F             As --span, only counting CDS records that cover at least the fraction F of the peak\n";
+		std::cerr << "  --strand same|opposite      Only match CDS records on the same or the opposite strand as the peak, and write the\n";
+		std::cerr << "                              signed distance of every peak to the 5' end of its transcripts to transcript_distances.txt\n";
+		std::cerr << "  --any-gene-within N         Give peaks left without transcripts the CDS of any gene under their midpoint,\n";
+		std::cerr << "                              or else the closest one if it is at most N bases away\n";
+		std::cerr << "  --collapse-isoforms         Annotate against the union of the CDS records of all isoforms of a gene, written as\n";
+		std::cerr << "                              the single transcript GENE." << bioscripts::gff::collapsed_version << "\n";
+		std::cerr << "  --cds-positions             Write the offset of every peak midpoint into the spliced coding sequence of each of\n";
+		std::cerr << "                              its transcripts, with the codon and the base within it, to transcript_positions.txt\n";
+		std::cerr << "  --fasta PATH                Write the spliced coding sequence of every transcript that a peak was assigned to\n";
+		std::cerr << "                              to transcript_cds.fa, read from the genome at PATH and its samtools faidx index,\n";
+		std::cerr << "                              its translation to transcript_proteins.fa, and the codon and amino acid under every\n";
+		std::cerr << "                              peak midpoint to transcript_codons.txt\n";
+		std::cerr << "  --cache                     Keep the results in a cache next to the output and only annotate peaks missing from it\n";
+		std::cerr << "  --normalized                Write each transcript once to transcript_data.transcripts.txt and the peak ids\n";
+		std::cerr << "                              referring to them to transcript_data.peaks.txt instead of transcript_data.txt\n";
+		std::cerr << "  --binary                    Write transcript_data.bin, a memory mappable column store, instead of transcript_data.txt\n";
+		std::cerr << "  --processes N               Split the run by sequence across N worker processes\n";
+		std::cerr << "  --shared                    Annotate against a shared memory image of the GFF records, building it if needed\n";
+		std::cerr << "  --shared-image PATH         As --shared, with the image at PATH instead of " << bioscripts::gff::defaultImagePath("[gff_file]").parent_path().string() << "\n";
+		std::cerr << "The index command writes a positional index next to a coordinate-sorted, bgzip compressed GFF file,\n";
+		std::cerr << "which is then used automatically to read only the parts of the file a run needs.\n";
+		std::cerr << "The batch command annotates every peak file listed in the manifest, one per line and optionally followed\n";
+		std::cerr << "by a tab and its output file, against a single load of the GFF file.\n";
+		std::cerr << "The shard command annotates the peaks of one of N groups of sequences and writes a partial output,\n";
+		std::cerr << "which the merge command combines into the transcript_data.txt of a single run once all shards are done.\n";
+		std::cerr << "The context command writes the feature every peak midpoint lies in (5UTR, CDS, 3UTR, exon, intron or\n";
+		std::cerr << "intergenic) and its transcript to peak_context.txt. Where features overlap, the first in the comma separated\n";
+		std::cerr << "--precedence LIST wins, followed by the others in the default order CDS,5UTR,3UTR,exon,intron.\n";
+		std::cerr << "The metagene command places the peak midpoints in the 5UTR, CDS or 3UTR found by the context command along\n";
+		std::cerr << "the spliced length of that feature, and writes how many fall into each of N bins per feature (100 by default)\n";
+		std::cerr << "to metagene.txt.\n";
+		std::cerr << "The merge-peaks command merges the peaks of replicate peak files that lie on the same sequence and strand, are\n";
+		std::cerr << "called for the same gene and overlap or are at most N bases apart (0 by default), and annotates the merged peaks.\n";
+		std::cerr << "The expand command turns the output of a --normalized run back into transcript_data.txt.\n";
+		std::cerr << "The to-tsv command turns the output of a --binary run back into transcript_data.txt.\n";
+		std::cerr << "The serve command keeps the GFF records in memory and annotates the peak files that client commands send\n";
+		std::cerr << "to it over a Unix domain socket, " << bioscripts::server::defaultSocketPath().string() << " by default.\n";
+	}
+
+	std::optional<Options> parseArguments(int argc, char* argv[], int first_argument)
+	{
+		Options options;
+		for (int i = first_argument; i < argc; ++i) {
+			const std::string_view argument = argv[i];
+			if (argument == "--region" && i + 1 < argc) {
+				auto region = bioscripts::parseRegion(argv[++i]);
+				if (!region) {
+					std::cerr << "Invalid region \"" << argv[i] << "\"\n";
+					return std::nullopt;
+				}
+				options.regions.push_back(std::move(*region));
+			}
+			else if (argument == "--span") {
+				options.settings.query = bioscripts::annotation::Query::Span;
+			}
+			else if (argument == "--min-overlap" && i + 1 < argc) {
+				try {
+					options.settings.minimum_overlap = std::stod(argv[++i]);
+				}
+				catch (const std::logic_error&) {
+					options.settings.minimum_overlap = -1;
+				}
+				if (!(options.settings.minimum_overlap >= 0 && options.settings.minimum_overlap <= 1)) {
+					std::cerr << "Invalid fraction \"" << argv[i] << "\" for " << argument << ", it must be between 0 and 1\n";
+					return std::nullopt;
+				}
+				options.settings.query = bioscripts::annotation::Query::Span;
+			}
+			else if (argument == "--strand" && i + 1 < argc) {
+				const std::string_view strand = argv[++i];
+				if (strand != "same" && strand != "opposite") {
+					std::cerr << "Invalid strand \"" << strand << "\" for " << argument << ", it must be same or opposite\n";
+					return std::nullopt;
+				}
+				options.settings.strand = strand == "same" ? bioscripts::annotation::StrandFilter::Same : bioscripts::annotation::StrandFilter::Opposite;
+			}
+			else if (argument == "--precedence" && i + 1 < argc) {
+				auto precedence = bioscripts::context::Precedence::parse(argv[++i]);
+				if (!precedence) {
+					std::cerr << "Invalid feature order \"" << argv[i] << "\" for " << argument << ", it must list distinct features out of 5UTR, CDS, 3UTR, exon and intron\n";
+					return std::nullopt;
+				}
+				options.precedence = *precedence;
+			}
+			else if (argument == "--cache") {
+				options.cache = true;
+			}
+			else if (argument == "--normalized") {
+				options.normalized = true;
+			}
+			else if (argument == "--fasta" && i + 1 < argc) {
+				options.fasta = argv[++i];
+			}
+			else if (argument == "--collapse-isoforms") {
+				options.collapse_isoforms = true;
+			}
+			else if (argument == "--cds-positions") {
+				options.coding_positions = true;
+			}
+			else if (argument == "--binary") {
+				options.binary = true;
+			}
+			else if (argument == "--shared") {
+				if (!options.shared_image) {
+					options.shared_image.emplace();
+				}
+			}
+			else if (argument == "--shared-image" && i + 1 < argc) {
+				options.shared_image = argv[++i];
+			}
+			else if (argument == "--any-gene-within" && i + 1 < argc) {
+				try {
+					options.settings.any_gene_within = std::stoull(argv[++i]);
+				}
+				catch (const std::logic_error&) {
+					std::cerr << "Invalid number \"" << argv[i] << "\" for " << argument << "\n";
+					return std::nullopt;
+				}
+			}
+			else if ((argument == "--processes" || argument == "--shard" || argument == "--shards" || argument == "--bins" || argument == "--gap") && i + 1 < argc) {
+				std::size_t value = 0;
+				try {
+					value = std::stoull(argv[++i]);
+				}
+				catch (const std::logic_error&) {
+					std::cerr << "Invalid number \"" << argv[i] << "\" for " << argument << "\n";
+					return std::nullopt;
+				}
+				if (argument == "--bins" && value == 0) {
+					std::cerr << "There must be at least one bin per feature\n";
+					return std::nullopt;
+				}
+				if (argument == "--processes") {
+					options.processes = value;
+				}
+				else if (argument == "--shard") {
+					options.shard = value;
+				}
+				else if (argument == "--shards") {
+					options.shard_count = value;
+				}
+				else if (argument == "--bins") {
+					options.bins = value;
+				}
+				else if (argument == "--gap") {
+					options.gap = value;
+				}
+			}
+			else if (argument == "--socket" && i + 1 < argc) {
+				options.socket = argv[++i];
+			}
+			else if (argument.starts_with("--")) {
+				std::cerr << "Unknown option " << argument << "\n";
+				return std::nullopt;
+			}
+			else {
+				options.positional.emplace_back(argument);
+			}
+		}
+		return options;
+	}
 
+	bioscripts::peak::Peaks loadPeaks(const std::filesystem::path& peaks_file, const std::vector<bioscripts::Region>& regions)
+	{
+		LOG(INFO) << "Parsing peak file";
+		auto peaks = bioscripts::peak::Peaks{ peaks_file };
+		if (regions.empty()) {
+			return peaks;
+		}
 
-int main(int argc, char* argv[])
-{
-	if (argc != 3) {
-		std::cerr << "Unknown arguments deteced.\n";
-		std::cerr << "Usage: " << argv[0] << " [peaks_file] [gff_file]\n";
-		return 1;
+		bioscripts::peak::Peaks peaks_in_regions;
+		for (const auto& peak : peaks) {
+			auto isInRegion = [&peak](const auto& region) {
+				return bioscripts::overlap(region, peak.sequence_id, peak.span);
+			};
+			if (std::any_of(std::begin(regions), std::end(regions), isInRegion)) {
+				peaks_in_regions.add(peak);
+			}
+		}
+		LOG(INFO) << peaks_in_regions.size() << " of " << peaks.size() << " peaks are within the requested regions";
+		return peaks_in_regions;
 	}
 
-	configureLogger(true);
-	auto gff_file = argv[2];
-	auto gff_records = bioscripts::gff::Records{ gff_file };
-	//We are only interested in CDS records because we want to reconsitute the protein-coding parts and nothing else
-	auto cds_gff_records = bioscripts::gff::fetchRecords(gff_records, bioscripts::gff::Record::Type::CDS);
+	int buildIndex(const std::filesystem::path& gff_file)
+	{
+		LOG(INFO) << "Building positional index of " << gff_file.string();
+		const auto index = bioscripts::gff::RegionIndex::build(gff_file);
+		if (!index || !index->save(gff_file)) {
+			std::cerr << "Failed to index " << gff_file.string() << ", see peaks.log for details\n";
+			return 1;
+		}
+		std::cout << "Wrote " << bioscripts::gff::indexPath(gff_file).string() << "\n";
+		return 0;
+	}
 
-	LOG(INFO) << "Parsing peak file";
-	auto peaks_file = argv[1];
-	auto peaks = bioscripts::peak::Peaks{ peaks_file };
+	/**
+	 * @brief  Annotate the peaks against the shared record image of @a gff_file, which many concurrent runs can use
+	 *		   without each of them parsing and holding a copy of the records.
+	 */
+	int annotateWithImage(const std::filesystem::path& peaks_file, const std::filesystem::path& gff_file, const std::filesystem::path& image_file, const Options& options)
+	{
+		bioscripts::io::prefetch(peaks_file);
+		auto peaks_loading = std::async(std::launch::async, [&]() {
+			return loadPeaks(peaks_file, options.regions);
+		});
 
+		const auto image = bioscripts::gff::RecordImage::attachOrBuild(image_file, gff_file);
+		if (!image) {
+			std::cerr << "Could not attach to or build the record image " << image_file.string() << ", see peaks.log for details\n";
+			return 1;
+		}
+		const auto peaks = peaks_loading.get();
 
-	std::vector<TranscriptData> data_to_write;
-	LOG(INFO) << "Analysing peaks";
-	std::size_t peak_id = 0;
-	const auto total_nr_of_peaks = peaks.size();
-	for (const auto& peak : peaks)
+		LOG(INFO) << "Analysing peaks";
+		const auto annotations = bioscripts::annotation::annotate(peaks, *image, options.settings);
+		const auto rows_written = writeAnnotations("transcript_data.txt", annotations, options);
+		if (!rows_written) {
+			return 1;
+		}
+		std::cout << "Data to write: " << *rows_written << "\n";
+		if (options.settings.strand != bioscripts::annotation::StrandFilter::Any) {
+			writeDistancesFile("transcript_distances.txt", annotations, bioscripts::annotation::fivePrimeDistances(peaks, annotations, *image));
+		}
+		return 0;
+	}
+
+	/**
+	 * @brief  Keep only the CDS records of @a gff_records, collapsed into one transcript per gene with --collapse-isoforms.
+	 */
+	bioscripts::gff::Records codingRecords(bioscripts::gff::Records gff_records, const Options& options)
+	{
+		if (options.collapse_isoforms) {
+			return bioscripts::gff::collapseIsoforms(gff_records);
+		}
+		return bioscripts::gff::fetchRecords(std::move(gff_records), bioscripts::gff::Record::Type::CDS);
+	}
+
+	int serveRecords(const std::filesystem::path& gff_file, const Options& options)
+	{
+		LOG(INFO) << "Parsing GFF records to serve";
+		auto gff_records = bioscripts::gff::Records{ gff_file };
+		if (gff_records.size() == 0) {
+			std::cerr << "No GFF records could be read from " << gff_file.string() << "\n";
+			return 1;
+		}
+		//Only CDS records are ever looked at, and keeping just those makes every request cheaper
+		const auto cds_gff_records = codingRecords(std::move(gff_records), options);
+		std::cout << "Serving " << gff_file.string() << " on " << options.socket.string() << "\n";
+		return bioscripts::server::serve(options.socket, cds_gff_records, options.settings);
+	}
+
+	int sendPeaks(const std::filesystem::path& peaks_file, const std::filesystem::path& socket)
 	{
-		if (peak_id % 1000 == 0) {
-			LOG(DEBUG) << "Analysing peak " << peak_id << "\\" << total_nr_of_peaks;
+		std::string request;
+		if (bioscripts::io::isStdin(peaks_file)) {
+			bioscripts::io::LineReader f{ peaks_file };
+			std::string peak_table;
+			std::string line;
+			while (f.getline(line)) {
+				peak_table += line;
+				peak_table += '\n';
+			}
+			request = bioscripts::server::inlinePeaksRequest(peak_table);
+		}
+		else {
+			//The server resolves the path, and it need not share the working directory of the client
+			std::error_code error;
+			request = bioscripts::server::peakFileRequest(std::filesystem::absolute(peaks_file, error));
+		}
+
+		const auto reply = bioscripts::server::query(socket, request);
+		if (!reply) {
+			std::cerr << "Could not reach a server on " << socket.string() << ", see peaks.log for details\n";
+			return 1;
+		}
+		if (!reply->success) {
+			std::cerr << "The server could not annotate " << peaks_file.string() << ": " << reply->content << "\n";
+			return 1;
+		}
+
+		std::cout << "Data to write: " << reply->row_count << "\n";
+		std::ofstream of{ "transcript_data.txt", std::ios::binary };
+		of << reply->content;
+		return 0;
+	}
+
+	/**
+	 * @brief  Load the GFF records needed to annotate peaks on @a sequence_ids, restricted to @a regions if any are given.
+	 *
+	 * With a positional index only the indexed byte ranges of the wanted sequences or regions are read, which requires
+	 * waiting for @a sequence_ids. Otherwise the whole file is scanned and the lines of other sequences are skipped as soon
+	 * as @a sequence_ids is known.
+	 */
+	bioscripts::gff::Records loadRecords(const std::filesystem::path& gff_file, const std::optional<bioscripts::gff::RegionIndex>& index, std::shared_future<std::unordered_set<std::string>> sequence_ids, std::vector<bioscripts::Region> regions)
+	{
+		if (index) {
+			if (regions.empty()) {
+				for (const auto& sequence_id : sequence_ids.get()) {
+					regions.push_back(bioscripts::Region{ .sequence_id = sequence_id, .span = bioscripts::Range{ 0, bioscripts::gff::RegionIndex::max_position } });
+				}
+			}
+			LOG(INFO) << "Reading GFF records of " << regions.size() << " regions through the positional index";
+			auto records = bioscripts::gff::Records{ gff_file, *index, regions };
+
+			//Genes and transcripts crossing a region boundary are only partially covered by it, so every region
+			//is widened to the features it overlaps and read again, until the features read no longer stick out
+			while (bioscripts::gff::widenToFeatures(regions, records)) {
+				records = bioscripts::gff::Records{ gff_file, *index, regions };
+			}
+			return records;
 		}
 
-		auto midpoint = bioscripts::peak::midpoint(peak);
-		LOG(DEBUG) << "Analysing peak with gene ID: " << peak.associated_identifier.to_string() << ", midpoint at " << midpoint;
+		if (!regions.empty()) {
+			LOG(WARNING) << "No positional index found for " << gff_file.string() << ", parsing the whole sequences of the requested regions";
+		}
+		LOG(INFO) << "Parsing GFF records of the sequences that carry peaks";
+		return bioscripts::gff::Records{ gff_file, sequence_ids };
+	}
 
-		auto records_under_the_peak = gff_records.getRecordsAt(midpoint, peak.sequence_id, bioscripts::gff::Record::Type::CDS);
+	/**
+	 * @brief  Annotate only the peaks whose results are not in the cache next to the output yet, and splice in the
+	 *		   cached results for the others.
+	 *
+	 * Only the GFF records of the sequences carrying uncached peaks are loaded, and none at all if every peak is
+	 * cached. The cache is then rewritten to hold exactly the peaks of this run.
+	 */
+	int annotateWithCache(const std::filesystem::path& peaks_file, const std::filesystem::path& gff_file, const Options& options)
+	{
+		const std::filesystem::path output_file = "transcript_data.txt";
+		const auto fingerprint = bioscripts::cache::annotationFingerprint(gff_file);
+		if (!fingerprint) {
+			std::cerr << "Cannot cache the results for " << gff_file.string() << ", it must be a regular file.\n";
+			return 1;
+		}
 
-		//Remove those whose identifier is different from the called peak identifier
-		auto recordIdentifierDoesNotMatchPeakIdentifier = [&peak](const auto& elem)
-		{
-			return peak.associated_identifier != bioscripts::Identifier<bioscripts::Transcript>{ bioscripts::gff::extractAttribute(elem, "ID=CDS") };
-		};
-		std::erase_if(records_under_the_peak, recordIdentifierDoesNotMatchPeakIdentifier);
-		LOG(DEBUG) << records_under_the_peak.size() << " GFF records found under the peak";
+		bioscripts::io::prefetch(peaks_file);
+		auto peaks_loading = std::async(std::launch::async, [&]() {
+			return loadPeaks(peaks_file, options.regions);
+		});
+		const auto cache_file = bioscripts::cache::cachePath(output_file);
+		const auto cache = bioscripts::cache::ResultsCache::load(cache_file, *fingerprint, options.settings);
+		const auto peaks = peaks_loading.get();
 
-		//If there are no records underneath the peak midpoint, find the closest record instead
+		std::vector<bioscripts::annotation::PeakAnnotation> annotations(peaks.size());
+		bioscripts::peak::Peaks uncached_peaks;
+		std::vector<std::size_t> uncached_indices;
+		std::size_t peak_index = 0;
+		for (const auto& peak : peaks) {
+			if (const auto* cached = cache.find(peak)) {
+				annotations[peak_index] = *cached;
+			}
+			else {
+				uncached_peaks.add(peak);
+				uncached_indices.push_back(peak_index);
+			}
+			++peak_index;
+		}
+		LOG(INFO) << peaks.size() - uncached_peaks.size() << " of " << peaks.size() << " peaks have cached results";
 
-		if (records_under_the_peak.empty()) {
-			auto closest_record = gff_records.findClosestRecord(midpoint, peak.sequence_id, peak.associated_identifier, bioscripts::gff::Record::Type::CDS);
+		if (uncached_peaks.size() > 0) {
+			std::promise<std::unordered_set<std::string>> uncached_sequence_ids;
+			uncached_sequence_ids.set_value(bioscripts::peak::sequenceIds(uncached_peaks));
+			auto gff_records = loadRecords(gff_file, bioscripts::gff::RegionIndex::load(gff_file), uncached_sequence_ids.get_future().share(), options.regions);
+			const auto cds_gff_records = codingRecords(std::move(gff_records), options);
 
-			if (closest_record == nullptr) {
-				continue;
+			LOG(INFO) << "Analysing peaks";
+			auto fresh_annotations = bioscripts::annotation::annotate(uncached_peaks, cds_gff_records, options.settings);
+			for (std::size_t i = 0; i < uncached_indices.size(); ++i) {
+				annotations[uncached_indices[i]] = std::move(fresh_annotations[i]);
 			}
-			LOG(DEBUG) << "Closest record to peak has attributes " << closest_record->attributes;
+		}
 
-			auto all_cds_records = bioscripts::gff::collectCodingSequenceRecords(*closest_record, gff_records);
-			LOG(DEBUG) << "Writing all CDS records belonging to the same gene as peak";
-			LOG(DEBUG) << "Peak ID: " << peak_id;
-			for (const auto& rec : all_cds_records) {
-				LOG(DEBUG) << "Record attribute: " << rec.attributes;
-				data_to_write.push_back(TranscriptData{
-					.id = peak_id,
-					.start_pos = rec.start(),
-					.end_pos = rec.end(),
-					.transcript_id = bioscripts::gff::extractAttribute(rec, "ID=CDS")
-					});
+		const auto rows_written = writeAnnotations(output_file, annotations, options);
+		if (!rows_written) {
+			return 1;
+		}
+		std::cout << "Data to write: " << *rows_written << " (" << uncached_peaks.size() << " of " << peaks.size() << " peaks annotated)\n";
+
+		bioscripts::cache::ResultsCache updated_cache{ *fingerprint, options.settings };
+		peak_index = 0;
+		for (const auto& peak : peaks) {
+			updated_cache.insert(peak, std::move(annotations[peak_index++]));
+		}
+		if (!updated_cache.save(cache_file)) {
+			std::cerr << "Could not update the results cache " << cache_file.string() << "\n";
+		}
+		return 0;
+	}
+
+	/**
+	 * @brief  Annotate the peaks on the sequences of @a shard and write them to @a partial_file.
+	 *
+	 * Only the GFF records of the shard's sequences are loaded. All peaks are read to number them the same way
+	 * as a single run would, which the merge relies on.
+	 */
+	int annotateShard(const std::filesystem::path& peaks_file, const std::filesystem::path& gff_file, const Options& options, std::size_t shard, std::size_t shard_count, const std::filesystem::path& partial_file)
+	{
+		const auto all_peaks = loadPeaks(peaks_file, options.regions);
+		auto sequence_ids = std::move(bioscripts::shard::assignSequences(all_peaks, shard_count)[shard]);
+
+		bioscripts::shard::ShardAnnotations shard_annotations{ .shard = shard, .shard_count = shard_count, .total_peak_count = all_peaks.size(), .peak_indices = {}, .annotations = {} };
+		bioscripts::peak::Peaks shard_peaks;
+		std::size_t peak_index = 0;
+		for (const auto& peak : all_peaks) {
+			if (sequence_ids.contains(peak.sequence_id)) {
+				shard_peaks.add(peak);
+				shard_annotations.peak_indices.push_back(peak_index);
 			}
-			++peak_id;
+			++peak_index;
 		}
-		else {
-			for (auto& record : records_under_the_peak) {
-				auto all_cds_records = bioscripts::gff::collectCodingSequenceRecords(record, gff_records);
-				LOG(DEBUG) << "Writing all CDS records belonging to the same gene as peak";
-				LOG(DEBUG) << "Peak ID: " << peak_id;
-				for (const auto& rec : all_cds_records) {
-					LOG(DEBUG) << "Record attribute: " << rec.attributes;
+		LOG(INFO) << "Shard " << shard << " of " << shard_count << " holds " << shard_peaks.size() << " peaks on " << sequence_ids.size() << " sequences";
 
-					data_to_write.push_back(TranscriptData{
-						.id = peak_id,
-						.start_pos = rec.start(),
-						.end_pos = rec.end(),
-						.transcript_id = bioscripts::gff::extractAttribute(rec, "ID=CDS")
-						});
+		//An empty filter would load every sequence, but a shard without sequences has nothing to annotate
+		if (!sequence_ids.empty()) {
+			std::promise<std::unordered_set<std::string>> shard_sequence_ids;
+			shard_sequence_ids.set_value(std::move(sequence_ids));
+			auto gff_records = loadRecords(gff_file, bioscripts::gff::RegionIndex::load(gff_file), shard_sequence_ids.get_future().share(), options.regions);
+			const auto cds_gff_records = codingRecords(std::move(gff_records), options);
+			shard_annotations.annotations = bioscripts::annotation::annotate(shard_peaks, cds_gff_records, options.settings);
+		}
+
+		if (!bioscripts::shard::writePartial(partial_file, shard_annotations)) {
+			std::cerr << "Could not write " << partial_file.string() << "\n";
+			return 1;
+		}
+		std::cout << "Shard " << shard << " of " << shard_count << ": " << shard_peaks.size() << " peaks, written to " << partial_file.string() << "\n";
+		return 0;
+	}
+
+	/**
+	 * @brief  Load the peaks together with all GFF records of the sequences carrying them, not only the CDS records.
+	 */
+	std::pair<bioscripts::peak::Peaks, bioscripts::gff::Records> loadPeaksAndRecords(const std::filesystem::path& peaks_file, const std::filesystem::path& gff_file, const Options& options)
+	{
+		auto peaks = loadPeaks(peaks_file, options.regions);
+		std::promise<std::unordered_set<std::string>> peak_sequence_ids;
+		peak_sequence_ids.set_value(bioscripts::peak::sequenceIds(peaks));
+		auto gff_records = loadRecords(gff_file, bioscripts::gff::RegionIndex::load(gff_file), peak_sequence_ids.get_future().share(), options.regions);
+		return { std::move(peaks), std::move(gff_records) };
+	}
+
+	/**
+	 * @brief  Write the feature that the midpoint of every peak lies in to @a output_file, looking at the UTR, CDS
+	 *		   and exon records of the sequences carrying peaks instead of only their CDS records.
+	 */
+	int classifyPeaks(const std::filesystem::path& peaks_file, const std::filesystem::path& gff_file, const Options& options, const std::filesystem::path& output_file)
+	{
+		const auto [peaks, gff_records] = loadPeaksAndRecords(peaks_file, gff_file, options);
+
+		LOG(INFO) << "Classifying peaks";
+		const bioscripts::gff::Hierarchy hierarchy{ gff_records };
+		const bioscripts::context::ContextIndex index{ gff_records, hierarchy };
+		const auto contexts = index.classify(peaks, options.precedence);
+		std::ofstream of{ output_file };
+		bioscripts::context::write(of, peaks, contexts);
+
+		std::array<std::size_t, bioscripts::context::feature_count> peak_counts{};
+		for (const auto& context : contexts) {
+			++peak_counts[static_cast<std::size_t>(context.feature)];
+		}
+		std::cout << "Data to write: " << contexts.size() << "\n";
+		for (const auto feature : options.precedence.order()) {
+			std::cout << "  " << bioscripts::context::name(feature) << ": " << peak_counts[static_cast<std::size_t>(feature)] << "\n";
+		}
+		return 0;
+	}
+
+	/**
+	 * @brief  Write the metagene profile of the peaks to @a output_file.
+	 */
+	int profilePeaks(const std::filesystem::path& peaks_file, const std::filesystem::path& gff_file, const Options& options, const std::filesystem::path& output_file)
+	{
+		const auto [peaks, gff_records] = loadPeaksAndRecords(peaks_file, gff_file, options);
+
+		LOG(INFO) << "Profiling peaks";
+		const bioscripts::gff::Hierarchy hierarchy{ gff_records };
+		const bioscripts::context::ContextIndex index{ gff_records, hierarchy };
+		const bioscripts::metagene::FeatureMaps maps{ gff_records, hierarchy };
+		const auto profile = bioscripts::metagene::profile(peaks, index, maps, options.bins, options.precedence);
+		std::ofstream of{ output_file };
+		bioscripts::metagene::write(of, profile);
+		std::cout << "Data to write: " << profile.counts.size() << " bins of " << peaks.size() - profile.unprofiled << " peaks, "
+			<< profile.unprofiled << " peaks lie outside every 5UTR, CDS and 3UTR\n";
+		return 0;
+	}
+
+	/**
+	 * @brief  Merge the peaks of the replicate @a peaks_files into consensus peaks and annotate those, without writing
+	 *		   the merged peaks out in between.
+	 */
+	int annotateMergedPeaks(const std::vector<std::string>& peaks_files, const std::filesystem::path& gff_file, const Options& options)
+	{
+		std::vector<bioscripts::peak::Peaks> replicates(peaks_files.size());
+		helper::parallelFor(peaks_files.size(), [&](std::size_t i) {
+			replicates[i] = loadPeaks(peaks_files[i], options.regions);
+		});
+		const auto peaks = bioscripts::peak::merge(replicates, options.gap);
+
+		std::promise<std::unordered_set<std::string>> peak_sequence_ids;
+		peak_sequence_ids.set_value(bioscripts::peak::sequenceIds(peaks));
+		auto gff_records = loadRecords(gff_file, bioscripts::gff::RegionIndex::load(gff_file), peak_sequence_ids.get_future().share(), options.regions);
+		const auto cds_gff_records = codingRecords(std::move(gff_records), options);
+
+		LOG(INFO) << "Analysing peaks";
+		const auto annotations = bioscripts::annotation::annotate(peaks, cds_gff_records, options.settings);
+		const auto rows_written = writeAnnotations("transcript_data.txt", annotations, options);
+		if (!rows_written) {
+			return 1;
+		}
+		std::cout << "Merged peaks: " << peaks.size() << "\n";
+		std::cout << "Data to write: " << *rows_written << "\n";
+		if (options.settings.strand != bioscripts::annotation::StrandFilter::Any) {
+			writeDistancesFile("transcript_distances.txt", annotations, bioscripts::annotation::fivePrimeDistances(peaks, annotations, cds_gff_records));
+		}
+		return 0;
+	}
+
+	int expandNormalized(const std::filesystem::path& transcripts_file, const std::filesystem::path& references_file, const std::filesystem::path& output_file)
+	{
+		const auto normalized_annotations = bioscripts::normalized::read(transcripts_file, references_file);
+		const auto data_to_write = normalized_annotations ? bioscripts::normalized::expand(*normalized_annotations) : std::nullopt;
+		if (!data_to_write) {
+			std::cerr << "Could not expand " << transcripts_file.string() << " and " << references_file.string() << ", see peaks.log for details\n";
+			return 1;
+		}
+		std::cout << "Data to write: " << data_to_write->size() << "\n";
+		writeOutputFile(output_file, *data_to_write);
+		return 0;
+	}
+
+	int convertToTsv(const std::filesystem::path& binary_file, const std::filesystem::path& output_file)
+	{
+		const auto columns = bioscripts::columnar::MappedColumns::open(binary_file);
+		if (!columns) {
+			std::cerr << binary_file.string() << " is not a binary output of this machine\n";
+			return 1;
+		}
+		std::cout << "Data to write: " << (*columns)->size() << "\n";
+		std::ofstream of{ output_file };
+		bioscripts::columnar::writeTsv(of, **columns);
+		return 0;
+	}
+
+	int mergePartials(const std::vector<std::string>& partial_files, const std::filesystem::path& output_file)
+	{
+		const auto rows_written = bioscripts::shard::merge({ std::begin(partial_files), std::end(partial_files) }, output_file);
+		if (!rows_written) {
+			std::cerr << "Could not merge the partial outputs, see peaks.log for details\n";
+			return 1;
+		}
+		std::cout << "Data to write: " << *rows_written << "\n";
+		return 0;
+	}
+
+	/**
+	 * @brief  Split the run by sequence over @a options.processes worker processes and merge their partial outputs.
+	 */
+	int annotateInProcesses(const std::filesystem::path& peaks_file, const std::filesystem::path& gff_file, const Options& options)
+	{
+		const std::filesystem::path output_file = "transcript_data.txt";
+		const auto shard_count = options.processes;
+		const auto result = bioscripts::shard::runInProcesses(shard_count, [&](std::size_t shard) {
+			return annotateShard(peaks_file, gff_file, options, shard, shard_count, bioscripts::shard::partialPath(output_file, shard, shard_count));
+		});
+		if (result != 0) {
+			std::cerr << "Not every worker process succeeded, see peaks.log for details\n";
+			return result;
+		}
+
+		std::vector<std::string> partial_files;
+		for (std::size_t shard = 0; shard < shard_count; ++shard) {
+			partial_files.push_back(bioscripts::shard::partialPath(output_file, shard, shard_count).string());
+		}
+		const auto merged = mergePartials(partial_files, output_file);
+		std::error_code error;
+		for (const auto& partial_file : partial_files) {
+			std::filesystem::remove(partial_file, error);
+		}
+		return merged;
+	}
+
+	/**
+	 * @brief  Annotate every sample listed in @a manifest_file against a single load of @a gff_file.
+	 *
+	 * The peak files are read in parallel while the GFF records of all the sequences they need are loaded, then the
+	 * peaks of all samples are annotated together and every sample is written to its own output file.
+	 */
+	int annotateBatch(const std::filesystem::path& manifest_file, const std::filesystem::path& gff_file, const Options& options)
+	{
+		const auto samples = bioscripts::batch::readManifest(manifest_file);
+		if (!samples) {
+			std::cerr << "Could not read the samples listed in " << manifest_file.string() << ", see peaks.log for details\n";
+			return 1;
+		}
+		if (options.shared_image && bioscripts::io::isStdin(gff_file)) {
+			std::cerr << "A shared record image cannot be built from stdin.\n";
+			return 1;
+		}
+		LOG(INFO) << "Annotating a batch of " << samples->size() << " samples";
+
+		const auto index = options.shared_image ? std::nullopt : bioscripts::gff::RegionIndex::load(gff_file);
+		for (const auto& sample : *samples) {
+			bioscripts::io::prefetch(sample.peaks_file);
+		}
+		if (!index && !options.shared_image) {
+			bioscripts::io::prefetch(gff_file);
+		}
+
+		std::promise<std::unordered_set<std::string>> peak_sequence_ids;
+		auto peaks_loading = std::async(std::launch::async, [&]() {
+			try {
+				std::vector<bioscripts::peak::Peaks> all_peaks(samples->size());
+				helper::parallelFor(samples->size(), [&](std::size_t i) {
+					all_peaks[i] = loadPeaks((*samples)[i].peaks_file, options.regions);
+				});
+				std::unordered_set<std::string> sequence_ids;
+				for (const auto& peaks : all_peaks) {
+					sequence_ids.merge(bioscripts::peak::sequenceIds(peaks));
 				}
-				++peak_id;
+				peak_sequence_ids.set_value(std::move(sequence_ids));
+				return all_peaks;
+			}
+			catch (...) {
+				//loadRecords waits for the sequence ids, it has to learn that they never come
+				peak_sequence_ids.set_exception(std::current_exception());
+				throw;
 			}
+		});
+
+		std::vector<std::vector<bioscripts::annotation::PeakAnnotation>> annotations;
+		if (options.shared_image) {
+			const auto image_file = options.shared_image->empty() ? bioscripts::gff::defaultImagePath(gff_file) : *options.shared_image;
+			const auto image = bioscripts::gff::RecordImage::attachOrBuild(image_file, gff_file);
+			if (!image) {
+				std::cerr << "Could not attach to or build the record image " << image_file.string() << ", see peaks.log for details\n";
+				return 1;
+			}
+			const auto all_peaks = peaks_loading.get();
+			LOG(INFO) << "Analysing peaks";
+			annotations = bioscripts::annotation::annotate(all_peaks, *image, options.settings);
+		}
+		else {
+			auto gff_records = loadRecords(gff_file, index, peak_sequence_ids.get_future().share(), options.regions);
+			const auto cds_gff_records = codingRecords(std::move(gff_records), options);
+			const auto all_peaks = peaks_loading.get();
+			LOG(INFO) << "Analysing peaks";
+			annotations = bioscripts::annotation::annotate(all_peaks, cds_gff_records, options.settings);
 		}
-		LOG(DEBUG) << "Increased peak identifier number by 1";
 
+		std::vector<std::size_t> rows_written(samples->size());
+		helper::parallelFor(samples->size(), [&](std::size_t i) {
+			const auto data_to_write = bioscripts::annotation::flatten(annotations[i]);
+			writeOutputFile((*samples)[i].output_file, data_to_write);
+			rows_written[i] = data_to_write.size();
+		});
+		for (std::size_t i = 0; i < samples->size(); ++i) {
+			std::cout << "Data to write for " << (*samples)[i].peaks_file.string() << ": " << rows_written[i] << ", written to " << (*samples)[i].output_file.string() << "\n";
+		}
+		return 0;
 	}
-	std::cout << "Data to write: " << data_to_write.size() << "\n";
-	writeOutputFile("transcript_data.txt", data_to_write);
-}
\ No newline at end of file
+}
+
+
+int main(int argc, char* argv[])
+{
+	const std::string_view command = argc > 1 ? argv[1] : "";
+	if (argc == 3 && command == "index") {
+		configureLogger(true);
+		return buildIndex(argv[2]);
+	}
+	if (command == "serve" || command == "client") {
+		const auto options = parseArguments(argc, argv, 2);
+		if (!options || options->positional.size() != 1 || !options->regions.empty()) {
+			std::cerr << "Unknown arguments deteced.\n";
+			printUsage(argv[0]);
+			return 1;
+		}
+		//Debug logging of every peak would serialise the concurrent requests on the log file
+		configureLogger(false);
+		if (command == "serve") {
+			return serveRecords(options->positional[0], *options);
+		}
+		return sendPeaks(options->positional[0], options->socket);
+	}
+
+	if (command == "merge") {
+		const auto options = parseArguments(argc, argv, 2);
+		if (!options || options->positional.empty()) {
+			std::cerr << "Unknown arguments deteced.\n";
+			printUsage(argv[0]);
+			return 1;
+		}
+		configureLogger(true);
+		return mergePartials(options->positional, "transcript_data.txt");
+	}
+
+	if (command == "to-tsv") {
+		const auto options = parseArguments(argc, argv, 2);
+		if (!options || options->positional.size() != 1) {
+			std::cerr << "Unknown arguments deteced.\n";
+			printUsage(argv[0]);
+			return 1;
+		}
+		configureLogger(true);
+		return convertToTsv(options->positional[0], "transcript_data.txt");
+	}
+
+	if (command == "context" || command == "metagene") {
+		const auto options = parseArguments(argc, argv, 2);
+		if (!options || options->positional.size() != 2) {
+			std::cerr << "Unknown arguments deteced.\n";
+			printUsage(argv[0]);
+			return 1;
+		}
+		if (bioscripts::io::isStdin(options->positional[0]) && bioscripts::io::isStdin(options->positional[1])) {
+			std::cerr << "Only one of the input files can be read from stdin.\n";
+			return 1;
+		}
+		configureLogger(true);
+		if (command == "metagene") {
+			return profilePeaks(options->positional[0], options->positional[1], *options, "metagene.txt");
+		}
+		return classifyPeaks(options->positional[0], options->positional[1], *options, "peak_context.txt");
+	}
+
+	if (command == "merge-peaks") {
+		auto options = parseArguments(argc, argv, 2);
+		if (!options || options->positional.size() < 2) {
+			std::cerr << "Unknown arguments deteced.\n";
+			printUsage(argv[0]);
+			return 1;
+		}
+		if (std::any_of(std::begin(options->positional), std::end(options->positional), bioscripts::io::isStdin)) {
+			std::cerr << "The merge-peaks command cannot read its input from stdin.\n";
+			return 1;
+		}
+		if (options->cache || options->shared_image || options->processes > 1 || options->coding_positions || options->fasta) {
+			std::cerr << "The merge-peaks command can neither be used with --cache, --shared, --processes, --cds-positions nor --fasta.\n";
+			return 1;
+		}
+		if (options->normalized && options->binary) {
+			std::cerr << "Only one of --normalized and --binary can be given.\n";
+			return 1;
+		}
+		configureLogger(true);
+		const auto gff_file = options->positional.back();
+		options->positional.pop_back();
+		return annotateMergedPeaks(options->positional, gff_file, *options);
+	}
+
+	if (command == "expand") {
+		const auto options = parseArguments(argc, argv, 2);
+		if (!options || options->positional.size() != 2) {
+			std::cerr << "Unknown arguments deteced.\n";
+			printUsage(argv[0]);
+			return 1;
+		}
+		configureLogger(true);
+		return expandNormalized(options->positional[0], options->positional[1], "transcript_data.txt");
+	}
+
+	const bool batch = command == "batch";
+	const bool shard = command == "shard";
+	const auto options = parseArguments(argc, argv, batch || shard ? 2 : 1);
+	if (!options || options->positional.size() != 2) {
+		std::cerr << "Unknown arguments deteced.\n";
+		printUsage(argv[0]);
+		return 1;
+	}
+
+	//As for the server, debug logging of every peak of every sample would serialise the batch on the log file
+	configureLogger(!batch);
+	if ((options->normalized || options->binary) && (batch || shard || options->processes > 1)) {
+		std::cerr << "--normalized and --binary can neither be used with a batch nor with a sharded run.\n";
+		return 1;
+	}
+	if (options->settings.strand != bioscripts::annotation::StrandFilter::Any && (batch || shard || options->processes > 1 || options->cache)) {
+		std::cerr << "--strand can neither be used with a batch, a sharded nor a cached run.\n";
+		return 1;
+	}
+	if ((options->coding_positions || options->fasta) && (batch || shard || options->processes > 1 || options->cache || options->shared_image)) {
+		std::cerr << "--cds-positions and --fasta can neither be used with a batch, a sharded, a cached nor a shared image run.\n";
+		return 1;
+	}
+	if (options->collapse_isoforms && (options->coding_positions || options->fasta || options->cache || options->shared_image)) {
+		std::cerr << "--collapse-isoforms can neither be used with --cds-positions, --fasta, a cached nor a shared image run.\n";
+		return 1;
+	}
+	if (options->normalized && options->binary) {
+		std::cerr << "Only one of --normalized and --binary can be given.\n";
+		return 1;
+	}
+	if (batch) {
+		return annotateBatch(options->positional[0], options->positional[1], *options);
+	}
+
+	const auto& peaks_file = options->positional[0];
+	const auto& gff_file = options->positional[1];
+	if (bioscripts::io::isStdin(peaks_file) && bioscripts::io::isStdin(gff_file)) {
+		std::cerr << "Only one of the input files can be read from stdin.\n";
+		return 1;
+	}
+
+	if (options->cache) {
+		//The cache is keyed by the GFF file and the settings only, but --region changes which records a peak is annotated from
+		if (bioscripts::io::isStdin(gff_file) || options->shared_image || shard || options->processes > 1 || !options->regions.empty()) {
+			std::cerr << "The results cache can neither be used with a GFF file read from stdin, nor with a shared record image, a sharded run or --region.\n";
+			return 1;
+		}
+		return annotateWithCache(peaks_file, gff_file, *options);
+	}
+
+	if (shard || options->processes > 1) {
+		if (bioscripts::io::isStdin(peaks_file) || bioscripts::io::isStdin(gff_file) || options->shared_image) {
+			std::cerr << "A sharded run can neither read its input from stdin nor use a shared record image.\n";
+			return 1;
+		}
+		if (!shard) {
+			return annotateInProcesses(peaks_file, gff_file, *options);
+		}
+		if (options->shard >= options->shard_count) {
+			std::cerr << "--shard must be smaller than --shards.\n";
+			return 1;
+		}
+		return annotateShard(peaks_file, gff_file, *options, options->shard, options->shard_count, bioscripts::shard::partialPath("transcript_data.txt", options->shard, options->shard_count));
+	}
+
+	if (options->shared_image) {
+		if (bioscripts::io::isStdin(gff_file)) {
+			std::cerr << "A shared record image cannot be built from stdin.\n";
+			return 1;
+		}
+		const auto image_file = options->shared_image->empty() ? bioscripts::gff::defaultImagePath(gff_file) : *options->shared_image;
+		return annotateWithImage(peaks_file, gff_file, image_file, *options);
+	}
+
+	std::optional<bioscripts::fasta::IndexedFasta> genome;
+	if (options->fasta) {
+		genome = bioscripts::fasta::IndexedFasta::open(*options->fasta);
+		if (!genome) {
+			std::cerr << "Could not read the genome " << options->fasta->string() << ", see peaks.log for details\n";
+			return 1;
+		}
+	}
+
+	//Both files are pulled into the page cache in the background while they are being parsed.
+	//With a positional index only small parts of the GFF file are read, so prefetching all of it would be wasted.
+	const auto index = bioscripts::gff::RegionIndex::load(gff_file);
+	bioscripts::io::prefetch(peaks_file);
+	if (!index) {
+		bioscripts::io::prefetch(gff_file);
+	}
+
+	//The peaks and the GFF records are loaded concurrently. Only the sequences that carry at least one peak can
+	//contribute to the results, so the GFF parser stops parsing other sequences once the peaks are known.
+	std::promise<std::unordered_set<std::string>> peak_sequence_ids;
+	auto peaks_loading = std::async(std::launch::async, [&]() {
+		try {
+			auto loaded_peaks = loadPeaks(peaks_file, options->regions);
+			peak_sequence_ids.set_value(bioscripts::peak::sequenceIds(loaded_peaks));
+			return loaded_peaks;
+		}
+		catch (...) {
+			//The GFF parser waits for the sequence ids, it has to learn that they never come
+			peak_sequence_ids.set_exception(std::current_exception());
+			throw;
+		}
+	});
+	auto records_loading = std::async(std::launch::async, [&, sequence_ids = peak_sequence_ids.get_future().share()]() {
+		return loadRecords(gff_file, index, sequence_ids, options->regions);
+	});
+
+	auto peaks = peaks_loading.get();
+	auto gff_records = records_loading.get();
+	//We are only interested in CDS records because we want to reconsitute the protein-coding parts and nothing else
+	auto cds_gff_records = codingRecords(std::move(gff_records), *options);
+
+	LOG(INFO) << "Analysing peaks";
+	const auto annotations = bioscripts::annotation::annotate(peaks, cds_gff_records, options->settings);
+	const auto rows_written = writeAnnotations("transcript_data.txt", annotations, *options);
+	if (!rows_written) {
+		return 1;
+	}
+	std::cout << "Data to write: " << *rows_written << "\n";
+	if (options->settings.strand != bioscripts::annotation::StrandFilter::Any) {
+		writeDistancesFile("transcript_distances.txt", annotations, bioscripts::annotation::fivePrimeDistances(peaks, annotations, cds_gff_records));
+	}
+	if (options->coding_positions) {
+		writePositionsFile("transcript_positions.txt", peaks, annotations, cds_gff_records);
+	}
+	if (genome) {
+		writeCodingSequenceFiles("transcript_cds.fa", "transcript_proteins.fa", "transcript_codons.txt", peaks, annotations, *genome, cds_gff_records);
+	}
+}
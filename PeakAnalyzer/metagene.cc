@@ -0,0 +1,129 @@
+#include <algorithm>
+
+#include "metagene.h"
+#include "parallel.h"
+
+#include "easylogging++.h"
+
+namespace
+{
+	constexpr std::size_t fraction_chunk_size = std::size_t{ 1 } << 16;
+	constexpr std::size_t bin_block_size = 1024;
+
+	/**
+	 * @brief  Position of @a feature in profiled_features, or profiled_features.size() if it is not profiled.
+	 */
+	std::size_t profiledIndex(bioscripts::context::Feature feature)
+	{
+		const auto& features = bioscripts::metagene::profiled_features;
+		return static_cast<std::size_t>(std::find(std::begin(features), std::end(features), feature) - std::begin(features));
+	}
+}
+
+namespace bioscripts
+{
+	namespace metagene
+	{
+		FeatureMaps::FeatureMaps(const gff::Records& records, const gff::Hierarchy& hierarchy)
+			: maps{
+				coordinates::CoordinateMap{ records, hierarchy, gff::Record::Type::five_prime_UTR },
+				coordinates::CoordinateMap{ records, hierarchy, gff::Record::Type::CDS },
+				coordinates::CoordinateMap{ records, hierarchy, gff::Record::Type::three_prime_UTR }
+			}
+		{
+		}
+
+		double FeatureMaps::fractionAlong(context::Feature feature, std::string_view transcript_id, Position position) const
+		{
+			const auto feature_index = profiledIndex(feature);
+			if (feature_index == maps.size()) {
+				return -1;
+			}
+			const auto& map = maps[feature_index];
+			const auto transcript = map.find(transcript_id);
+			const auto transcript_position = transcript ? map.toTranscript(*transcript, position) : std::nullopt;
+			if (!transcript_position) {
+				return -1;
+			}
+			//Taking the centre of the base keeps the first and the last base of a feature equally far from its ends
+			return (static_cast<double>(transcript_position->offset) + 0.5) / static_cast<double>(map.codingLength(*transcript));
+		}
+
+		Profile profile(const peak::Peaks& peaks, const context::ContextIndex& index, const FeatureMaps& maps, std::size_t bins_per_feature, const context::Precedence& precedence)
+		{
+			Profile metagene{ .bins_per_feature = bins_per_feature, .counts = std::vector<uint64_t>(profiled_features.size() * bins_per_feature) };
+			const auto contexts = index.classify(peaks, precedence);
+			std::vector<Position> midpoints;
+			midpoints.reserve(contexts.size());
+			for (const auto& peak : peaks) {
+				midpoints.push_back(static_cast<Position>(peak::midpoint(peak)));
+			}
+
+			const auto peak_count = contexts.size();
+			std::vector<uint8_t> features(peak_count);
+			std::vector<double> fractions(peak_count);
+			helper::parallelFor((peak_count + fraction_chunk_size - 1) / fraction_chunk_size, [&](std::size_t chunk) {
+				const auto chunk_end = (std::min)(peak_count, (chunk + 1) * fraction_chunk_size);
+				for (auto i = chunk * fraction_chunk_size; i < chunk_end; ++i) {
+					const auto feature_index = profiledIndex(contexts[i].feature);
+					features[i] = static_cast<uint8_t>(feature_index == profiled_features.size() ? 0 : feature_index);
+					fractions[i] = maps.fractionAlong(contexts[i].feature, contexts[i].transcript_id, midpoints[i]);
+				}
+			});
+
+			//Every thread bins its own share of the peaks into its own histogram, so no two threads write the same counts
+			const auto worker_count = (std::max)(std::size_t{ 1 }, (std::min)(helper::workerCount(), peak_count / bin_block_size));
+			std::vector<std::vector<uint64_t>> histograms(worker_count, std::vector<uint64_t>(metagene.counts.size()));
+			helper::parallelFor(worker_count, [&](std::size_t worker) {
+				const auto first = peak_count * worker / worker_count;
+				const auto last = peak_count * (worker + 1) / worker_count;
+				bin(std::span{ features }.subspan(first, last - first), std::span{ fractions }.subspan(first, last - first), bins_per_feature, histograms[worker]);
+			}, worker_count);
+
+			uint64_t profiled = 0;
+			for (const auto& histogram : histograms) {
+				for (std::size_t b = 0; b < histogram.size(); ++b) {
+					metagene.counts[b] += histogram[b];
+					profiled += histogram[b];
+				}
+			}
+			metagene.unprofiled = peak_count - profiled;
+			LOG(INFO) << "Profiled " << profiled << " of " << peak_count << " peaks in " << worker_count << " histograms";
+			return metagene;
+		}
+
+		void bin(std::span<const uint8_t> features, std::span<const double> fractions, std::size_t bins_per_feature, std::span<uint64_t> counts)
+		{
+			if (bins_per_feature == 0) {
+				return;
+			}
+			const auto bin_count = static_cast<double>(bins_per_feature);
+			const auto last_bin = bins_per_feature - 1;
+			std::array<std::size_t, bin_block_size> bin_indices;
+			std::array<uint64_t, bin_block_size> weights;
+			for (std::size_t block = 0; block < fractions.size(); block += bin_block_size) {
+				const auto block_size = (std::min)(bin_block_size, fractions.size() - block);
+				for (std::size_t i = 0; i < block_size; ++i) {
+					const auto fraction = fractions[block + i];
+					const auto included = fraction >= 0.0;
+					const auto bin_in_feature = static_cast<std::size_t>(included ? fraction * bin_count : 0.0);
+					bin_indices[i] = features[block + i] * bins_per_feature + (std::min)(bin_in_feature, last_bin);
+					weights[i] = included;
+				}
+				for (std::size_t i = 0; i < block_size; ++i) {
+					counts[bin_indices[i]] += weights[i];
+				}
+			}
+		}
+
+		void write(std::ostream& stream, const Profile& profile)
+		{
+			for (std::size_t f = 0; f < profiled_features.size(); ++f) {
+				for (std::size_t b = 0; b < profile.bins_per_feature; ++b) {
+					const auto centre = (static_cast<double>(b) + 0.5) / static_cast<double>(profile.bins_per_feature);
+					stream << context::name(profiled_features[f]) << "\t" << b << "\t" << centre << "\t" << profile.counts[f * profile.bins_per_feature + b] << "\n";
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,94 @@
+#ifndef BIOSCRIPTS_METAGENE_H
+#define BIOSCRIPTS_METAGENE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "context.h"
+#include "coordinate_map.h"
+#include "gff.h"
+#include "hierarchy.h"
+#include "peak.h"
+
+namespace bioscripts
+{
+	namespace metagene
+	{
+		/**
+		 * @brief  The features that make up the metagene, in the order a transcript is read.
+		 */
+		inline constexpr std::array<context::Feature, 3> profiled_features = {
+			context::Feature::FivePrimeUTR,
+			context::Feature::CDS,
+			context::Feature::ThreePrimeUTR
+		};
+
+		/**
+		 * @brief  How many peak midpoints fell into each bin of the metagene.
+		 *
+		 * Each feature is cut into the same number of bins along its spliced length, from its 5' to its 3' end, so
+		 * transcripts of any length add up in the same bins.
+		 */
+		struct Profile
+		{
+			std::size_t bins_per_feature = 0;
+			std::vector<uint64_t> counts;	//The bins of the 5' UTR, then those of the CDS and the 3' UTR
+			uint64_t unprofiled = 0;		//Peaks in introns, non-coding exons or between genes
+		};
+
+		/**
+		 * @brief  The spliced 5' UTR, CDS and 3' UTR of every transcript, for placing positions along them.
+		 */
+		class FeatureMaps
+		{
+		public:
+			/**
+			 * @brief  Map the features of @a records, with @a hierarchy built from the same records.
+			 */
+			FeatureMaps(const gff::Records& records, const gff::Hierarchy& hierarchy);
+
+			/**
+			 * @brief  Where @a position lies along the @a feature of @a transcript_id, from 0 at its 5' end to just
+			 *		   below 1 at its 3' end.
+			 * @return  The fraction, or a negative number if @a position is not within that feature.
+			 */
+			double fractionAlong(context::Feature feature, std::string_view transcript_id, Position position) const;
+
+		private:
+			std::array<coordinates::CoordinateMap, profiled_features.size()> maps;
+		};
+
+		/**
+		 * @brief  Build the metagene of @a peaks.
+		 *
+		 * Each peak midpoint is placed on the feature and transcript that @a index finds for it, and its fraction along
+		 * that feature is computed in parallel over chunks of peaks. The fractions are then binned into one histogram per
+		 * worker thread, which are summed at the end.
+		 */
+		Profile profile(const peak::Peaks& peaks, const context::ContextIndex& index, const FeatureMaps& maps, std::size_t bins_per_feature, const context::Precedence& precedence = {});
+
+		/**
+		 * @brief  Add each fraction of @a fractions to the bin of its @a features entry in @a counts.
+		 *
+		 * The bin numbers are computed for a whole block of fractions in a loop without branches, which the compiler
+		 * turns into vector instructions, before the counts are incremented. Fractions below 0 are left out.
+		 * @pre  @a features and @a fractions have the same size, every feature is below profiled_features.size(), and
+		 *		 @a counts has room for profiled_features.size() * @a bins_per_feature bins.
+		 */
+		void bin(std::span<const uint8_t> features, std::span<const double> fractions, std::size_t bins_per_feature, std::span<uint64_t> counts);
+
+		/**
+		 * @brief  Write @a profile as tab-delimited rows of the feature, the bin, its centre as a fraction of the feature
+		 *		   and the number of peaks in it.
+		 */
+		void write(std::ostream& stream, const Profile& profile);
+	}
+}
+
+#endif // !BIOSCRIPTS_METAGENE_H
@@ -0,0 +1,165 @@
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+#include "input.h"
+#include "normalized.h"
+
+#include "easylogging++.h"
+
+namespace
+{
+	/**
+	 * @brief  The CDS records of @a coding_sequence joined into one string, equal for equal transcripts only.
+	 */
+	std::string transcriptKey(const bioscripts::annotation::CodingSequence& coding_sequence)
+	{
+		std::string key;
+		for (const auto& segment : coding_sequence) {
+			key += segment.transcript_id;
+			key += '\t';
+			key += std::to_string(segment.span.start);
+			key += '\t';
+			key += std::to_string(segment.span.end);
+			key += '\n';
+		}
+		return key;
+	}
+
+	/**
+	 * @brief  Parse the unsigned number starting at @a position of @a line and move @a position past the tab after it.
+	 * @throws  std::logic_error if there is no number at @a position.
+	 */
+	std::size_t parseField(const std::string& line, std::size_t& position)
+	{
+		std::size_t parsed = 0;
+		const auto value = std::stoull(line.substr(position), &parsed);
+		position += parsed + 1;
+		return value;
+	}
+}
+
+namespace bioscripts
+{
+	namespace normalized
+	{
+		NormalizedAnnotations normalize(const std::vector<annotation::PeakAnnotation>& annotations)
+		{
+			NormalizedAnnotations normalized;
+			std::unordered_map<std::string, std::size_t> transcript_numbers;
+			std::size_t peak_id = 0;
+			for (const auto& annotation : annotations) {
+				for (const auto& coding_sequence : annotation) {
+					const auto [transcript, inserted] = transcript_numbers.try_emplace(transcriptKey(coding_sequence), normalized.transcripts.size());
+					if (inserted) {
+						normalized.transcripts.push_back(coding_sequence);
+					}
+					normalized.references.push_back(TranscriptReference{ .peak_id = peak_id++, .transcript_number = transcript->second });
+				}
+			}
+			LOG(INFO) << normalized.references.size() << " transcript hits refer to " << normalized.transcripts.size() << " distinct transcripts";
+			return normalized;
+		}
+
+		std::optional<std::vector<annotation::TranscriptData>> expand(const NormalizedAnnotations& normalized)
+		{
+			std::vector<annotation::TranscriptData> data;
+			for (const auto& reference : normalized.references) {
+				if (reference.transcript_number >= normalized.transcripts.size()) {
+					LOG(ERROR) << "Peak " << reference.peak_id << " refers to transcript " << reference.transcript_number << ", but there are only " << normalized.transcripts.size();
+					return std::nullopt;
+				}
+				for (const auto& segment : normalized.transcripts[reference.transcript_number]) {
+					data.push_back(annotation::TranscriptData{
+						.id = reference.peak_id,
+						.start_pos = segment.span.start,
+						.end_pos = segment.span.end,
+						.transcript_id = segment.transcript_id
+						});
+				}
+			}
+			return data;
+		}
+
+		bool write(const std::filesystem::path& transcripts_file, const std::filesystem::path& references_file, const NormalizedAnnotations& normalized)
+		{
+			std::ofstream transcripts{ transcripts_file, std::ios::binary };
+			std::ofstream references{ references_file, std::ios::binary };
+			if (!transcripts.is_open() || !references.is_open()) {
+				LOG(ERROR) << "Could not write " << transcripts_file.string() << " and " << references_file.string();
+				return false;
+			}
+
+			for (std::size_t transcript_number = 0; transcript_number < normalized.transcripts.size(); ++transcript_number) {
+				for (const auto& segment : normalized.transcripts[transcript_number]) {
+					transcripts << transcript_number << "\t" << segment.transcript_id << "\t" << segment.span.start << "\t" << segment.span.end << "\n";
+				}
+			}
+			for (const auto& reference : normalized.references) {
+				references << reference.peak_id << "\t" << reference.transcript_number << "\n";
+			}
+			return static_cast<bool>(transcripts) && static_cast<bool>(references);
+		}
+
+		std::optional<NormalizedAnnotations> read(const std::filesystem::path& transcripts_file, const std::filesystem::path& references_file)
+		{
+			io::LineReader transcripts{ transcripts_file };
+			io::LineReader references{ references_file };
+			if (!transcripts.is_open() || !references.is_open()) {
+				LOG(ERROR) << "Could not open " << transcripts_file.string() << " and " << references_file.string();
+				return std::nullopt;
+			}
+
+			NormalizedAnnotations normalized;
+			std::string line;
+			try {
+				while (transcripts.getline(line)) {
+					//transcript number, transcript id, start, end
+					std::size_t position = 0;
+					const auto transcript_number = parseField(line, position);
+					const auto id_end = line.find('\t', position);
+					if (id_end == std::string::npos) {
+						throw std::logic_error("Malformed row \"" + line + "\"");
+					}
+					auto transcript_id = line.substr(position, id_end - position);
+					position = id_end + 1;
+					const auto start = parseField(line, position);
+					const auto end = parseField(line, position);
+
+					if (transcript_number == normalized.transcripts.size()) {
+						normalized.transcripts.emplace_back();
+					}
+					else if (transcript_number + 1 != normalized.transcripts.size()) {
+						throw std::logic_error("Transcripts out of order in row \"" + line + "\"");
+					}
+					normalized.transcripts.back().push_back(annotation::CodingSegment{ .transcript_id = std::move(transcript_id), .span = Range{ start, end } });
+				}
+
+				while (references.getline(line)) {
+					std::size_t position = 0;
+					const auto peak_id = parseField(line, position);
+					const auto transcript_number = parseField(line, position);
+					normalized.references.push_back(TranscriptReference{ .peak_id = peak_id, .transcript_number = transcript_number });
+				}
+			}
+			catch (const std::logic_error& e) {
+				LOG(ERROR) << "Could not read the normalized output: " << e.what();
+				return std::nullopt;
+			}
+			return normalized;
+		}
+
+		std::filesystem::path transcriptsPath(const std::filesystem::path& output_file)
+		{
+			auto transcripts_file = output_file;
+			return transcripts_file.replace_extension(".transcripts" + output_file.extension().string());
+		}
+
+		std::filesystem::path referencesPath(const std::filesystem::path& output_file)
+		{
+			auto references_file = output_file;
+			return references_file.replace_extension(".peaks" + output_file.extension().string());
+		}
+	}
+}
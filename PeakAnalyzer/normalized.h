@@ -0,0 +1,72 @@
+#ifndef BIOSCRIPTS_NORMALIZED_H
+#define BIOSCRIPTS_NORMALIZED_H
+
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+#include "annotation.h"
+
+namespace bioscripts
+{
+	namespace normalized
+	{
+		/**
+		 * @brief  A peak id of the legacy output together with the transcript it stands for.
+		 */
+		struct TranscriptReference
+		{
+			std::size_t peak_id;
+			std::size_t transcript_number;
+		};
+
+		/**
+		 * @brief  The annotations of a run with every transcript stored once.
+		 *
+		 * The legacy output repeats all CDS rows of a transcript for every peak that hits it. Here the transcripts are
+		 * kept in a table of their own and each peak id only refers to its transcript by number.
+		 */
+		struct NormalizedAnnotations
+		{
+			std::vector<annotation::CodingSequence> transcripts;
+			std::vector<TranscriptReference> references;
+		};
+
+		/**
+		 * @brief  Collect the distinct transcripts of @a annotations, numbered in the order they are first hit, and
+		 *		   refer to them with the same peak ids as annotation::flatten.
+		 */
+		NormalizedAnnotations normalize(const std::vector<annotation::PeakAnnotation>& annotations);
+
+		/**
+		 * @brief  The rows of the legacy transcript_data.txt that @a normalized stands for.
+		 * @return  The rows, or an empty optional if a reference names a transcript missing from the table.
+		 */
+		std::optional<std::vector<annotation::TranscriptData>> expand(const NormalizedAnnotations& normalized);
+
+		/**
+		 * @brief  Write the transcript table, one CDS record per row after the number of its transcript, and the
+		 *		   peak id to transcript number references.
+		 */
+		bool write(const std::filesystem::path& transcripts_file, const std::filesystem::path& references_file, const NormalizedAnnotations& normalized);
+
+		/**
+		 * @brief  Read back the files written by write().
+		 * @return  The annotations, or an empty optional if either file is unreadable or malformed.
+		 */
+		std::optional<NormalizedAnnotations> read(const std::filesystem::path& transcripts_file, const std::filesystem::path& references_file);
+
+		/**
+		 * @brief  Location of the transcript table written next to @a output_file.
+		 */
+		std::filesystem::path transcriptsPath(const std::filesystem::path& output_file);
+
+		/**
+		 * @brief  Location of the peak references written next to @a output_file.
+		 */
+		std::filesystem::path referencesPath(const std::filesystem::path& output_file);
+	}
+}
+
+#endif // !BIOSCRIPTS_NORMALIZED_H
@@ -0,0 +1,56 @@
+#ifndef BIOSCRIPTS_PARALLEL_H
+#define BIOSCRIPTS_PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace helper
+{
+    /**
+     * @brief  Number of worker threads to use, never less than one.
+     */
+    inline std::size_t workerCount()
+    {
+        return (std::max)(std::thread::hardware_concurrency(), 1u);
+    }
+
+    /**
+     * @brief  Call @a fn(i) for every i in [0, @a count) using up to @a workers threads.
+     *
+     * Indices are handed out one at a time, so uneven work items do not leave threads idle.
+     * The call returns once every index has been processed.
+     */
+    template <typename Function>
+    void parallelFor(std::size_t count, Function fn, std::size_t workers = workerCount())
+    {
+        workers = (std::min)(workers, count);
+        if (workers <= 1) {
+            for (std::size_t i = 0; i < count; ++i) {
+                fn(i);
+            }
+            return;
+        }
+
+        std::atomic<std::size_t> next_index{ 0 };
+        auto work = [&]() {
+            for (auto i = next_index++; i < count; i = next_index++) {
+                fn(i);
+            }
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(workers - 1);
+        for (std::size_t t = 1; t < workers; ++t) {
+            threads.emplace_back(work);
+        }
+        work();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+}
+
+#endif // !BIOSCRIPTS_PARALLEL_H
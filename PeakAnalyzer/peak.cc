@@ -1,6 +1,5 @@
-#include <fstream>
-
 #include "helpers.h"
+#include "input.h"
 #include "peak.h"
 
 #include "easylogging++.h"
@@ -11,51 +10,74 @@ namespace bioscripts
 	{
 		Peaks::Peaks(const std::filesystem::path& peak_file)
 		{
-            std::ifstream f{ peak_file };
+            io::LineReader f{ peak_file };
             if (!f.is_open()) {
                 LOG(ERROR) << "Could not open peak file";
                 return;
             }
 
             std::string line;
-            std::getline(f, line); /* Skips the header in database file */
-            while (std::getline(f, line)) {
-                const auto tokens = helper::tokenise(line, '\t');
-
-                if (tokens.size() != 21) {
+            f.getline(line); /* Skips the header in database file */
+            while (f.getline(line)) {
+                auto peak = parsePeak(line);
+                if (!peak) {
                     continue;
                 }
+                peaks.push_back(std::move(*peak));
+            }
+		}
 
-                std::string sequence_identifier = tokens[1];
-                std::size_t start_pos = std::stoull(tokens[2]);
-                std::size_t end_pos = std::stoull(tokens[3]);
+        std::optional<Peak> parsePeak(const std::string& line)
+        {
+            const auto tokens = helper::tokenise(line, '\t');
 
-                //Add one to end-pos because Range is 0-based [start, end)
-                //but GFF coordinates are [start, end]
-                auto peak_range = Range{ start_pos, end_pos + 1 };
-                std::string feature_identifier = tokens[11];
+            if (tokens.size() != 21) {
+                return std::nullopt;
+            }
 
-                auto strand = bioscripts::deduceStrand(tokens[14]);
+            std::string sequence_identifier = tokens[1];
+            std::size_t start_pos = std::stoull(tokens[2]);
+            std::size_t end_pos = std::stoull(tokens[3]);
 
-                peaks.push_back(Peak{
-                    .span = peak_range,
-                    .strand = strand,
-                    .associated_identifier = feature_identifier,
-                    .sequence_id = sequence_identifier,
-                });
-            }
-		}
+            //Add one to end-pos because Range is 0-based [start, end)
+            //but GFF coordinates are [start, end]
+            auto peak_range = Range{ start_pos, end_pos + 1 };
+            std::string feature_identifier = tokens[11];
+
+            auto strand = bioscripts::deduceStrand(tokens[14]);
+
+            return Peak{
+                .span = peak_range,
+                .strand = strand,
+                .associated_identifier = feature_identifier,
+                .sequence_id = sequence_identifier,
+            };
+        }
 
         std::size_t Peaks::size() const
         {
             return peaks.size();
         }
 
+        void Peaks::add(Peak peak)
+        {
+            peaks.push_back(std::move(peak));
+        }
+
         double midpoint(const Peak& peak) 
         {
             return (centre(peak.span));
         }
 
+        std::unordered_set<std::string> sequenceIds(const Peaks& peaks)
+        {
+            std::unordered_set<std::string> sequence_ids;
+            for (const auto& peak : peaks) {
+                sequence_ids.insert(peak.sequence_id);
+            }
+            return sequence_ids;
+        }
+
         Peaks::iterator Peaks::begin()
         {
             return std::begin(peaks);
@@ -3,7 +3,10 @@
 
 #include <cstdint>
 #include <filesystem>
+#include <optional>
 #include <string>
+#include <unordered_set>
+#include <vector>
 
 #include "identifier.h"
 #include "strand.h"
@@ -38,6 +41,7 @@ namespace bioscripts
 			using iterator = std::vector<Peak>::iterator;
 			using const_iterator = std::vector<Peak>::const_iterator;
 
+			Peaks() = default;
 			Peaks(const std::filesystem::path& peaks_file);
 
 			iterator begin();
@@ -50,12 +54,25 @@ namespace bioscripts
 
 			std::size_t size() const;
 
+			void add(Peak peak);
+
 		private:
 			std::vector<Peak> peaks;
 		};
 
+		/**
+		 * @brief  Turn a single tab-delimited row of a peak file into a peak.
+		 * @return  The parsed peak, or an empty optional if the row does not have the expected number of columns.
+		 */
+		std::optional<Peak> parsePeak(const std::string& line);
+
 		double midpoint(const Peak& peak);
 
+		/**
+		 * @brief  Collect the distinct sequence identifiers (e.g. chromosomes) that the @a peaks are found on.
+		 */
+		std::unordered_set<std::string> sequenceIds(const Peaks& peaks);
+
 	}
 }
 #endif
\ No newline at end of file
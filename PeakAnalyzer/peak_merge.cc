@@ -0,0 +1,87 @@
+#include <algorithm>
+#include <array>
+#include <numeric>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+
+#include "parallel.h"
+#include "peak_merge.h"
+
+#include "easylogging++.h"
+
+namespace
+{
+	constexpr std::size_t strand_count = static_cast<std::size_t>(bioscripts::Strand::Unknown) + 1;
+
+	/**
+	 * @brief  Merge the peaks of a single sequence, see bioscripts::peak::merge.
+	 */
+	std::vector<bioscripts::peak::Peak> mergeSequence(std::vector<bioscripts::peak::Peak> peaks, bioscripts::Distance max_gap)
+	{
+		std::stable_sort(std::begin(peaks), std::end(peaks), [](const auto& first, const auto& second) {
+			return std::tie(first.span.start, first.span.end) < std::tie(second.span.start, second.span.end);
+		});
+
+		//The merged peaks are opened in order of their start, so they stay ordered however far they are extended
+		std::vector<bioscripts::peak::Peak> merged;
+		std::array<std::unordered_map<std::string, std::size_t>, strand_count> open_peaks;
+		for (auto& peak : peaks) {
+			auto& open_peaks_on_strand = open_peaks[static_cast<std::size_t>(peak.strand)];
+			auto gene = peak.associated_identifier.gene();
+			const auto open_peak = open_peaks_on_strand.find(gene);
+			if (open_peak != std::end(open_peaks_on_strand) && peak.span.start <= merged[open_peak->second].span.end + max_gap) {
+				auto& span = merged[open_peak->second].span;
+				span.end = (std::max)(span.end, peak.span.end);
+				continue;
+			}
+			open_peaks_on_strand.insert_or_assign(std::move(gene), merged.size());
+			merged.push_back(std::move(peak));
+		}
+		return merged;
+	}
+}
+
+namespace bioscripts
+{
+	namespace peak
+	{
+		Peaks merge(const std::vector<Peaks>& replicates, Distance max_gap)
+		{
+			std::unordered_map<std::string, std::size_t> sequence_numbers;
+			std::vector<std::string> sequence_ids;
+			std::vector<std::vector<Peak>> sequence_peaks;
+			std::size_t peak_count = 0;
+			for (const auto& replicate : replicates) {
+				for (const auto& peak : replicate) {
+					const auto [sequence_number, inserted] = sequence_numbers.try_emplace(peak.sequence_id, sequence_ids.size());
+					if (inserted) {
+						sequence_ids.push_back(peak.sequence_id);
+						sequence_peaks.emplace_back();
+					}
+					sequence_peaks[sequence_number->second].push_back(peak);
+					++peak_count;
+				}
+			}
+
+			std::vector<std::vector<Peak>> merged(sequence_peaks.size());
+			helper::parallelFor(sequence_peaks.size(), [&](std::size_t sequence) {
+				merged[sequence] = mergeSequence(std::move(sequence_peaks[sequence]), max_gap);
+			});
+
+			std::vector<std::size_t> sequence_order(sequence_ids.size());
+			std::iota(std::begin(sequence_order), std::end(sequence_order), std::size_t{ 0 });
+			std::sort(std::begin(sequence_order), std::end(sequence_order), [&sequence_ids](std::size_t first, std::size_t second) {
+				return sequence_ids[first] < sequence_ids[second];
+			});
+			Peaks merged_peaks;
+			for (const auto sequence : sequence_order) {
+				for (auto& peak : merged[sequence]) {
+					merged_peaks.add(std::move(peak));
+				}
+			}
+			LOG(INFO) << "Merged " << peak_count << " peaks of " << replicates.size() << " replicates into " << merged_peaks.size();
+			return merged_peaks;
+		}
+	}
+}
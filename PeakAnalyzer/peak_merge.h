@@ -0,0 +1,26 @@
+#ifndef BIOSCRIPTS_PEAK_MERGE_H
+#define BIOSCRIPTS_PEAK_MERGE_H
+
+#include <vector>
+
+#include "peak.h"
+#include "range.h"
+
+namespace bioscripts
+{
+	namespace peak
+	{
+		/**
+		 * @brief  Merge the peaks of all @a replicates into consensus peaks.
+		 *
+		 * Peaks on the same sequence and strand and called for the same gene are merged into one peak spanning them
+		 * all if they overlap or lie at most @a max_gap bases apart, counting from the end of one to the start of the
+		 * next. The sequences are merged in parallel. The peaks of each are swept in order of their start, and every
+		 * peak either extends the merged peak still open for its strand and gene or opens a new one.
+		 * @return  The merged peaks, ordered by sequence and then by start.
+		 */
+		Peaks merge(const std::vector<Peaks>& replicates, Distance max_gap = 0);
+	}
+}
+
+#endif // !BIOSCRIPTS_PEAK_MERGE_H
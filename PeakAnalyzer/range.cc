@@ -6,8 +6,6 @@ namespace bioscripts
 {
 	//Range::Range() : start(0), end(1) {}
 
-	Range::Range(std::size_t start, std::size_t end) : start(start), end(end) {}
-
 	Length length(const Range& r)
 	{
 		return (r.end - r.start);
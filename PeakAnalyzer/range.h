@@ -20,7 +20,7 @@ namespace bioscripts
 		////Creates an empty range.
 		//Range();
 
-		Range(std::size_t start, std::size_t end);
+		constexpr Range(std::size_t start, std::size_t end) : start(start), end(end) {}
 		Position start;
 		Position end;
 		auto operator<=>(const Range& rhs) const = default;
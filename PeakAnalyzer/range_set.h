@@ -0,0 +1,170 @@
+#ifndef BIOSCRIPTS_RANGE_SET_H
+#define BIOSCRIPTS_RANGE_SET_H
+
+#include <algorithm>
+#include <cstddef>
+#include <optional>
+#include <span>
+
+#include "range.h"
+
+namespace bioscripts
+{
+	/*
+	 * Set operations over sequences of ranges ordered by their start, each in a single pass over its inputs. The
+	 * results are written to an output iterator, so the caller decides where they are stored and how much room
+	 * is reserved for them, and all of them can be evaluated at compile time.
+	 */
+
+	/**
+	 * @brief  Write the union of @a first and @a second to @a out, as ranges that neither overlap nor abut.
+	 * @pre  Both inputs are ordered by start. They may overlap, within themselves as well as with each other.
+	 * @return  The output iterator past the last range written.
+	 */
+	template <typename OutputIt>
+	constexpr OutputIt unite(std::span<const Range> first, std::span<const Range> second, OutputIt out)
+	{
+		std::optional<Range> current;
+		for (std::size_t i = 0, j = 0; i < first.size() || j < second.size();) {
+			const auto& next = j == second.size() || (i < first.size() && first[i].start <= second[j].start) ? first[i++] : second[j++];
+			if (current && next.start <= current->end) {
+				current->end = (std::max)(current->end, next.end);
+				continue;
+			}
+			if (current) {
+				*out++ = *current;
+			}
+			current = next;
+		}
+		if (current) {
+			*out++ = *current;
+		}
+		return out;
+	}
+
+	/**
+	 * @brief  Write the union of @a sorted to @a out, merging the ranges that overlap or abut.
+	 * @pre  @a sorted is ordered by start.
+	 */
+	template <typename OutputIt>
+	constexpr OutputIt unite(std::span<const Range> sorted, OutputIt out)
+	{
+		return unite(sorted, std::span<const Range>{}, out);
+	}
+
+	/**
+	 * @brief  Write the positions that lie in both @a first and @a second to @a out.
+	 * @pre  Both inputs are ordered by start and none of them overlaps another of the same input, as after unite().
+	 */
+	template <typename OutputIt>
+	constexpr OutputIt intersect(std::span<const Range> first, std::span<const Range> second, OutputIt out)
+	{
+		for (std::size_t i = 0, j = 0; i < first.size() && j < second.size();) {
+			const auto start = (std::max)(first[i].start, second[j].start);
+			const auto end = (std::min)(first[i].end, second[j].end);
+			if (start < end) {
+				*out++ = Range{ start, end };
+			}
+			//The range ending first cannot overlap anything further along the other input
+			if (first[i].end < second[j].end) {
+				++i;
+			}
+			else {
+				++j;
+			}
+		}
+		return out;
+	}
+
+	/**
+	 * @brief  Write the positions of @a ranges that are not in @a removed to @a out, e.g. the parts of the exons of a
+	 *		   gene that are not masked.
+	 * @pre  Both inputs are ordered by start and none of them overlaps another of the same input, as after unite().
+	 */
+	template <typename OutputIt>
+	constexpr OutputIt subtract(std::span<const Range> ranges, std::span<const Range> removed, OutputIt out)
+	{
+		std::size_t first_removed = 0;
+		for (const auto& range : ranges) {
+			while (first_removed < removed.size() && removed[first_removed].end <= range.start) {
+				++first_removed;
+			}
+			auto start = range.start;
+			for (auto k = first_removed; k < removed.size() && removed[k].start < range.end; ++k) {
+				if (removed[k].start > start) {
+					*out++ = Range{ start, removed[k].start };
+				}
+				start = (std::max)(start, removed[k].end);
+			}
+			if (start < range.end) {
+				*out++ = Range{ start, range.end };
+			}
+		}
+		return out;
+	}
+
+	/**
+	 * @brief  Write the positions of @a bounds that no range of @a sorted covers to @a out, e.g. the intergenic
+	 *		   regions of a sequence given its genes and Range{ 1, length + 1 } for a sequence counted from 1.
+	 * @pre  @a sorted is ordered by start, its ranges may overlap.
+	 */
+	template <typename OutputIt>
+	constexpr OutputIt complement(std::span<const Range> sorted, const Range& bounds, OutputIt out)
+	{
+		auto covered_until = bounds.start;
+		for (const auto& range : sorted) {
+			if (range.start >= bounds.end) {
+				break;
+			}
+			if (range.start > covered_until) {
+				*out++ = Range{ covered_until, range.start };
+			}
+			covered_until = (std::max)(covered_until, range.end);
+		}
+		if (covered_until < bounds.end) {
+			*out++ = Range{ covered_until, bounds.end };
+		}
+		return out;
+	}
+
+	/**
+	 * @brief  Write the gaps between the ranges of @a sorted to @a out, e.g. the introns of a transcript given its
+	 *		   exons. Ranges that overlap or abut leave no gap.
+	 * @pre  @a sorted is ordered by start, its ranges may overlap.
+	 */
+	template <typename OutputIt>
+	constexpr OutputIt gaps(std::span<const Range> sorted, OutputIt out)
+	{
+		if (sorted.empty()) {
+			return out;
+		}
+		auto covered_until = sorted.front().end;
+		for (const auto& range : sorted.subspan(1)) {
+			if (range.start > covered_until) {
+				*out++ = Range{ covered_until, range.start };
+			}
+			covered_until = (std::max)(covered_until, range.end);
+		}
+		return out;
+	}
+
+	/**
+	 * @brief  Number of positions covered by at least one range of @a sorted, each counted once.
+	 * @pre  @a sorted is ordered by start, its ranges may overlap.
+	 */
+	constexpr Length coverage(std::span<const Range> sorted)
+	{
+		Length covered = 0;
+		Position covered_until = 0;
+		for (const auto& range : sorted) {
+			const auto start = (std::max)(range.start, covered_until);
+			if (range.end > start) {
+				covered += range.end - start;
+				covered_until = range.end;
+			}
+		}
+		return covered;
+	}
+}
+
+#endif // !BIOSCRIPTS_RANGE_SET_H
@@ -0,0 +1,415 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <type_traits>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "record_image.h"
+
+#include "easylogging++.h"
+
+namespace
+{
+	using Entry = bioscripts::gff::RecordImage::Entry;
+
+	constexpr char image_magic[8] = { 'P', 'A', 'I', 'M', 'A', 'G', 'E', '\1' };
+	constexpr uint32_t byte_order_mark = 0x01020304;
+
+	struct ImageHeader
+	{
+		char magic[8];
+		uint32_t byte_order;
+		uint32_t sequence_count;
+		uint64_t source_size;
+		int64_t source_modification_time;
+		uint64_t sequences_offset;
+		uint64_t entries_offset;
+		uint64_t entry_count;
+		uint64_t image_size;
+	};
+
+	struct ImageSequence
+	{
+		uint64_t name_offset;
+		uint64_t name_length;
+		uint64_t first_entry;
+		uint64_t entry_count;
+	};
+
+	//The image is read in place, so everything in it must be plain data with a fixed layout
+	static_assert(std::is_trivially_copyable_v<ImageHeader> && std::is_standard_layout_v<ImageHeader>);
+	static_assert(std::is_trivially_copyable_v<ImageSequence> && std::is_standard_layout_v<ImageSequence>);
+	static_assert(std::is_trivially_copyable_v<Entry> && std::is_standard_layout_v<Entry>);
+	static_assert(sizeof(ImageHeader) % alignof(ImageSequence) == 0 && sizeof(ImageSequence) % alignof(Entry) == 0);
+
+	struct SourceFingerprint
+	{
+		uint64_t size;
+		int64_t modification_time;
+	};
+
+	/**
+	 * @brief  Size and modification time of @a gff_file, which tell whether an image still reflects it.
+	 */
+	std::optional<SourceFingerprint> fingerprint(const std::filesystem::path& gff_file)
+	{
+		std::error_code error;
+		const auto size = std::filesystem::file_size(gff_file, error);
+		if (error) {
+			return std::nullopt;
+		}
+		const auto modification_time = std::filesystem::last_write_time(gff_file, error);
+		if (error) {
+			return std::nullopt;
+		}
+		return SourceFingerprint{ .size = size, .modification_time = static_cast<int64_t>(modification_time.time_since_epoch().count()) };
+	}
+
+	/**
+	 * @brief  Exclusive advisory lock on a file, held until the lock goes out of scope.
+	 */
+	class FileLock
+	{
+	public:
+		explicit FileLock(const std::filesystem::path& lock_file)
+		{
+#ifdef _WIN32
+			handle = ::CreateFileW(lock_file.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+			OVERLAPPED whole_file = {};
+			locked = handle != INVALID_HANDLE_VALUE && ::LockFileEx(handle, LOCKFILE_EXCLUSIVE_LOCK, 0, MAXDWORD, MAXDWORD, &whole_file);
+#else
+			fd = ::open(lock_file.c_str(), O_RDWR | O_CREAT | O_CLOEXEC | O_NOFOLLOW, 0600);
+			locked = fd >= 0 && ::flock(fd, LOCK_EX) == 0;
+#endif
+		}
+
+		~FileLock()
+		{
+#ifdef _WIN32
+			if (handle != INVALID_HANDLE_VALUE) {
+				::CloseHandle(handle);
+			}
+#else
+			if (fd >= 0) {
+				::close(fd);
+			}
+#endif
+		}
+
+		FileLock(const FileLock&) = delete;
+		FileLock& operator=(const FileLock&) = delete;
+
+		bool is_locked() const
+		{
+			return locked;
+		}
+
+	private:
+#ifdef _WIN32
+		HANDLE handle = INVALID_HANDLE_VALUE;
+#else
+		int fd = -1;
+#endif
+		bool locked = false;
+	};
+
+	/**
+	 * @brief  Determines whether @a image_file is a regular file that only the current user can have written.
+	 *
+	 * Images live in a world-writable directory under a predictable name, so one planted by another user must not be
+	 * trusted. Windows keeps the images in the per-user temporary directory, where no such check is needed.
+	 */
+	bool isOwnFile(const std::filesystem::path& image_file)
+	{
+#ifdef _WIN32
+		return true;
+#else
+		struct stat file_status;
+		return ::lstat(image_file.c_str(), &file_status) == 0 && S_ISREG(file_status.st_mode) && file_status.st_uid == ::geteuid() && (file_status.st_mode & (S_IWGRP | S_IWOTH)) == 0;
+#endif
+	}
+
+	/**
+	 * @brief  Create @a file empty and readable and writable by its owner only, failing if anything exists there.
+	 */
+	bool createOwnFile(const std::filesystem::path& file)
+	{
+#ifdef _WIN32
+		return true;
+#else
+		const auto fd = ::open(file.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC | O_NOFOLLOW, 0600);
+		if (fd < 0) {
+			return false;
+		}
+		::close(fd);
+		return true;
+#endif
+	}
+
+	template <typename T>
+	void writeRaw(std::ofstream& f, const T& value)
+	{
+		f.write(reinterpret_cast<const char*>(&value), sizeof(value));
+	}
+}
+
+namespace bioscripts
+{
+	namespace gff
+	{
+		std::filesystem::path defaultImagePath(const std::filesystem::path& gff_file)
+		{
+			std::error_code error;
+			std::filesystem::path directory{ "/dev/shm" };
+			if (!std::filesystem::is_directory(directory, error)) {
+				directory = std::filesystem::temp_directory_path(error);
+			}
+
+			//Every GFF file gets its own image, named after its canonical path so that every way of naming it agrees
+			auto source = std::filesystem::weakly_canonical(gff_file, error).string();
+			if (error) {
+				source = std::filesystem::absolute(gff_file, error).string();
+			}
+			std::ostringstream name;
+			name << "peakanalyzer-" << std::hex << std::hash<std::string>{}(source) << ".img";
+			return directory / name.str();
+		}
+
+		std::optional<RecordImage> RecordImage::attachOrBuild(const std::filesystem::path& image_file, const std::filesystem::path& gff_file)
+		{
+			if (auto image = attach(image_file, gff_file)) {
+				return image;
+			}
+
+			auto lock_file = image_file;
+			lock_file += ".lock";
+			FileLock lock{ lock_file };
+			if (!lock.is_locked()) {
+				LOG(ERROR) << "Could not lock " << lock_file.string();
+				return std::nullopt;
+			}
+
+			//Another process may have published the image while this one was waiting for the lock
+			if (auto image = attach(image_file, gff_file)) {
+				return image;
+			}
+
+			LOG(INFO) << "Building the shared record image " << image_file.string() << " of " << gff_file.string();
+			const auto cds_records = fetchRecords(Records{ gff_file }, Record::Type::CDS);
+			if (cds_records.size() == 0) {
+				LOG(ERROR) << "No CDS records could be read from " << gff_file.string();
+				return std::nullopt;
+			}
+			if (!publish(cds_records, image_file, gff_file)) {
+				return std::nullopt;
+			}
+			return attach(image_file, gff_file);
+		}
+
+		std::optional<RecordImage> RecordImage::attach(const std::filesystem::path& image_file, const std::filesystem::path& gff_file)
+		{
+			const auto source = fingerprint(gff_file);
+			if (!source) {
+				return std::nullopt;
+			}
+
+			std::error_code error;
+			if (!std::filesystem::exists(image_file, error)) {
+				return std::nullopt;
+			}
+			if (!isOwnFile(image_file)) {
+				LOG(WARNING) << image_file.string() << " is not a regular file owned and only writable by this user, ignoring it";
+				return std::nullopt;
+			}
+
+			RecordImage image;
+			image.mapping = io::MappedFile{ image_file };
+			if (!image.mapping.is_open() || image.mapping.size() < sizeof(ImageHeader)) {
+				return std::nullopt;
+			}
+
+			ImageHeader header;
+			std::memcpy(&header, image.mapping.data(), sizeof(header));
+			if (!std::equal(std::begin(image_magic), std::end(image_magic), std::begin(header.magic)) || header.byte_order != byte_order_mark) {
+				LOG(WARNING) << image_file.string() << " is not a record image of this machine, ignoring it";
+				return std::nullopt;
+			}
+			if (header.source_size != source->size || header.source_modification_time != source->modification_time) {
+				LOG(INFO) << image_file.string() << " is older than " << gff_file.string() << ", ignoring it";
+				return std::nullopt;
+			}
+			//Written so that no sum can overflow, as the image may have been tampered with
+			auto fits = [&header](uint64_t offset, uint64_t count, uint64_t width) {
+				return offset <= header.image_size && count <= (header.image_size - offset) / width;
+			};
+			if (header.image_size != image.mapping.size()
+				|| header.sequences_offset % alignof(ImageSequence) != 0
+				|| !fits(header.sequences_offset, header.sequence_count, sizeof(ImageSequence))
+				|| header.entries_offset % alignof(Entry) != 0
+				|| !fits(header.entries_offset, header.entry_count, sizeof(Entry))) {
+				LOG(WARNING) << image_file.string() << " is truncated, ignoring it";
+				return std::nullopt;
+			}
+
+			const auto* sequence_table = reinterpret_cast<const ImageSequence*>(image.mapping.data() + header.sequences_offset);
+			const auto* entries = reinterpret_cast<const Entry*>(image.mapping.data() + header.entries_offset);
+			//transcriptId() reads the identifiers without any check, so every one of them has to lie within the image
+			for (uint64_t e = 0; e < header.entry_count; ++e) {
+				if (!fits(entries[e].transcript_id_offset, entries[e].transcript_id_length, 1)) {
+					LOG(WARNING) << image_file.string() << " is corrupt, ignoring it";
+					return std::nullopt;
+				}
+			}
+			for (uint32_t s = 0; s < header.sequence_count; ++s) {
+				const auto& sequence = sequence_table[s];
+				if (!fits(sequence.name_offset, sequence.name_length, 1) || sequence.first_entry > header.entry_count || sequence.entry_count > header.entry_count - sequence.first_entry) {
+					LOG(WARNING) << image_file.string() << " is corrupt, ignoring it";
+					return std::nullopt;
+				}
+				image.sequences.emplace(std::string{ image.mapping.data() + sequence.name_offset, sequence.name_length },
+					std::span<const Entry>{ entries + sequence.first_entry, sequence.entry_count });
+			}
+			LOG(INFO) << "Attached to the shared record image " << image_file.string() << " holding " << header.entry_count << " records";
+			return image;
+		}
+
+		bool RecordImage::publish(const Records& records, const std::filesystem::path& image_file, const std::filesystem::path& gff_file)
+		{
+			const auto source = fingerprint(gff_file);
+			if (!source) {
+				LOG(ERROR) << "Could not read the size and modification time of " << gff_file.string();
+				return false;
+			}
+
+			std::vector<std::string> sequence_ids;
+			for (const auto& [sequence_id, entries] : records) {
+				sequence_ids.push_back(sequence_id);
+			}
+			std::sort(std::begin(sequence_ids), std::end(sequence_ids));
+
+			ImageHeader header = {};
+			std::copy(std::begin(image_magic), std::end(image_magic), header.magic);
+			header.byte_order = byte_order_mark;
+			header.sequence_count = static_cast<uint32_t>(sequence_ids.size());
+			header.source_size = source->size;
+			header.source_modification_time = source->modification_time;
+			header.sequences_offset = sizeof(ImageHeader);
+			header.entries_offset = header.sequences_offset + sequence_ids.size() * sizeof(ImageSequence);
+
+			//Strings follow the entries; consecutive CDS records of a transcript share one copy of its identifier
+			std::vector<ImageSequence> sequence_table;
+			std::vector<Entry> entries;
+			std::string strings;
+			std::vector<uint64_t> name_offsets;
+			for (const auto& sequence_id : sequence_ids) {
+				name_offsets.push_back(strings.size());
+				strings += sequence_id;
+
+				const auto first_entry = entries.size();
+				std::string previous_transcript_id;
+				uint64_t previous_transcript_id_offset = 0;
+				for (const auto& record : records.data(sequence_id)) {
+					if (record.type != Record::Type::CDS) {
+						continue;
+					}
+					auto transcript_id = extractAttribute(record, "ID=CDS");
+					if (entries.size() == first_entry || transcript_id != previous_transcript_id) {
+						previous_transcript_id_offset = strings.size();
+						strings += transcript_id;
+						previous_transcript_id = std::move(transcript_id);
+					}
+
+					Entry entry;
+					std::memset(&entry, 0, sizeof(entry));
+					entry.start = record.start();
+					entry.end = record.end();
+					entry.transcript_id_offset = previous_transcript_id_offset;
+					entry.transcript_id_length = static_cast<uint32_t>(previous_transcript_id.size());
+					entry.type = record.type;
+					entry.strand = record.strand;
+					entries.push_back(entry);
+				}
+				sequence_table.push_back(ImageSequence{ .name_offset = 0, .name_length = sequence_id.size(), .first_entry = first_entry, .entry_count = entries.size() - first_entry });
+			}
+
+			header.entry_count = entries.size();
+			const auto strings_offset = header.entries_offset + entries.size() * sizeof(Entry);
+			header.image_size = strings_offset + strings.size();
+			for (std::size_t s = 0; s < sequence_table.size(); ++s) {
+				sequence_table[s].name_offset = strings_offset + name_offsets[s];
+			}
+			for (auto& entry : entries) {
+				entry.transcript_id_offset += strings_offset;
+			}
+
+			auto partial_file = image_file;
+			partial_file += ".partial";
+			//A partial file left behind by a build that did not finish is replaced, anything else there is refused below
+			std::error_code error;
+			std::filesystem::remove(partial_file, error);
+			if (!createOwnFile(partial_file)) {
+				LOG(ERROR) << "Could not create " << partial_file.string();
+				return false;
+			}
+			{
+				std::ofstream f{ partial_file, std::ios::binary | std::ios::trunc };
+				if (!f.is_open()) {
+					LOG(ERROR) << "Could not write " << partial_file.string();
+					return false;
+				}
+				writeRaw(f, header);
+				f.write(reinterpret_cast<const char*>(sequence_table.data()), sequence_table.size() * sizeof(ImageSequence));
+				f.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(Entry));
+				f.write(strings.data(), strings.size());
+				if (!f) {
+					LOG(ERROR) << "Could not write " << partial_file.string();
+					return false;
+				}
+			}
+
+			std::filesystem::rename(partial_file, image_file, error);
+			if (error) {
+				LOG(ERROR) << "Could not move " << partial_file.string() << " into place: " << error.message();
+				std::filesystem::remove(partial_file, error);
+				return false;
+			}
+			LOG(INFO) << "Published " << entries.size() << " records in " << image_file.string();
+			return true;
+		}
+
+		std::span<const RecordImage::Entry> RecordImage::recordsOn(const std::string& sequence_id) const
+		{
+			const auto sequence = sequences.find(sequence_id);
+			if (sequence == std::end(sequences)) {
+				return {};
+			}
+			return sequence->second;
+		}
+
+		std::string_view RecordImage::transcriptId(const Entry& entry) const
+		{
+			return std::string_view{ mapping.data() + entry.transcript_id_offset, entry.transcript_id_length };
+		}
+
+		std::size_t RecordImage::size() const
+		{
+			std::size_t records_number = 0;
+			for (const auto& [sequence_id, entries] : sequences) {
+				records_number += entries.size();
+			}
+			return records_number;
+		}
+	}
+}
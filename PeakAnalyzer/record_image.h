@@ -0,0 +1,97 @@
+#ifndef BIOSCRIPTS_RECORD_IMAGE_H
+#define BIOSCRIPTS_RECORD_IMAGE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "gff.h"
+#include "input.h"
+#include "range.h"
+#include "strand.h"
+
+namespace bioscripts
+{
+	namespace gff
+	{
+		/**
+		 * @brief  Read-only image of the CDS records of a GFF file, laid out to be memory mapped and queried in place.
+		 *
+		 * The image holds no pointers: every reference is an offset from the start of the image, so each process can
+		 * map it at a different address. Processes attaching to the same image file share one copy of it in memory,
+		 * which is why it is meant to be placed on a memory-backed file system such as /dev/shm. The image is written
+		 * in the byte order of the machine that builds it and is only meant to be used on that machine.
+		 */
+		class RecordImage
+		{
+		public:
+			struct Entry
+			{
+				uint64_t start;
+				uint64_t end;
+				uint64_t transcript_id_offset;
+				uint32_t transcript_id_length;
+				Record::Type type;
+				Strand strand;
+
+				Range span() const
+				{
+					return Range{ start, end };
+				}
+			};
+
+			/**
+			 * @brief  Attach to the image of @a gff_file, building and publishing it first if no up to date image exists.
+			 *
+			 * The build is guarded by a lock file next to @a image_file, so when many processes start at once exactly
+			 * one of them parses @a gff_file while the others wait for it and then attach.
+			 * @return  The attached image, or an empty optional if it could neither be attached nor built.
+			 */
+			static std::optional<RecordImage> attachOrBuild(const std::filesystem::path& image_file, const std::filesystem::path& gff_file);
+
+			/**
+			 * @brief  Attach to @a image_file if it is a complete image of the current contents of @a gff_file, owned and only
+			 *		   writable by the current user, and every string it refers to lies within it.
+			 */
+			static std::optional<RecordImage> attach(const std::filesystem::path& image_file, const std::filesystem::path& gff_file);
+
+			/**
+			 * @brief  Write the CDS records of @a records as an image of @a gff_file.
+			 *
+			 * The image is written under a temporary name and renamed into place, so a process attaching at the same
+			 * time either finds the complete image or none at all.
+			 */
+			static bool publish(const Records& records, const std::filesystem::path& image_file, const std::filesystem::path& gff_file);
+
+			/**
+			 * @brief  The records on @a sequence_id ordered by their start position, empty if there are none.
+			 */
+			std::span<const Entry> recordsOn(const std::string& sequence_id) const;
+
+			/**
+			 * @brief  Value of the "ID=CDS" attribute of @a entry.
+			 */
+			std::string_view transcriptId(const Entry& entry) const;
+
+			/**
+			 * @brief  Return the number of records in the image.
+			 */
+			std::size_t size() const;
+
+		private:
+			io::MappedFile mapping;
+			std::unordered_map<std::string, std::span<const Entry>> sequences;
+		};
+
+		/**
+		 * @brief  Default location of the image of @a gff_file, in /dev/shm where available.
+		 */
+		std::filesystem::path defaultImagePath(const std::filesystem::path& gff_file);
+	}
+}
+
+#endif // !BIOSCRIPTS_RECORD_IMAGE_H
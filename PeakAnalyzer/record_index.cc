@@ -0,0 +1,67 @@
+#include <algorithm>
+
+#include "record_index.h"
+
+namespace
+{
+	constexpr std::size_t type_count = static_cast<std::size_t>(bioscripts::gff::Record::Type::Unknown) + 1;
+}
+
+namespace bioscripts
+{
+	namespace gff
+	{
+		RecordIndex::RecordIndex(const Records& records) : records(records)
+		{
+			for (const auto& [sequence_id, sequence_records] : records) {
+				std::vector<std::vector<Interval>> intervals(type_count);
+				for (std::size_t i = 0; i < sequence_records.size(); ++i) {
+					intervals[static_cast<std::size_t>(sequence_records[i].type)].push_back(Interval{ .span = sequence_records[i].span, .id = i });
+				}
+
+				auto& sequence_partitions = partitions[sequence_id];
+				for (auto& type_intervals : intervals) {
+					sequence_partitions.emplace_back(std::move(type_intervals));
+				}
+			}
+		}
+
+		std::vector<Neighbour> RecordIndex::nearest(const std::string& sequence_id, Position position, std::size_t k, Distance max_distance, Record::Type type) const
+		{
+			std::vector<Neighbour> neighbours;
+			const auto* tree = partition(sequence_id, type);
+			if (tree == nullptr) {
+				return neighbours;
+			}
+			const auto& sequence_records = records.data(sequence_id);
+			for (const auto& nearby : tree->nearest(position, k, max_distance)) {
+				neighbours.push_back(Neighbour{ .record = &sequence_records[nearby.id], .distance = nearby.distance });
+			}
+			return neighbours;
+		}
+
+		std::vector<const Record*> RecordIndex::within(const std::string& sequence_id, Position position, Distance window, Record::Type type) const
+		{
+			std::vector<const Record*> found_records;
+			const auto* tree = partition(sequence_id, type);
+			if (tree == nullptr) {
+				return found_records;
+			}
+			const auto& sequence_records = records.data(sequence_id);
+			const auto query = Range{ position - (std::min)(position, window), position + window + 1 };
+			for (const auto i : tree->overlapping(query)) {
+				found_records.push_back(&sequence_records[i]);
+			}
+			return found_records;
+		}
+
+		const IntervalTree* RecordIndex::partition(const std::string& sequence_id, Record::Type type) const
+		{
+			const auto sequence_partitions = partitions.find(sequence_id);
+			if (sequence_partitions == std::end(partitions)) {
+				return nullptr;
+			}
+			return &sequence_partitions->second[static_cast<std::size_t>(type)];
+		}
+	}
+}
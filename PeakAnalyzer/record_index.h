@@ -0,0 +1,63 @@
+#ifndef BIOSCRIPTS_RECORD_INDEX_H
+#define BIOSCRIPTS_RECORD_INDEX_H
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "gff.h"
+#include "interval_tree.h"
+#include "range.h"
+
+namespace bioscripts
+{
+	namespace gff
+	{
+		/**
+		 * @brief  A record found near a position, with its distance to that position.
+		 */
+		struct Neighbour
+		{
+			const Record* record;
+			Distance distance;
+		};
+
+		/**
+		 * @brief  Index over the records of a gff::Records answering neighbourhood queries without scanning a sequence.
+		 *
+		 * The records of every sequence are partitioned by type, and each partition is held in an interval tree. The
+		 * index refers to the records it was built from, which must neither be changed nor destroyed while it is in use.
+		 */
+		class RecordIndex
+		{
+		public:
+			explicit RecordIndex(const Records& records);
+
+			/**
+			 * @brief  Find the @a k records of @a type on @a sequence_id closest to @a position and no further than
+			 *		   @a max_distance from it, in O(log n + k).
+			 *
+			 * A record containing @a position is at distance 0, any other record is as far away as its base closest
+			 * to @a position. Of two records at the same distance the upstream one comes first.
+			 * @return  The records found, closest first.
+			 */
+			std::vector<Neighbour> nearest(const std::string& sequence_id, Position position, std::size_t k, Distance max_distance, Record::Type type) const;
+
+			/**
+			 * @brief  Find all records of @a type on @a sequence_id with at least one base within @a window bases of
+			 *		   @a position, in O(log n + k).
+			 * @return  The records found, ordered by their start position.
+			 */
+			std::vector<const Record*> within(const std::string& sequence_id, Position position, Distance window, Record::Type type) const;
+
+		private:
+			const IntervalTree* partition(const std::string& sequence_id, Record::Type type) const;
+
+			const Records& records;
+			std::unordered_map<std::string, std::vector<IntervalTree>> partitions; //Per sequence, one tree per record type
+		};
+	}
+}
+
+#endif // !BIOSCRIPTS_RECORD_INDEX_H
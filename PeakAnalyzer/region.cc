@@ -0,0 +1,60 @@
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+#include "region.h"
+
+namespace bioscripts
+{
+	std::optional<Region> parseRegion(const std::string& str)
+	{
+		const auto colon_pos = str.rfind(':');
+		if (colon_pos == std::string::npos) {
+			if (str.empty()) {
+				return std::nullopt;
+			}
+			return Region{ .sequence_id = str, .span = Range{ 0, (std::numeric_limits<Position>::max)() } };
+		}
+
+		auto sequence_id = str.substr(0, colon_pos);
+		auto coordinates = str.substr(colon_pos + 1);
+		//Thousands separators are commonly copied from genome browsers
+		std::erase(coordinates, ',');
+		if (sequence_id.empty() || coordinates.empty()) {
+			return std::nullopt;
+		}
+
+		auto isDigit = [](char c) {
+			return c >= '0' && c <= '9';
+		};
+		if (!isDigit(coordinates.front())) {
+			return std::nullopt;
+		}
+
+		try {
+			std::size_t parsed_characters = 0;
+			const Position start_pos = std::stoull(coordinates, &parsed_characters);
+			Position end_pos = (std::numeric_limits<Position>::max)() - 1;
+			if (parsed_characters != coordinates.size()) {
+				if (coordinates[parsed_characters] != '-' || parsed_characters + 1 == coordinates.size() || !isDigit(coordinates[parsed_characters + 1])) {
+					return std::nullopt;
+				}
+				end_pos = std::stoull(coordinates.substr(parsed_characters + 1));
+			}
+			if (end_pos < start_pos) {
+				return std::nullopt;
+			}
+			//Add one to end-pos because Range is 0-based [start, end)
+			//but region coordinates are [start, end]
+			return Region{ .sequence_id = sequence_id, .span = Range{ start_pos, end_pos + 1 } };
+		}
+		catch (const std::logic_error&) {
+			return std::nullopt;
+		}
+	}
+
+	bool overlap(const Region& region, const std::string& sequence_id, const Range& span)
+	{
+		return region.sequence_id == sequence_id && overlap(region.span, span);
+	}
+}
@@ -0,0 +1,36 @@
+#ifndef BIOSCRIPTS_REGION_H
+#define BIOSCRIPTS_REGION_H
+
+#include <optional>
+#include <string>
+
+#include "range.h"
+
+namespace bioscripts
+{
+	/**
+	 * @brief  A range on a named sequence, e.g. the locus "4:9449114-9450906".
+	 *
+	 * The span uses the same convention as GFF records and peaks, i.e. [start, end + 1) of the 1-based, inclusive file coordinates.
+	 */
+	struct Region
+	{
+		std::string sequence_id;
+		Range span;
+	};
+
+	/**
+	 * @brief  Parse a samtools-style region: "sequence", "sequence:start" or "sequence:start-end", with 1-based inclusive coordinates.
+	 *
+	 * A region without coordinates covers the whole sequence, a region without an end extends to the end of the sequence.
+	 * @return  The parsed region, or an empty optional if @a str is malformed.
+	 */
+	std::optional<Region> parseRegion(const std::string& str);
+
+	/**
+	 * @brief  Determines whether @a span on the sequence @a sequence_id overlaps the @a region.
+	 */
+	bool overlap(const Region& region, const std::string& sequence_id, const Range& span);
+}
+
+#endif // !BIOSCRIPTS_REGION_H
@@ -0,0 +1,184 @@
+#include <fstream>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include "input.h"
+#include "results_cache.h"
+
+#include "easylogging++.h"
+
+namespace
+{
+	constexpr std::string_view cache_header = "#PeakAnalyzer cache 1";
+	constexpr std::string_view no_transcripts = "-";
+
+	/**
+	 * @brief  Number of tab-separated fields of the query key of a peak under @a settings.
+	 */
+	std::size_t keyFieldCount(const bioscripts::annotation::Settings& settings)
+	{
+		const std::size_t position_fields = settings.query == bioscripts::annotation::Query::Span ? 2 : 1;
+		const std::size_t strand_fields = settings.strand == bioscripts::annotation::StrandFilter::Any ? 0 : 1;
+		return 2 + position_fields + strand_fields;
+	}
+
+	/**
+	 * @brief  Split @a line at every tab, keeping empty fields.
+	 */
+	std::vector<std::string_view> splitFields(std::string_view line)
+	{
+		std::vector<std::string_view> fields;
+		std::size_t field_start = 0;
+		while (true) {
+			const auto tab = line.find('\t', field_start);
+			fields.push_back(line.substr(field_start, tab - field_start));
+			if (tab == std::string_view::npos) {
+				return fields;
+			}
+			field_start = tab + 1;
+		}
+	}
+}
+
+namespace bioscripts
+{
+	namespace cache
+	{
+		ResultsCache::ResultsCache(std::string annotation_fingerprint, annotation::Settings settings) : fingerprint(std::move(annotation_fingerprint)), settings(settings)
+		{
+		}
+
+		ResultsCache ResultsCache::load(const std::filesystem::path& cache_file, const std::string& annotation_fingerprint, const annotation::Settings& settings)
+		{
+			ResultsCache cache{ annotation_fingerprint, settings };
+			std::error_code error;
+			if (!std::filesystem::exists(cache_file, error)) {
+				return cache;
+			}
+
+			io::LineReader f{ cache_file };
+			std::string line;
+			if (!f.is_open() || !f.getline(line) || line != std::string{ cache_header } + '\t' + annotation_fingerprint + '\t' + annotation::describe(settings)) {
+				LOG(INFO) << cache_file.string() << " was written for another annotation, ignoring it";
+				return cache;
+			}
+
+			try {
+				while (f.getline(line)) {
+					//the query key, then either the no_transcripts marker or a CDS record of the transcript with the given number
+					const auto fields = splitFields(line);
+					const auto key_fields = keyFieldCount(settings);
+					if (fields.size() != key_fields + 1 && fields.size() != key_fields + 4) {
+						throw std::logic_error("Malformed row \"" + line + "\"");
+					}
+					auto& peak_annotation = cache.annotations[std::string{ line, 0, static_cast<std::size_t>(fields[key_fields].data() - line.data() - 1) }];
+					if (fields.size() == key_fields + 1) {
+						continue;
+					}
+
+					const auto transcript_number = std::stoull(std::string{ fields[key_fields] });
+					if (transcript_number == peak_annotation.size()) {
+						peak_annotation.emplace_back();
+					}
+					else if (transcript_number + 1 != peak_annotation.size()) {
+						throw std::logic_error("Transcripts out of order in row \"" + line + "\"");
+					}
+					peak_annotation.back().push_back(annotation::CodingSegment{
+						.transcript_id = std::string{ fields[key_fields + 1] },
+						.span = Range{ std::stoull(std::string{ fields[key_fields + 2] }), std::stoull(std::string{ fields[key_fields + 3] }) }
+						});
+				}
+			}
+			catch (const std::logic_error& e) {
+				LOG(WARNING) << cache_file.string() << " is corrupt, ignoring it: " << e.what();
+				return ResultsCache{ annotation_fingerprint, settings };
+			}
+
+			LOG(INFO) << "Loaded " << cache.size() << " cached peak annotations from " << cache_file.string();
+			return cache;
+		}
+
+		bool ResultsCache::save(const std::filesystem::path& cache_file) const
+		{
+			auto partial_file = cache_file;
+			partial_file += ".partial";
+			{
+				std::ofstream of{ partial_file, std::ios::binary };
+				if (!of.is_open()) {
+					LOG(ERROR) << "Could not write " << partial_file.string();
+					return false;
+				}
+
+				of << cache_header << '\t' << fingerprint << '\t' << annotation::describe(settings) << '\n';
+				for (const auto& [key, peak_annotation] : annotations) {
+					if (peak_annotation.empty()) {
+						of << key << '\t' << no_transcripts << '\n';
+					}
+					for (std::size_t transcript_number = 0; transcript_number < peak_annotation.size(); ++transcript_number) {
+						for (const auto& segment : peak_annotation[transcript_number]) {
+							of << key << '\t' << transcript_number << '\t' << segment.transcript_id << '\t' << segment.span.start << '\t' << segment.span.end << '\n';
+						}
+					}
+				}
+				if (!of) {
+					LOG(ERROR) << "Could not write " << partial_file.string();
+					return false;
+				}
+			}
+
+			std::error_code error;
+			std::filesystem::rename(partial_file, cache_file, error);
+			if (error) {
+				LOG(ERROR) << "Could not move " << partial_file.string() << " into place: " << error.message();
+				return false;
+			}
+			return true;
+		}
+
+		const annotation::PeakAnnotation* ResultsCache::find(const peak::Peak& peak) const
+		{
+			const auto cached = annotations.find(annotation::queryKey(peak, settings));
+			return cached == std::end(annotations) ? nullptr : &cached->second;
+		}
+
+		void ResultsCache::insert(const peak::Peak& peak, annotation::PeakAnnotation peak_annotation)
+		{
+			annotations.insert_or_assign(annotation::queryKey(peak, settings), std::move(peak_annotation));
+		}
+
+		std::size_t ResultsCache::size() const
+		{
+			return annotations.size();
+		}
+
+		std::optional<std::string> annotationFingerprint(const std::filesystem::path& gff_file)
+		{
+			if (io::isStdin(gff_file)) {
+				return std::nullopt;
+			}
+
+			std::error_code error;
+			const auto location = std::filesystem::weakly_canonical(gff_file, error);
+			if (error) {
+				return std::nullopt;
+			}
+			const auto size = std::filesystem::file_size(gff_file, error);
+			if (error) {
+				return std::nullopt;
+			}
+			const auto modification_time = std::filesystem::last_write_time(gff_file, error);
+			if (error) {
+				return std::nullopt;
+			}
+			return location.string() + '\t' + std::to_string(size) + '\t' + std::to_string(modification_time.time_since_epoch().count());
+		}
+
+		std::filesystem::path cachePath(const std::filesystem::path& output_file)
+		{
+			auto cache_file = output_file;
+			cache_file += ".cache";
+			return cache_file;
+		}
+	}
+}
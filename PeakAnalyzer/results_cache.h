@@ -0,0 +1,70 @@
+#ifndef BIOSCRIPTS_RESULTS_CACHE_H
+#define BIOSCRIPTS_RESULTS_CACHE_H
+
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+#include "annotation.h"
+#include "peak.h"
+
+namespace bioscripts
+{
+	namespace cache
+	{
+		/**
+		 * @brief  Annotations of earlier runs, keyed by the peak columns the annotation depends on.
+		 *
+		 * A peak is annotated from its sequence, its midpoint (or span) and the gene it was called for, so any two peaks
+		 * that agree on these get the same annotation from the same GFF file. Other columns may change freely without
+		 * invalidating the cached result. The whole cache belongs to a single GFF file, identified by its fingerprint,
+		 * and to the annotation settings it was filled with.
+		 */
+		class ResultsCache
+		{
+		public:
+			explicit ResultsCache(std::string annotation_fingerprint, annotation::Settings settings = {});
+
+			/**
+			 * @brief  Load the cache in @a cache_file if it was written for the same @a annotation_fingerprint and @a settings.
+			 * @return  The cache, or an empty cache if the file does not exist, is malformed or belongs to another GFF file
+			 *			or other settings.
+			 */
+			static ResultsCache load(const std::filesystem::path& cache_file, const std::string& annotation_fingerprint, const annotation::Settings& settings = {});
+
+			/**
+			 * @brief  Write the cache to @a cache_file, replacing the previous one only once it is complete.
+			 */
+			bool save(const std::filesystem::path& cache_file) const;
+
+			/**
+			 * @brief  The cached annotation of @a peak, or nullptr if it is not cached.
+			 */
+			const annotation::PeakAnnotation* find(const peak::Peak& peak) const;
+
+			void insert(const peak::Peak& peak, annotation::PeakAnnotation peak_annotation);
+
+			std::size_t size() const;
+
+		private:
+			std::string fingerprint;
+			annotation::Settings settings;
+			std::unordered_map<std::string, annotation::PeakAnnotation> annotations;
+		};
+
+		/**
+		 * @brief  Identify the current contents of @a gff_file by its location, size and modification time.
+		 * @return  The fingerprint, or an empty optional if the file cannot be inspected (e.g. stdin).
+		 */
+		std::optional<std::string> annotationFingerprint(const std::filesystem::path& gff_file);
+
+		/**
+		 * @brief  Location of the cache kept next to @a output_file.
+		 */
+		std::filesystem::path cachePath(const std::filesystem::path& output_file);
+	}
+}
+
+#endif // !BIOSCRIPTS_RESULTS_CACHE_H
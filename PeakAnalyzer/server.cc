@@ -0,0 +1,356 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "annotation.h"
+#include "peak.h"
+#include "server.h"
+
+#include "easylogging++.h"
+
+namespace
+{
+	//A request is a single header line, optionally followed by the rows of a peak file:
+	//  "PATH <peak file>"  annotate the peak file at the given path
+	//  "ROWS"              annotate the peak table that follows the header line
+	//The reply is either "OK <number of rows>" followed by the rows of transcript_data.txt, or "ERROR <message>".
+	constexpr std::string_view path_request = "PATH ";
+	constexpr std::string_view rows_request = "ROWS";
+	constexpr std::string_view success_reply = "OK ";
+	constexpr std::string_view failure_reply = "ERROR ";
+
+	//Requests beyond this size are refused instead of being buffered, a peak table of this size is far beyond any real one
+	constexpr std::size_t max_request_size = std::size_t{ 1 } << 28;
+	//A client that sends nothing for this long gives up its worker
+	constexpr int receive_timeout_seconds = 30;
+
+	bioscripts::peak::Peaks parsePeakTable(const std::string& peak_table)
+	{
+		bioscripts::peak::Peaks peaks;
+		std::istringstream stream{ peak_table };
+		std::string line;
+		std::getline(stream, line); /* Skips the header in database file */
+		while (std::getline(stream, line)) {
+			if (line.ends_with('\r')) {
+				line.pop_back();
+			}
+			auto peak = bioscripts::peak::parsePeak(line);
+			if (peak) {
+				peaks.add(std::move(*peak));
+			}
+		}
+		return peaks;
+	}
+
+#ifndef _WIN32
+	volatile std::sig_atomic_t stop_requested = 0;
+
+	void requestStop(int)
+	{
+		stop_requested = 1;
+	}
+
+	bool makeAddress(const std::filesystem::path& socket_path, sockaddr_un& address)
+	{
+		const auto path = socket_path.string();
+		std::memset(&address, 0, sizeof(address));
+		if (path.size() >= sizeof(address.sun_path)) {
+			LOG(ERROR) << "Socket path " << path << " is longer than the " << sizeof(address.sun_path) - 1 << " characters a Unix domain socket allows";
+			return false;
+		}
+		address.sun_family = AF_UNIX;
+		std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+		return true;
+	}
+
+	/**
+	 * @brief  Determines whether a server accepts connections at @a address.
+	 */
+	bool isListening(const sockaddr_un& address)
+	{
+		const int probe = ::socket(AF_UNIX, SOCK_STREAM, 0);
+		if (probe < 0) {
+			return false;
+		}
+		const bool connected = ::connect(probe, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+		::close(probe);
+		return connected;
+	}
+
+	/**
+	 * @brief  Read from @a fd until the other side stops sending.
+	 * @return  False if reading failed or more than @a max_size bytes arrived.
+	 */
+	bool readAll(int fd, std::string& data, std::size_t max_size = (std::numeric_limits<std::size_t>::max)())
+	{
+		char buffer[1 << 16];
+		while (true) {
+			const auto bytes_read = ::read(fd, buffer, sizeof(buffer));
+			if (bytes_read == 0) {
+				return true;
+			}
+			if (bytes_read < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				return false;
+			}
+			if (static_cast<std::size_t>(bytes_read) > max_size - data.size()) {
+				return false;
+			}
+			data.append(buffer, static_cast<std::size_t>(bytes_read));
+		}
+	}
+
+	bool writeAll(int fd, std::string_view data)
+	{
+		while (!data.empty()) {
+			const auto bytes_written = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+			if (bytes_written < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				return false;
+			}
+			data.remove_prefix(static_cast<std::size_t>(bytes_written));
+		}
+		return true;
+	}
+#endif
+}
+
+namespace bioscripts
+{
+	namespace server
+	{
+		std::filesystem::path defaultSocketPath()
+		{
+			std::error_code error;
+			auto directory = std::filesystem::temp_directory_path(error);
+			if (error) {
+				directory = ".";
+			}
+			return directory / "peakanalyzer.sock";
+		}
+
+		std::string peakFileRequest(const std::filesystem::path& peaks_file)
+		{
+			return std::string{ path_request } + peaks_file.string() + "\n";
+		}
+
+		std::string inlinePeaksRequest(const std::string& peak_table)
+		{
+			return std::string{ rows_request } + "\n" + peak_table;
+		}
+
+		std::string answer(const std::string& request, const annotation::RecordsIndex& index)
+		{
+			const auto header_end = (std::min)(request.find('\n'), request.size());
+			const auto header = std::string_view{ request }.substr(0, header_end);
+
+			try {
+				peak::Peaks peaks;
+				if (header.starts_with(path_request)) {
+					const std::filesystem::path peaks_file{ header.substr(path_request.size()) };
+					std::error_code error;
+					if (!std::filesystem::is_regular_file(peaks_file, error)) {
+						return std::string{ failure_reply } + "Could not open " + peaks_file.string() + "\n";
+					}
+					peaks = peak::Peaks{ peaks_file };
+				}
+				else if (header == rows_request) {
+					peaks = parsePeakTable(request.substr((std::min)(header_end + 1, request.size())));
+				}
+				else {
+					return std::string{ failure_reply } + "Unknown request\n";
+				}
+
+				const auto data = annotation::flatten(index.annotate(peaks));
+				std::ostringstream reply;
+				reply << success_reply << data.size() << "\n";
+				annotation::write(reply, data);
+				return reply.str();
+			}
+			catch (const std::exception& e) {
+				return std::string{ failure_reply } + e.what() + "\n";
+			}
+		}
+
+#ifdef _WIN32
+		int serve(const std::filesystem::path& socket_path, const gff::Records& records, const annotation::Settings& settings)
+		{
+			LOG(ERROR) << "Serving requests over a Unix domain socket is not supported on this platform";
+			return 1;
+		}
+
+		std::optional<Reply> query(const std::filesystem::path& socket_path, const std::string& request)
+		{
+			LOG(ERROR) << "Sending requests over a Unix domain socket is not supported on this platform";
+			return std::nullopt;
+		}
+#else
+		int serve(const std::filesystem::path& socket_path, const gff::Records& records, const annotation::Settings& settings)
+		{
+			sockaddr_un address;
+			if (!makeAddress(socket_path, address)) {
+				return 1;
+			}
+
+			const int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+			if (listener < 0) {
+				LOG(ERROR) << "Could not create a socket: " << std::strerror(errno);
+				return 1;
+			}
+
+			//A socket file left behind by a server that did not shut down cleanly would make bind fail, but one that
+			//a running server still listens on must be left alone
+			if (isListening(address)) {
+				LOG(ERROR) << "Another server is already listening on " << socket_path.string();
+				::close(listener);
+				return 1;
+			}
+			std::error_code error;
+			if (std::filesystem::is_socket(socket_path, error)) {
+				std::filesystem::remove(socket_path, error);
+			}
+			//Requests can name any file the server may read, so only its own user may connect. Creating the socket
+			//file with these permissions leaves no moment in which others could
+			const auto previous_mask = ::umask(S_IRWXG | S_IRWXO | S_IXUSR);
+			const bool bound = ::bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+			::umask(previous_mask);
+			if (!bound || ::listen(listener, SOMAXCONN) != 0) {
+				LOG(ERROR) << "Could not listen on " << socket_path.string() << ": " << std::strerror(errno);
+				::close(listener);
+				return 1;
+			}
+
+			struct sigaction action = {};
+			action.sa_handler = requestStop;
+			sigemptyset(&action.sa_mask);
+			::sigaction(SIGINT, &action, nullptr);
+			::sigaction(SIGTERM, &action, nullptr);
+
+			//Connections beyond this many wait in the backlog of the socket until a worker is free
+			const std::size_t max_workers = (std::max)(std::thread::hardware_concurrency(), 1u);
+			//Indexed once up front, so every request only costs its lookups
+			const annotation::RecordsIndex index{ records, settings };
+			LOG(INFO) << "Serving " << records.size() << " GFF records on " << socket_path.string() << " with up to " << max_workers << " workers";
+			std::atomic<std::size_t> active_connections = 0;
+			while (!stop_requested) {
+				if (active_connections >= max_workers) {
+					std::this_thread::sleep_for(std::chrono::milliseconds{ 10 });
+					continue;
+				}
+
+				//Waiting with a timeout rather than blocking in accept lets the loop notice a stop request promptly
+				pollfd listening = { .fd = listener, .events = POLLIN, .revents = 0 };
+				if (::poll(&listening, 1, 500) <= 0) {
+					continue;
+				}
+
+				const int connection = ::accept(listener, nullptr, nullptr);
+				if (connection < 0) {
+					if (errno != EINTR && errno != ECONNABORTED) {
+						LOG(WARNING) << "Could not accept a connection: " << std::strerror(errno);
+					}
+					continue;
+				}
+
+				const timeval receive_timeout = { .tv_sec = receive_timeout_seconds, .tv_usec = 0 };
+				::setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &receive_timeout, sizeof(receive_timeout));
+
+				++active_connections;
+				std::thread{ [connection, &index, &active_connections]() {
+					std::string request;
+					if (!readAll(connection, request, max_request_size)) {
+						LOG(WARNING) << "Dropped a request that could not be read completely or exceeds " << max_request_size << " bytes";
+						writeAll(connection, std::string{ failure_reply } + "Request could not be read or is too large\n");
+					}
+					else {
+						const auto started = std::chrono::steady_clock::now();
+						const auto reply = answer(request, index);
+						const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started);
+						LOG(INFO) << "Answered a request of " << request.size() << " bytes in " << elapsed.count() << " ms";
+						if (!writeAll(connection, reply)) {
+							LOG(WARNING) << "Could not send a reply: " << std::strerror(errno);
+						}
+					}
+					::close(connection);
+					--active_connections;
+				} }.detach();
+			}
+
+			LOG(INFO) << "Shutting down, waiting for " << active_connections.load() << " requests to finish";
+			::close(listener);
+			std::filesystem::remove(socket_path, error);
+			while (active_connections > 0) {
+				std::this_thread::sleep_for(std::chrono::milliseconds{ 10 });
+			}
+			return 0;
+		}
+
+		std::optional<Reply> query(const std::filesystem::path& socket_path, const std::string& request)
+		{
+			sockaddr_un address;
+			if (!makeAddress(socket_path, address)) {
+				return std::nullopt;
+			}
+
+			const int connection = ::socket(AF_UNIX, SOCK_STREAM, 0);
+			if (connection < 0) {
+				LOG(ERROR) << "Could not create a socket: " << std::strerror(errno);
+				return std::nullopt;
+			}
+			if (::connect(connection, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+				LOG(ERROR) << "Could not connect to " << socket_path.string() << ": " << std::strerror(errno);
+				::close(connection);
+				return std::nullopt;
+			}
+
+			//Closing the sending side tells the server that the request is complete
+			std::string reply;
+			const bool exchanged = writeAll(connection, request) && ::shutdown(connection, SHUT_WR) == 0 && readAll(connection, reply);
+			::close(connection);
+			if (!exchanged) {
+				LOG(ERROR) << "Lost the connection to " << socket_path.string();
+				return std::nullopt;
+			}
+
+			const auto header_end = (std::min)(reply.find('\n'), reply.size());
+			const auto header = std::string_view{ reply }.substr(0, header_end);
+			if (header.starts_with(success_reply)) {
+				try {
+					return Reply{
+						.success = true,
+						.row_count = std::stoull(std::string{ header.substr(success_reply.size()) }),
+						.content = reply.substr((std::min)(header_end + 1, reply.size()))
+					};
+				}
+				catch (const std::logic_error&) {
+				}
+			}
+			else if (header.starts_with(failure_reply)) {
+				return Reply{ .success = false, .row_count = 0, .content = std::string{ header.substr(failure_reply.size()) } };
+			}
+			LOG(ERROR) << "Received a malformed reply from " << socket_path.string();
+			return std::nullopt;
+		}
+#endif
+	}
+}
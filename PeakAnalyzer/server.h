@@ -0,0 +1,70 @@
+#ifndef BIOSCRIPTS_SERVER_H
+#define BIOSCRIPTS_SERVER_H
+
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <string>
+
+#include "annotation.h"
+#include "gff.h"
+
+namespace bioscripts
+{
+	namespace server
+	{
+		/**
+		 * @brief  Answer of the server to a single request.
+		 */
+		struct Reply
+		{
+			bool success;
+			std::size_t row_count;
+			std::string content; //The transcript_data.txt rows, or the error message if the request failed
+		};
+
+		/**
+		 * @brief  Socket used when none is given on the command line.
+		 */
+		std::filesystem::path defaultSocketPath();
+
+		/**
+		 * @brief  Request asking the server to read and annotate the peak file at @a peaks_file, which is resolved
+		 *		   by the server and therefore has to be absolute or relative to the server's working directory.
+		 */
+		std::string peakFileRequest(const std::filesystem::path& peaks_file);
+
+		/**
+		 * @brief  Request carrying the contents of a peak file, header line included, for the server to annotate.
+		 */
+		std::string inlinePeaksRequest(const std::string& peak_table);
+
+		/**
+		 * @brief  The reply to @a request, with its peaks annotated against @a index.
+		 * @return  "OK <number of rows>" followed by the rows of transcript_data.txt, or "ERROR <message>" if the
+		 *			request is unknown or its peaks could not be read.
+		 */
+		std::string answer(const std::string& request, const annotation::RecordsIndex& index);
+
+		/**
+		 * @brief  Annotate the peaks of every request arriving on the Unix domain socket @a socket_path against
+		 *		   @a records, until the process is interrupted or terminated.
+		 *
+		 * The records are indexed once before the first request is accepted. Every connection carries one request
+		 * and is served on its own thread, so a slow request does not hold up the others. At most one request per
+		 * hardware thread is served at a time, further connections wait until one finishes. The index is only read,
+		 * which keeps the concurrent requests independent of each other. Only the user running the server can
+		 * connect to the socket, and the server refuses to start while another one is listening on it.
+		 * @return  The exit code of the server.
+		 */
+		int serve(const std::filesystem::path& socket_path, const gff::Records& records, const annotation::Settings& settings = {});
+
+		/**
+		 * @brief  Send @a request to the server listening on @a socket_path and wait for its reply.
+		 * @return  The reply, or an empty optional if the server could not be reached.
+		 */
+		std::optional<Reply> query(const std::filesystem::path& socket_path, const std::string& request);
+	}
+}
+
+#endif // !BIOSCRIPTS_SERVER_H
@@ -0,0 +1,256 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <queue>
+#include <set>
+#include <stdexcept>
+#include <tuple>
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "input.h"
+#include "shard.h"
+
+#include "easylogging++.h"
+
+namespace
+{
+	constexpr std::string_view partial_header = "#PeakAnalyzer partial";
+
+	/**
+	 * @brief  One partial output being merged, positioned at its next unmerged row.
+	 */
+	struct PartialReader
+	{
+		std::unique_ptr<bioscripts::io::LineReader> reader;
+		std::string line;
+		std::size_t peak_index = 0;
+		std::size_t transcript_number = 0;
+		std::size_t row_start = 0; //Where the transcript identifier starts in line
+
+		/**
+		 * @brief  Move to the next row.
+		 * @return  False at the end of the partial.
+		 * @throws  std::logic_error if the row is malformed.
+		 */
+		bool advance()
+		{
+			if (!reader->getline(line)) {
+				return false;
+			}
+			const auto first_tab = line.find('\t');
+			const auto second_tab = first_tab == std::string::npos ? std::string::npos : line.find('\t', first_tab + 1);
+			if (second_tab == std::string::npos) {
+				throw std::logic_error("Malformed row \"" + line + "\"");
+			}
+			peak_index = std::stoull(line.substr(0, first_tab));
+			transcript_number = std::stoull(line.substr(first_tab + 1, second_tab - first_tab - 1));
+			row_start = second_tab + 1;
+			return true;
+		}
+	};
+}
+
+namespace bioscripts
+{
+	namespace shard
+	{
+		std::vector<std::unordered_set<std::string>> assignSequences(const peak::Peaks& peaks, std::size_t shard_count)
+		{
+			std::map<std::string, std::size_t> peaks_per_sequence;
+			for (const auto& peak : peaks) {
+				++peaks_per_sequence[peak.sequence_id];
+			}
+
+			//Largest sequences first, each to the shard with the fewest peaks so far
+			std::vector<std::pair<std::string, std::size_t>> sequences{ std::begin(peaks_per_sequence), std::end(peaks_per_sequence) };
+			std::stable_sort(std::begin(sequences), std::end(sequences), [](const auto& first, const auto& second) {
+				return first.second > second.second;
+			});
+
+			std::vector<std::unordered_set<std::string>> shards(shard_count);
+			std::vector<std::size_t> shard_peaks(shard_count, 0);
+			for (const auto& [sequence_id, peak_count] : sequences) {
+				const auto lightest = std::min_element(std::begin(shard_peaks), std::end(shard_peaks)) - std::begin(shard_peaks);
+				shards[lightest].insert(sequence_id);
+				shard_peaks[lightest] += peak_count;
+			}
+			return shards;
+		}
+
+		std::filesystem::path partialPath(const std::filesystem::path& output_file, std::size_t shard, std::size_t shard_count)
+		{
+			auto partial_file = output_file;
+			partial_file += ".shard-" + std::to_string(shard) + "-of-" + std::to_string(shard_count);
+			return partial_file;
+		}
+
+		bool writePartial(const std::filesystem::path& partial_file, const ShardAnnotations& shard_annotations)
+		{
+			std::ofstream of{ partial_file, std::ios::binary };
+			if (!of.is_open()) {
+				LOG(ERROR) << "Could not write " << partial_file.string();
+				return false;
+			}
+
+			of << partial_header << "\t" << shard_annotations.shard << "\t" << shard_annotations.shard_count << "\t" << shard_annotations.total_peak_count << "\n";
+			for (std::size_t i = 0; i < shard_annotations.annotations.size(); ++i) {
+				const auto& annotation = shard_annotations.annotations[i];
+				for (std::size_t transcript_number = 0; transcript_number < annotation.size(); ++transcript_number) {
+					for (const auto& segment : annotation[transcript_number]) {
+						of << shard_annotations.peak_indices[i] << "\t" << transcript_number << "\t" << segment.transcript_id << "\t" << segment.span.start << "\t" << segment.span.end << "\n";
+					}
+				}
+			}
+			return static_cast<bool>(of);
+		}
+
+		std::optional<std::size_t> merge(const std::vector<std::filesystem::path>& partial_files, const std::filesystem::path& output_file)
+		{
+			std::vector<PartialReader> partials;
+			std::set<std::size_t> shards_seen;
+			std::optional<std::tuple<std::size_t, std::size_t>> run; //Shard count and total peak count all partials must agree on
+			for (const auto& partial_file : partial_files) {
+				PartialReader partial{ .reader = std::make_unique<io::LineReader>(partial_file), .line = {} };
+				std::string header;
+				if (!partial.reader->is_open() || !partial.reader->getline(header) || !header.starts_with(partial_header)) {
+					LOG(ERROR) << partial_file.string() << " is not a partial output";
+					return std::nullopt;
+				}
+
+				std::size_t shard = 0;
+				std::size_t shard_count = 0;
+				std::size_t total_peak_count = 0;
+				try {
+					std::size_t position = partial_header.size() + 1;
+					std::size_t parsed = 0;
+					shard = std::stoull(header.substr(position), &parsed);
+					position += parsed + 1;
+					shard_count = std::stoull(header.substr(position), &parsed);
+					position += parsed + 1;
+					total_peak_count = std::stoull(header.substr(position));
+				}
+				catch (const std::logic_error&) {
+					LOG(ERROR) << partial_file.string() << " has a malformed header";
+					return std::nullopt;
+				}
+
+				if (run && *run != std::make_tuple(shard_count, total_peak_count)) {
+					LOG(ERROR) << partial_file.string() << " belongs to a different run than " << partial_files.front().string();
+					return std::nullopt;
+				}
+				run = std::make_tuple(shard_count, total_peak_count);
+				if (!shards_seen.insert(shard).second) {
+					LOG(ERROR) << "Shard " << shard << " is given more than once";
+					return std::nullopt;
+				}
+				partials.push_back(std::move(partial));
+			}
+			if (!run || shards_seen.size() != std::get<0>(*run)) {
+				LOG(ERROR) << "Only " << shards_seen.size() << " of the " << (run ? std::get<0>(*run) : 0) << " shards of the run are given";
+				return std::nullopt;
+			}
+
+			std::ofstream of{ output_file, std::ios::binary };
+			if (!of.is_open()) {
+				LOG(ERROR) << "Could not write " << output_file.string();
+				return std::nullopt;
+			}
+
+			//Every peak belongs to a single shard, so ordering the rows by peak index and transcript number, with the
+			//rows of a transcript kept in their written order, reproduces the order of a single run
+			auto isLater = [&partials](std::size_t first, std::size_t second) {
+				return std::tie(partials[first].peak_index, partials[first].transcript_number, first) > std::tie(partials[second].peak_index, partials[second].transcript_number, second);
+			};
+			std::priority_queue<std::size_t, std::vector<std::size_t>, decltype(isLater)> next_rows{ isLater };
+			std::size_t rows_written = 0;
+			try {
+				for (std::size_t p = 0; p < partials.size(); ++p) {
+					if (partials[p].advance()) {
+						next_rows.push(p);
+					}
+				}
+
+				std::size_t peak_id = 0;
+				std::optional<std::tuple<std::size_t, std::size_t>> previous_transcript;
+				while (!next_rows.empty()) {
+					const auto p = next_rows.top();
+					next_rows.pop();
+					auto& partial = partials[p];
+
+					const auto transcript = std::make_tuple(partial.peak_index, partial.transcript_number);
+					if (previous_transcript && *previous_transcript != transcript) {
+						++peak_id;
+					}
+					previous_transcript = transcript;
+					of << peak_id << "\t" << std::string_view{ partial.line }.substr(partial.row_start) << "\n";
+					++rows_written;
+
+					if (partial.advance()) {
+						next_rows.push(p);
+					}
+				}
+			}
+			catch (const std::logic_error& e) {
+				LOG(ERROR) << "Could not merge the partial outputs: " << e.what();
+				return std::nullopt;
+			}
+
+			if (!of) {
+				LOG(ERROR) << "Could not write " << output_file.string();
+				return std::nullopt;
+			}
+			return rows_written;
+		}
+
+		int runInProcesses(std::size_t shard_count, const std::function<int(std::size_t)>& run_shard)
+		{
+#ifdef _WIN32
+			int result = 0;
+			for (std::size_t shard = 0; shard < shard_count; ++shard) {
+				if (run_shard(shard) != 0) {
+					result = 1;
+				}
+			}
+			return result;
+#else
+			//Anything still buffered would otherwise be written once by every worker as well
+			std::cout.flush();
+			std::cerr.flush();
+			el::Loggers::flushAll();
+
+			std::vector<pid_t> workers;
+			for (std::size_t shard = 0; shard < shard_count; ++shard) {
+				const auto pid = ::fork();
+				if (pid == 0) {
+					const auto result = run_shard(shard);
+					//_exit skips the destructors that would flush the log files of the worker
+					std::cout.flush();
+					std::cerr.flush();
+					el::Loggers::flushAll();
+					::_exit(result);
+				}
+				if (pid < 0) {
+					LOG(ERROR) << "Could not start a worker process for shard " << shard;
+					break;
+				}
+				workers.push_back(pid);
+			}
+
+			int result = workers.size() == shard_count ? 0 : 1;
+			for (const auto pid : workers) {
+				int status = 0;
+				if (::waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+					result = 1;
+				}
+			}
+			return result;
+#endif
+		}
+	}
+}
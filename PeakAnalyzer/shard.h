@@ -0,0 +1,70 @@
+#ifndef BIOSCRIPTS_SHARD_H
+#define BIOSCRIPTS_SHARD_H
+
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "annotation.h"
+#include "peak.h"
+
+namespace bioscripts
+{
+	namespace shard
+	{
+		/**
+		 * @brief  Split the sequences carrying @a peaks into @a shard_count shards with about as many peaks each.
+		 *
+		 * The assignment only depends on @a peaks, so independent workers reading the same peak file agree on it
+		 * without talking to each other.
+		 * @return  The sequence identifiers of every shard.
+		 */
+		std::vector<std::unordered_set<std::string>> assignSequences(const peak::Peaks& peaks, std::size_t shard_count);
+
+		/**
+		 * @brief  Location of the partial output of @a shard next to @a output_file.
+		 */
+		std::filesystem::path partialPath(const std::filesystem::path& output_file, std::size_t shard, std::size_t shard_count);
+
+		/**
+		 * @brief  Annotations of the peaks of one shard, each with the index of its peak in the whole peak file.
+		 */
+		struct ShardAnnotations
+		{
+			std::size_t shard;
+			std::size_t shard_count;
+			std::size_t total_peak_count;
+			std::vector<std::size_t> peak_indices;
+			std::vector<annotation::PeakAnnotation> annotations;
+		};
+
+		/**
+		 * @brief  Write the partial output of a shard. Every row carries the global peak index and the number of the
+		 *		   transcript within the peak, which is all the merge needs to restore the order of a single run.
+		 */
+		bool writePartial(const std::filesystem::path& partial_file, const ShardAnnotations& shard_annotations);
+
+		/**
+		 * @brief  K-way merge of the partial outputs of all shards of a run into @a output_file.
+		 *
+		 * The rows and identifiers written are the same as those of a single run over the whole peak file.
+		 * @return  The number of rows written, or an empty optional if the partials are unreadable, incomplete or
+		 *			belong to different runs.
+		 */
+		std::optional<std::size_t> merge(const std::vector<std::filesystem::path>& partial_files, const std::filesystem::path& output_file);
+
+		/**
+		 * @brief  Call @a run_shard for every shard in [0, @a shard_count), each in a worker process of its own.
+		 *
+		 * On platforms without fork the shards are run one after the other in this process.
+		 * @return  0 if every shard succeeded, 1 otherwise.
+		 */
+		int runInProcesses(std::size_t shard_count, const std::function<int(std::size_t)>& run_shard);
+	}
+}
+
+#endif // !BIOSCRIPTS_SHARD_H
@@ -0,0 +1,91 @@
+#include <array>
+
+#include "translation.h"
+
+namespace
+{
+	using bioscripts::translation::GeneticCode;
+
+	constexpr uint8_t invalid_base = 0x40;
+
+	/**
+	 * @brief  Every byte packed into two bits in the order T, C, A, G of the NCBI tables, or invalid_base.
+	 */
+	constexpr std::array<uint8_t, 256> packed_bases = []() {
+		std::array<uint8_t, 256> table{};
+		table.fill(invalid_base);
+		constexpr std::string_view bases = "TCAG";
+		constexpr std::string_view lowercase_bases = "tcag";
+		for (uint8_t i = 0; i < bases.size(); ++i) {
+			table[static_cast<unsigned char>(bases[i])] = i;
+			table[static_cast<unsigned char>(lowercase_bases[i])] = i;
+		}
+		return table;
+	}();
+
+	/**
+	 * @brief  Amino acid per codon index for a code given as the 64 amino acids of an NCBI table, followed by 'X'
+	 *		   for every index with the invalid_base bit set.
+	 */
+	constexpr std::array<char, 128> aminoAcids(std::string_view ncbi_amino_acids)
+	{
+		std::array<char, 128> table{};
+		table.fill('X');
+		for (std::size_t i = 0; i < ncbi_amino_acids.size(); ++i) {
+			table[i] = ncbi_amino_acids[i];
+		}
+		return table;
+	}
+
+	constexpr auto standard_code = aminoAcids("FFLLSSSSYY**CC*WLLLLPPPPHHQQRRRRIIIMTTTTNNKKSSRRVVVVAAAADDEEGGGG");
+
+	const std::array<char, 128>& aminoAcidsOf(GeneticCode code)
+	{
+		switch (code) {
+		case GeneticCode::Standard:
+		case GeneticCode::Plastid:
+			//The plastid code differs from the standard one in its start codons only
+			return standard_code;
+		}
+		return standard_code;
+	}
+
+	/**
+	 * @brief  The 6-bit index of the codon starting at @a codon, with the invalid_base bit set if any base is not one.
+	 */
+	inline uint8_t codonIndex(const char* codon)
+	{
+		const auto first = packed_bases[static_cast<unsigned char>(codon[0])];
+		const auto second = packed_bases[static_cast<unsigned char>(codon[1])];
+		const auto third = packed_bases[static_cast<unsigned char>(codon[2])];
+		return static_cast<uint8_t>(((first & 3) << 4) | ((second & 3) << 2) | (third & 3) | ((first | second | third) & invalid_base));
+	}
+}
+
+namespace bioscripts
+{
+	namespace translation
+	{
+		GeneticCode geneticCodeOf(std::string_view transcript_id)
+		{
+			return transcript_id.starts_with("ATCG") ? GeneticCode::Plastid : GeneticCode::Standard;
+		}
+
+		char translateCodon(std::string_view codon, GeneticCode code)
+		{
+			return aminoAcidsOf(code)[codonIndex(codon.data())];
+		}
+
+		std::string translate(std::string_view bases, GeneticCode code)
+		{
+			const auto& amino_acids = aminoAcidsOf(code);
+			std::string protein(bases.size() / 3, '\0');
+			const auto* codon = bases.data();
+			for (auto& amino_acid : protein) {
+				amino_acid = amino_acids[codonIndex(codon)];
+				codon += 3;
+			}
+			return protein;
+		}
+	}
+}
@@ -0,0 +1,49 @@
+#ifndef BIOSCRIPTS_TRANSLATION_H
+#define BIOSCRIPTS_TRANSLATION_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace bioscripts
+{
+	namespace translation
+	{
+		/**
+		 * @brief  The genetic codes of Arabidopsis transcripts, numbered as the NCBI translation tables.
+		 *
+		 * The plastid code only differs from the standard one in its alternative start codons, so both translate
+		 * every codon inside a sequence to the same amino acid.
+		 */
+		enum class GeneticCode : uint8_t
+		{
+			Standard = 1,
+			Plastid = 11	//Bacterial, archaeal and plant plastid
+		};
+
+		/**
+		 * @brief  The genetic code of the transcript @a transcript_id of Arabidopsis: the plastid code for the
+		 *		   chloroplast genes (ATCG), the standard code for all others, including the mitochondrial genes (ATMG),
+		 *		   as plant mitochondria read the standard code.
+		 */
+		GeneticCode geneticCodeOf(std::string_view transcript_id);
+
+		/**
+		 * @brief  The amino acid that @a codon codes for under @a code, '*' for a stop codon and 'X' if the codon holds
+		 *		   anything but A, C, G and T (of either case).
+		 * @pre  @a codon has at least three bases, only the first three are read.
+		 */
+		char translateCodon(std::string_view codon, GeneticCode code = GeneticCode::Standard);
+
+		/**
+		 * @brief  Translate @a bases codon by codon, dropping an incomplete last codon.
+		 *
+		 * Every base is packed into two bits with one table lookup, the three of a codon form a 6-bit index, and a
+		 * second lookup gives the amino acid, without a branch per codon. Alternative start codons are read as
+		 * they would be inside the sequence, not as methionine.
+		 */
+		std::string translate(std::string_view bases, GeneticCode code = GeneticCode::Standard);
+	}
+}
+
+#endif // !BIOSCRIPTS_TRANSLATION_H
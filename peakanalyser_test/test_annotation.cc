@@ -0,0 +1,163 @@
+#include "pch.h"
+
+#include <sstream>
+
+#include "../PeakAnalyzer/annotation.h"
+
+
+class AnnotationTest : public ::testing::Test
+{
+protected:
+	void SetUp()
+	{
+		//AT1G00010.1 is a sense transcript with CDS [100, 200) and [300, 400)
+		addRecord("AT1G00010.1", bioscripts::Strand::Sense, bioscripts::Range{ 100, 200 });
+		addRecord("AT1G00010.1", bioscripts::Strand::Sense, bioscripts::Range{ 300, 400 });
+		//AT1G00020.1 is an antisense transcript with CDS [1000, 1100) and [1200, 1300)
+		addRecord("AT1G00020.1", bioscripts::Strand::Antisense, bioscripts::Range{ 1000, 1100 });
+		addRecord("AT1G00020.1", bioscripts::Strand::Antisense, bioscripts::Range{ 1200, 1300 });
+	}
+
+	void addRecord(const std::string& transcript, bioscripts::Strand strand, bioscripts::Range span)
+	{
+		records.add(bioscripts::gff::Record{
+			.type = bioscripts::gff::Record::Type::CDS,
+			.strand = strand,
+			.span = span,
+			.sequence_id = std::string{ "Chromosome_1" },
+			.attributes = "ID=CDS:" + transcript + ";Parent=transcript:" + transcript
+		});
+	}
+
+	static bioscripts::peak::Peak makePeak(bioscripts::Range span, const std::string& gene, bioscripts::Strand strand = bioscripts::Strand::Sense)
+	{
+		return bioscripts::peak::Peak{ .span = span, .strand = strand, .associated_identifier = gene, .sequence_id = "Chromosome_1" };
+	}
+
+	static bioscripts::annotation::Settings strandSettings(bioscripts::annotation::StrandFilter strand)
+	{
+		bioscripts::annotation::Settings settings;
+		settings.strand = strand;
+		return settings;
+	}
+
+	std::vector<bioscripts::annotation::PeakAnnotation> annotate(const bioscripts::peak::Peak& peak, const bioscripts::annotation::Settings& settings = {}) const
+	{
+		bioscripts::peak::Peaks peaks;
+		peaks.add(peak);
+		return bioscripts::annotation::annotate(peaks, records, settings);
+	}
+
+	bioscripts::gff::Records records;
+};
+
+TEST_F(AnnotationTest, annotate_PeakOnCodingSequenceOfItsGene_CollectsFromThatRecord)
+{
+	const auto annotations = annotate(makePeak(bioscripts::Range{ 140, 160 }, "AT1G00010"));
+	ASSERT_EQ(annotations.size(), 1);
+	ASSERT_EQ(annotations[0].size(), 1);
+	ASSERT_EQ(annotations[0][0].size(), 2);
+	EXPECT_EQ(annotations[0][0][0].transcript_id, "AT1G00010.1");
+	EXPECT_EQ(annotations[0][0][0].span, (bioscripts::Range{ 100, 200 }));
+}
+
+TEST_F(AnnotationTest, annotate_PeakInIntronOfItsGene_TakesClosestRecordOfThatGene)
+{
+	const auto annotations = annotate(makePeak(bioscripts::Range{ 270, 290 }, "AT1G00010"));
+	ASSERT_EQ(annotations[0].size(), 1);
+	ASSERT_EQ(annotations[0][0].size(), 1);
+	EXPECT_EQ(annotations[0][0][0].span, (bioscripts::Range{ 300, 400 }));
+}
+
+TEST_F(AnnotationTest, annotate_PeakCloserToOtherGene_StillTakesRecordOfItsOwnGene)
+{
+	const auto annotations = annotate(makePeak(bioscripts::Range{ 440, 460 }, "AT1G00020"));
+	ASSERT_EQ(annotations[0].size(), 1);
+	EXPECT_EQ(annotations[0][0].front().transcript_id, "AT1G00020.1");
+}
+
+TEST_F(AnnotationTest, annotate_PeakOfGeneWithoutRecords_IsLeftWithoutTranscripts)
+{
+	EXPECT_TRUE(annotate(makePeak(bioscripts::Range{ 440, 460 }, "AT1G99990"))[0].empty());
+}
+
+TEST_F(AnnotationTest, annotate_IntergenicPeakWithoutGene_FallsBackToNearestRecordWithinCap)
+{
+	const auto peak = makePeak(bioscripts::Range{ 440, 460 }, "");
+
+	EXPECT_TRUE(annotate(peak)[0].empty());
+
+	const auto within_reach = annotate(peak, bioscripts::annotation::Settings{ .any_gene_within = 100 });
+	ASSERT_EQ(within_reach[0].size(), 1);
+	EXPECT_EQ(within_reach[0][0].front().transcript_id, "AT1G00010.1");
+	EXPECT_EQ(within_reach[0][0].front().span, (bioscripts::Range{ 300, 400 }));
+
+	EXPECT_TRUE(annotate(peak, bioscripts::annotation::Settings{ .any_gene_within = 10 })[0].empty());
+}
+
+TEST_F(AnnotationTest, annotate_StrandFilter_KeepsOnlyRecordsOnThatStrand)
+{
+	const auto same = strandSettings(bioscripts::annotation::StrandFilter::Same);
+	const auto opposite = strandSettings(bioscripts::annotation::StrandFilter::Opposite);
+	const auto sense_peak = makePeak(bioscripts::Range{ 140, 160 }, "AT1G00010", bioscripts::Strand::Sense);
+	const auto antisense_peak = makePeak(bioscripts::Range{ 140, 160 }, "AT1G00010", bioscripts::Strand::Antisense);
+
+	EXPECT_EQ(annotate(sense_peak, same)[0].size(), 1);
+	EXPECT_TRUE(annotate(sense_peak, opposite)[0].empty());
+	EXPECT_TRUE(annotate(antisense_peak, same)[0].empty());
+	EXPECT_EQ(annotate(antisense_peak, opposite)[0].size(), 1);
+}
+
+TEST_F(AnnotationTest, annotate_PeakOfUnknownStrandWithStrandFilter_IsLeftWithoutTranscripts)
+{
+	const auto peak = makePeak(bioscripts::Range{ 140, 160 }, "AT1G00010", bioscripts::Strand::Unknown);
+	EXPECT_TRUE(annotate(peak, strandSettings(bioscripts::annotation::StrandFilter::Same))[0].empty());
+	EXPECT_TRUE(annotate(peak, strandSettings(bioscripts::annotation::StrandFilter::Opposite))[0].empty());
+	EXPECT_EQ(annotate(peak)[0].size(), 1);
+}
+
+TEST_F(AnnotationTest, fivePrimeDistances_SenseAndAntisenseTranscripts_SignedAlongTheTranscript)
+{
+	bioscripts::peak::Peaks peaks;
+	peaks.add(makePeak(bioscripts::Range{ 40, 60 }, "AT1G00010"));		//Upstream of the 5' end at 100
+	peaks.add(makePeak(bioscripts::Range{ 140, 160 }, "AT1G00010"));
+	peaks.add(makePeak(bioscripts::Range{ 340, 360 }, "AT1G00010"));		//In the second CDS, which starts the annotation
+	peaks.add(makePeak(bioscripts::Range{ 1340, 1360 }, "AT1G00020", bioscripts::Strand::Antisense));	//Upstream of the 5' end at 1299
+	peaks.add(makePeak(bioscripts::Range{ 1240, 1260 }, "AT1G00020", bioscripts::Strand::Antisense));
+	peaks.add(makePeak(bioscripts::Range{ 1040, 1060 }, "AT1G00020", bioscripts::Strand::Antisense));
+
+	const auto settings = strandSettings(bioscripts::annotation::StrandFilter::Same);
+	const auto annotations = bioscripts::annotation::annotate(peaks, records, settings);
+	const auto distances = bioscripts::annotation::fivePrimeDistances(peaks, annotations, records);
+	ASSERT_EQ(distances.size(), 6);
+	for (const auto& peak_distances : distances) {
+		ASSERT_EQ(peak_distances.size(), 1);
+	}
+	EXPECT_EQ(distances[0][0], -50);
+	EXPECT_EQ(distances[1][0], 50);
+	EXPECT_EQ(distances[2][0], 250);
+	EXPECT_EQ(distances[3][0], -51);
+	EXPECT_EQ(distances[4][0], 49);
+	EXPECT_EQ(distances[5][0], 249);
+}
+
+TEST_F(AnnotationTest, writeDistances_FivePrimeEndNotFound_WritesDash)
+{
+	bioscripts::peak::Peaks peaks;
+	peaks.add(makePeak(bioscripts::Range{ 140, 160 }, "AT1G00010"));
+	const std::vector<bioscripts::annotation::PeakAnnotation> annotations{
+		bioscripts::annotation::PeakAnnotation{
+			bioscripts::annotation::CodingSequence{ bioscripts::annotation::CodingSegment{ .transcript_id = "AT1G00010.1", .span = bioscripts::Range{ 100, 200 } } },
+			bioscripts::annotation::CodingSequence{ bioscripts::annotation::CodingSegment{ .transcript_id = "AT1G00010.2", .span = bioscripts::Range{ 120, 200 } } }
+		}
+	};
+
+	const auto distances = bioscripts::annotation::fivePrimeDistances(peaks, annotations, records);
+	ASSERT_EQ(distances[0].size(), 2);
+	EXPECT_EQ(distances[0][0], 50);
+	EXPECT_FALSE(distances[0][1]);
+
+	std::ostringstream stream;
+	bioscripts::annotation::writeDistances(stream, annotations, distances);
+	EXPECT_EQ(stream.str(), "0\tAT1G00010.1\t50\n1\tAT1G00010.2\t-\n");
+}
@@ -0,0 +1,114 @@
+#include "pch.h"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "../PeakAnalyzer/batch.h"
+
+class BatchTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		directory = std::filesystem::temp_directory_path() / "test_batch";
+		std::filesystem::create_directories(directory / "day2");
+		for (const auto& peaks_file : { "rep1.txt", "rep2.day2.txt.gz", "day2/rep1.txt" }) {
+			std::ofstream{ directory / peaks_file } << "\n";
+		}
+		manifest_file = directory / "manifest.txt";
+	}
+
+	void TearDown() override
+	{
+		std::filesystem::remove_all(directory);
+	}
+
+	void writeManifest(const std::string& contents) const
+	{
+		std::ofstream{ manifest_file } << contents;
+	}
+
+	std::filesystem::path directory;
+	std::filesystem::path manifest_file;
+};
+
+TEST_F(BatchTest, readManifest_RelativePeakFiles_ResolvedAgainstManifestDirectory)
+{
+	writeManifest("# replicates of day 1 and 2\n\nrep1.txt\n" + (directory / "rep2.day2.txt.gz").string() + "\n");
+
+	const auto samples = bioscripts::batch::readManifest(manifest_file);
+
+	ASSERT_TRUE(samples.has_value());
+	ASSERT_EQ(samples->size(), 2);
+	EXPECT_EQ((*samples)[0].peaks_file, directory / "rep1.txt");
+	EXPECT_EQ((*samples)[1].peaks_file, directory / "rep2.day2.txt.gz");
+}
+
+TEST_F(BatchTest, readManifest_NoOutputColumn_NamedAfterPeakFileStem)
+{
+	writeManifest("rep1.txt\nrep2.day2.txt.gz\n");
+
+	const auto samples = bioscripts::batch::readManifest(manifest_file);
+
+	ASSERT_TRUE(samples.has_value());
+	ASSERT_EQ(samples->size(), 2);
+	EXPECT_EQ((*samples)[0].output_file, "rep1.transcript_data.txt");
+	EXPECT_EQ((*samples)[1].output_file, "rep2.day2.transcript_data.txt");
+}
+
+TEST_F(BatchTest, readManifest_OutputColumn_UsedAsGiven)
+{
+	writeManifest("rep1.txt\tday1/rep1.out.txt\n");
+
+	const auto samples = bioscripts::batch::readManifest(manifest_file);
+
+	ASSERT_TRUE(samples.has_value());
+	ASSERT_EQ(samples->size(), 1);
+	EXPECT_EQ(samples->front().output_file, "day1/rep1.out.txt");
+}
+
+TEST_F(BatchTest, readManifest_DuplicateStems_ReturnsEmptyOptional)
+{
+	writeManifest("rep1.txt\nday2/rep1.txt\n");
+
+	EXPECT_FALSE(bioscripts::batch::readManifest(manifest_file).has_value());
+}
+
+TEST_F(BatchTest, readManifest_DuplicateStemsWithOutputColumn_ReturnsSamples)
+{
+	writeManifest("rep1.txt\nday2/rep1.txt\tday2.rep1.transcript_data.txt\n");
+
+	const auto samples = bioscripts::batch::readManifest(manifest_file);
+
+	ASSERT_TRUE(samples.has_value());
+	EXPECT_EQ(samples->size(), 2);
+}
+
+TEST_F(BatchTest, readManifest_MissingPeakFile_ReturnsEmptyOptional)
+{
+	writeManifest("rep1.txt\nrep3.txt\n");
+
+	EXPECT_FALSE(bioscripts::batch::readManifest(manifest_file).has_value());
+}
+
+TEST_F(BatchTest, readManifest_LineWithoutPeakFile_ReturnsEmptyOptional)
+{
+	writeManifest("rep1.txt\n\trep2.transcript_data.txt\n");
+
+	EXPECT_FALSE(bioscripts::batch::readManifest(manifest_file).has_value());
+}
+
+TEST_F(BatchTest, readManifest_PeakFileFromStdin_ReturnsEmptyOptional)
+{
+	writeManifest("-\n");
+
+	EXPECT_FALSE(bioscripts::batch::readManifest(manifest_file).has_value());
+}
+
+TEST_F(BatchTest, readManifest_OnlyComments_ReturnsEmptyOptional)
+{
+	writeManifest("# no samples yet\n\n");
+
+	EXPECT_FALSE(bioscripts::batch::readManifest(manifest_file).has_value());
+}
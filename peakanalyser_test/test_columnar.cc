@@ -0,0 +1,90 @@
+#include "pch.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../PeakAnalyzer/columnar_writer.h"
+
+class ColumnarTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		data = {
+			bioscripts::annotation::TranscriptData{ .id = 1, .start_pos = 100, .end_pos = 200, .transcript_id = "AT1G00010.1" },
+			bioscripts::annotation::TranscriptData{ .id = 1, .start_pos = 300, .end_pos = 400, .transcript_id = "AT1G00010.1" },
+			bioscripts::annotation::TranscriptData{ .id = 2, .start_pos = 1200, .end_pos = 1300, .transcript_id = "AT1G00020.1" },
+			bioscripts::annotation::TranscriptData{ .id = 3, .start_pos = 100, .end_pos = 200, .transcript_id = "AT1G00010.1" },
+		};
+		binary_file = bioscripts::columnar::binaryPath(std::filesystem::temp_directory_path() / "test_columnar_transcript_data.txt");
+		ASSERT_TRUE(bioscripts::columnar::write(binary_file, data));
+	}
+
+	void TearDown() override
+	{
+		std::filesystem::remove(binary_file);
+	}
+
+	/**
+	 * @brief  The written file in an 8-byte aligned buffer, as Columns::view expects it.
+	 */
+	std::vector<uint64_t> readFile(std::size_t& size) const
+	{
+		size = static_cast<std::size_t>(std::filesystem::file_size(binary_file));
+		std::vector<uint64_t> buffer((size + 7) / 8);
+		std::ifstream f{ binary_file, std::ios::binary };
+		f.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(size));
+		return buffer;
+	}
+
+	std::vector<bioscripts::annotation::TranscriptData> data;
+	std::filesystem::path binary_file;
+};
+
+TEST_F(ColumnarTest, open_WrittenRows_ReadBackUnchanged)
+{
+	const auto columns = bioscripts::columnar::MappedColumns::open(binary_file);
+	ASSERT_TRUE(columns.has_value());
+
+	ASSERT_EQ((*columns)->size(), data.size());
+	EXPECT_EQ((*columns)->dictionarySize(), 2);
+	for (std::size_t row = 0; row < data.size(); ++row) {
+		EXPECT_EQ((*columns)->peakIds()[row], data[row].id);
+		EXPECT_EQ((*columns)->startPositions()[row], data[row].start_pos);
+		EXPECT_EQ((*columns)->endPositions()[row], data[row].end_pos);
+		EXPECT_EQ((*columns)->transcriptId(row), data[row].transcript_id);
+	}
+}
+
+TEST_F(ColumnarTest, transcriptName_CodeOutsideDictionary_ReturnsEmpty)
+{
+	const auto columns = bioscripts::columnar::MappedColumns::open(binary_file);
+	ASSERT_TRUE(columns.has_value());
+
+	EXPECT_TRUE((*columns)->transcriptName(2).empty());
+}
+
+TEST_F(ColumnarTest, view_DecreasingDictionaryOffsets_ReturnsEmptyOptional)
+{
+	std::size_t size = 0;
+	auto buffer = readFile(size);
+	bioscripts::columnar::FileHeader header;
+	std::memcpy(&header, buffer.data(), sizeof(header));
+	buffer[header.dictionary_offset / 8 + 1] = 30;
+
+	EXPECT_FALSE(bioscripts::columnar::Columns::view(reinterpret_cast<const char*>(buffer.data()), size).has_value());
+}
+
+TEST_F(ColumnarTest, view_DictionaryOffsetPastStringPool_ReturnsEmptyOptional)
+{
+	std::size_t size = 0;
+	auto buffer = readFile(size);
+	bioscripts::columnar::FileHeader header;
+	std::memcpy(&header, buffer.data(), sizeof(header));
+	buffer[header.dictionary_offset / 8 + header.dictionary_size] = header.file_size - header.strings_offset + 1;
+
+	EXPECT_FALSE(bioscripts::columnar::Columns::view(reinterpret_cast<const char*>(buffer.data()), size).has_value());
+}
@@ -0,0 +1,132 @@
+#include "pch.h"
+
+#include "../PeakAnalyzer/context.h"
+
+namespace
+{
+	std::string parentAttributes(const std::string& transcript)
+	{
+		return "Parent=transcript:" + transcript;
+	}
+}
+
+class ContextIndexTest : public ::testing::Test
+{
+protected:
+	void SetUp()
+	{
+		//AT1G00010.1 is coding: 5' UTR [100, 150), CDS [150, 200) and [300, 350), 3' UTR [350, 400)
+		addRecord(bioscripts::gff::Record::Type::mRNA, bioscripts::Range{ 100, 400 }, "ID=transcript:AT1G00010.1");
+		addRecord(bioscripts::gff::Record::Type::exon, bioscripts::Range{ 100, 200 }, parentAttributes("AT1G00010.1"));
+		addRecord(bioscripts::gff::Record::Type::five_prime_UTR, bioscripts::Range{ 100, 150 }, parentAttributes("AT1G00010.1"));
+		addRecord(bioscripts::gff::Record::Type::CDS, bioscripts::Range{ 150, 200 }, parentAttributes("AT1G00010.1"));
+		addRecord(bioscripts::gff::Record::Type::exon, bioscripts::Range{ 300, 400 }, parentAttributes("AT1G00010.1"));
+		addRecord(bioscripts::gff::Record::Type::CDS, bioscripts::Range{ 300, 350 }, parentAttributes("AT1G00010.1"));
+		addRecord(bioscripts::gff::Record::Type::three_prime_UTR, bioscripts::Range{ 350, 400 }, parentAttributes("AT1G00010.1"));
+		//AT1G00020.1 is non-coding and has an exon inside the intron of AT1G00010.1
+		addRecord(bioscripts::gff::Record::Type::lnc_RNA, bioscripts::Range{ 220, 320 }, "ID=transcript:AT1G00020.1");
+		addRecord(bioscripts::gff::Record::Type::exon, bioscripts::Range{ 220, 240 }, parentAttributes("AT1G00020.1"));
+		addRecord(bioscripts::gff::Record::Type::exon, bioscripts::Range{ 260, 320 }, parentAttributes("AT1G00020.1"));
+	}
+
+	void addRecord(bioscripts::gff::Record::Type type, bioscripts::Range span, const std::string& attributes)
+	{
+		records.add(bioscripts::gff::Record{
+			.type = type,
+			.strand = bioscripts::Strand::Sense,
+			.span = span,
+			.sequence_id = std::string{ "Chromosome_1" },
+			.attributes = attributes
+		});
+	}
+
+	bioscripts::context::ContextIndex buildIndex() const
+	{
+		return bioscripts::context::ContextIndex{ records, bioscripts::gff::Hierarchy{ records } };
+	}
+
+	bioscripts::gff::Records records;
+};
+
+TEST_F(ContextIndexTest, at_PositionsAlongTranscript_ReturnTheirFeature)
+{
+	const auto index = buildIndex();
+	EXPECT_EQ(index.at("Chromosome_1", 120).feature, bioscripts::context::Feature::FivePrimeUTR);
+	EXPECT_EQ(index.at("Chromosome_1", 160).feature, bioscripts::context::Feature::CDS);
+	EXPECT_EQ(index.at("Chromosome_1", 210).feature, bioscripts::context::Feature::Intron);
+	EXPECT_EQ(index.at("Chromosome_1", 360).feature, bioscripts::context::Feature::ThreePrimeUTR);
+	EXPECT_EQ(index.at("Chromosome_1", 360).transcript_id, "AT1G00010.1");
+}
+
+TEST_F(ContextIndexTest, at_PositionOutsideTranscripts_IsIntergenic)
+{
+	const auto index = buildIndex();
+	EXPECT_EQ(index.at("Chromosome_1", 50).feature, bioscripts::context::Feature::Intergenic);
+	EXPECT_TRUE(index.at("Chromosome_1", 50).transcript_id.empty());
+	EXPECT_EQ(index.at("Chromosome_2", 160).feature, bioscripts::context::Feature::Intergenic);
+}
+
+TEST_F(ContextIndexTest, at_OverlappingFeatures_FollowPrecedence)
+{
+	const auto index = buildIndex();
+	const auto by_default = index.at("Chromosome_1", 230);
+	EXPECT_EQ(by_default.feature, bioscripts::context::Feature::Exon);
+	EXPECT_EQ(by_default.transcript_id, "AT1G00020.1");
+
+	const auto introns_first = index.at("Chromosome_1", 230, *bioscripts::context::Precedence::parse("intron"));
+	EXPECT_EQ(introns_first.feature, bioscripts::context::Feature::Intron);
+	EXPECT_EQ(introns_first.transcript_id, "AT1G00010.1");
+
+	const auto exons_first = index.at("Chromosome_1", 310, *bioscripts::context::Precedence::parse("exon"));
+	EXPECT_EQ(exons_first.feature, bioscripts::context::Feature::Exon);
+	EXPECT_EQ(exons_first.transcript_id, "AT1G00020.1");
+	EXPECT_EQ(index.at("Chromosome_1", 310).feature, bioscripts::context::Feature::CDS);
+}
+
+TEST_F(ContextIndexTest, at_IntronsOfTwoTranscripts_TakesTheOneStartingFirst)
+{
+	const auto index = buildIndex();
+	const auto in_both_introns = index.at("Chromosome_1", 250);
+	EXPECT_EQ(in_both_introns.feature, bioscripts::context::Feature::Intron);
+	EXPECT_EQ(in_both_introns.transcript_id, "AT1G00010.1");
+}
+
+TEST_F(ContextIndexTest, classify_MorePeaksThanOneChunk_MatchesLookingUpEveryPeak)
+{
+	const auto index = buildIndex();
+	bioscripts::peak::Peaks peaks;
+	for (std::size_t i = 0; i < 40000; ++i) {
+		//Unordered midpoints across two sequences, so the peaks have to be sorted and split between chunks
+		const auto midpoint = (i * 7919) % 500;
+		peaks.add(bioscripts::peak::Peak{ .span = bioscripts::Range{ midpoint, midpoint + 1 }, .strand = bioscripts::Strand::Sense, .associated_identifier = std::string{ "AT1G00010" }, .sequence_id = i % 3 == 0 ? "Chromosome_2" : "Chromosome_1" });
+	}
+
+	const auto contexts = index.classify(peaks);
+	ASSERT_EQ(contexts.size(), peaks.size());
+	std::size_t i = 0;
+	for (const auto& peak : peaks) {
+		const auto expected = index.at(peak.sequence_id, static_cast<bioscripts::Position>(bioscripts::peak::midpoint(peak)));
+		EXPECT_EQ(contexts[i].feature, expected.feature);
+		EXPECT_EQ(contexts[i].transcript_id, expected.transcript_id);
+		++i;
+	}
+}
+
+TEST(TestContext, parse_UnknownOrRepeatedFeature_ReturnsEmptyOptional)
+{
+	EXPECT_FALSE(bioscripts::context::Precedence::parse("CDS,promoter"));
+	EXPECT_FALSE(bioscripts::context::Precedence::parse("CDS,cds"));
+	ASSERT_TRUE(bioscripts::context::Precedence::parse("3utr,5UTR"));
+	const auto order = bioscripts::context::Precedence::parse("3utr,5UTR")->order();
+	EXPECT_EQ(order[0], bioscripts::context::Feature::ThreePrimeUTR);
+	EXPECT_EQ(order[1], bioscripts::context::Feature::FivePrimeUTR);
+	EXPECT_EQ(order[2], bioscripts::context::Feature::CDS);
+	EXPECT_EQ(order.back(), bioscripts::context::Feature::Intergenic);
+}
+
+TEST_F(ContextIndexTest, at_RecordWithoutLoadedTranscript_IsIntergenic)
+{
+	addRecord(bioscripts::gff::Record::Type::CDS, bioscripts::Range{ 600, 700 }, parentAttributes("AT1G00030.1"));
+	const auto index = buildIndex();
+	EXPECT_EQ(index.at("Chromosome_1", 650).feature, bioscripts::context::Feature::Intergenic);
+}
@@ -0,0 +1,105 @@
+#include "pch.h"
+
+#include "../PeakAnalyzer/coordinate_map.h"
+
+
+class CoordinateMapTest : public ::testing::Test
+{
+protected:
+	void SetUp()
+	{
+		//AT1G00010.1 is read left to right from [100, 110) over [200, 205) to [300, 310)
+		addRecord("AT1G00010.1", bioscripts::Strand::Sense, bioscripts::Range{ 200, 205 });
+		addRecord("AT1G00010.1", bioscripts::Strand::Sense, bioscripts::Range{ 100, 110 });
+		addRecord("AT1G00010.1", bioscripts::Strand::Sense, bioscripts::Range{ 300, 310 });
+		//AT1G00020.1 is read right to left from [600, 610) to [500, 506)
+		addRecord("AT1G00020.1", bioscripts::Strand::Antisense, bioscripts::Range{ 500, 506 });
+		addRecord("AT1G00020.1", bioscripts::Strand::Antisense, bioscripts::Range{ 600, 610 });
+	}
+
+	void addRecord(const std::string& transcript, bioscripts::Strand strand, bioscripts::Range span)
+	{
+		records.add(bioscripts::gff::Record{
+			.type = bioscripts::gff::Record::Type::CDS,
+			.strand = strand,
+			.span = span,
+			.sequence_id = std::string{ "Chromosome_1" },
+			.attributes = "ID=CDS:" + transcript + ";Parent=transcript:" + transcript
+		});
+	}
+
+	bioscripts::gff::Records records;
+};
+
+TEST_F(CoordinateMapTest, toTranscript_SenseTranscript_CountsSplicedBasesFromLeft)
+{
+	const bioscripts::coordinates::CoordinateMap map{ records };
+	const auto transcript = map.find("AT1G00010.1");
+	ASSERT_TRUE(transcript);
+	EXPECT_EQ(map.codingLength(*transcript), 25);
+
+	const auto position = map.toTranscript(*transcript, 202);
+	ASSERT_TRUE(position);
+	EXPECT_EQ(position->offset, 12);
+	EXPECT_EQ(position->codon, 4);
+	EXPECT_EQ(position->codon_position, 0);
+	EXPECT_EQ(map.toTranscript(*transcript, 100)->offset, 0);
+	EXPECT_EQ(map.toTranscript(*transcript, 309)->offset, 24);
+}
+
+TEST_F(CoordinateMapTest, toTranscript_AntisenseTranscript_CountsSplicedBasesFromRight)
+{
+	const bioscripts::coordinates::CoordinateMap map{ records };
+	const auto transcript = map.find("AT1G00020.1");
+	ASSERT_TRUE(transcript);
+	EXPECT_EQ(map.toTranscript(*transcript, 609)->offset, 0);
+	EXPECT_EQ(map.toTranscript(*transcript, 600)->offset, 9);
+	const auto position = map.toTranscript(*transcript, 505);
+	ASSERT_TRUE(position);
+	EXPECT_EQ(position->offset, 10);
+	EXPECT_EQ(position->codon, 3);
+	EXPECT_EQ(position->codon_position, 1);
+}
+
+TEST_F(CoordinateMapTest, toTranscript_PositionOutsideCds_ReturnsEmptyOptional)
+{
+	const bioscripts::coordinates::CoordinateMap map{ records };
+	EXPECT_FALSE(map.toTranscript(*map.find("AT1G00010.1"), 150));
+	EXPECT_FALSE(map.toTranscript(*map.find("AT1G00010.1"), 99));
+	EXPECT_FALSE(map.toTranscript(*map.find("AT1G00010.1"), 310));
+	EXPECT_FALSE(map.toTranscript(*map.find("AT1G00020.1"), 550));
+	EXPECT_FALSE(map.toTranscript(*map.find("AT1G00020.1"), 499));
+	EXPECT_FALSE(map.find("AT1G00030.1"));
+}
+
+TEST_F(CoordinateMapTest, toGenome_EveryCodingOffset_RoundTrips)
+{
+	const bioscripts::coordinates::CoordinateMap map{ records };
+	for (std::size_t transcript = 0; transcript < map.size(); ++transcript) {
+		for (bioscripts::Position offset = 0; offset < map.codingLength(transcript); ++offset) {
+			const auto position = map.toGenome(transcript, offset);
+			ASSERT_TRUE(position);
+			EXPECT_EQ(map.toTranscript(transcript, *position)->offset, offset);
+		}
+		EXPECT_FALSE(map.toGenome(transcript, map.codingLength(transcript)));
+	}
+}
+
+TEST_F(CoordinateMapTest, toTranscript_Batch_MatchesSingleQueries)
+{
+	const bioscripts::coordinates::CoordinateMap map{ records };
+	std::vector<bioscripts::coordinates::GenomicQuery> queries;
+	for (bioscripts::Position position = 90; position < 620; ++position) {
+		queries.push_back({ .transcript = *map.find("AT1G00010.1"), .position = position });
+		queries.push_back({ .transcript = *map.find("AT1G00020.1"), .position = position });
+	}
+	const auto positions = map.toTranscript(queries);
+	ASSERT_EQ(positions.size(), queries.size());
+	for (std::size_t i = 0; i < queries.size(); ++i) {
+		const auto expected = map.toTranscript(queries[i].transcript, queries[i].position);
+		ASSERT_EQ(positions[i].has_value(), expected.has_value());
+		if (expected) {
+			EXPECT_EQ(positions[i]->offset, expected->offset);
+		}
+	}
+}
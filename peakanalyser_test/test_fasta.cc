@@ -0,0 +1,76 @@
+#include "pch.h"
+
+#include "../PeakAnalyzer/fasta.h"
+
+
+class IndexedFastaTest : public ::testing::Test
+{
+protected:
+	//Chromosome_1 is ACGTACGTAC GGGGCCCCTT AAT wrapped after 10 bases, Chromosome_2 is TTTTT
+	const std::string contents = ">Chromosome_1\nACGTACGTAC\nGGGGCCCCTT\nAAT\n>Chromosome_2\nTTTTT\n";
+	const std::vector<bioscripts::fasta::FaiEntry> entries = {
+		{ .name = "Chromosome_1", .length = 23, .offset = 14, .line_bases = 10, .line_width = 11 },
+		{ .name = "Chromosome_2", .length = 5, .offset = 54, .line_bases = 5, .line_width = 6 }
+	};
+};
+
+TEST_F(IndexedFastaTest, view_SpanWithinOneLine_PointsIntoContents)
+{
+	const bioscripts::fasta::IndexedFasta fasta{ contents, entries };
+	const auto bases = fasta.view("Chromosome_1", bioscripts::Range{ 12, 16 });
+	ASSERT_TRUE(bases);
+	EXPECT_EQ(*bases, "GGCC");
+	EXPECT_GE(bases->data(), contents.data());
+	EXPECT_LT(bases->data(), contents.data() + contents.size());
+	EXPECT_FALSE(fasta.view("Chromosome_1", bioscripts::Range{ 8, 12 }));
+}
+
+TEST_F(IndexedFastaTest, append_SpanAcrossLines_SkipsLineBreaks)
+{
+	const bioscripts::fasta::IndexedFasta fasta{ contents, entries };
+	std::string bases;
+	ASSERT_TRUE(fasta.append("Chromosome_1", bioscripts::Range{ 8, 23 }, bases));
+	EXPECT_EQ(bases, "ACGGGGCCCCTTAAT");
+	ASSERT_TRUE(fasta.append("Chromosome_2", bioscripts::Range{ 0, 5 }, bases));
+	EXPECT_EQ(bases, "ACGGGGCCCCTTAATTTTTT");
+}
+
+TEST_F(IndexedFastaTest, append_SpanBeyondSequence_ReturnsFalse)
+{
+	const bioscripts::fasta::IndexedFasta fasta{ contents, entries };
+	std::string bases;
+	EXPECT_FALSE(fasta.append("Chromosome_1", bioscripts::Range{ 20, 24 }, bases));
+	EXPECT_FALSE(fasta.append("Chromosome_3", bioscripts::Range{ 0, 1 }, bases));
+	EXPECT_TRUE(bases.empty());
+}
+
+TEST_F(IndexedFastaTest, get_AntisenseTranscript_IsSplicedAndReverseComplemented)
+{
+	const bioscripts::fasta::IndexedFasta fasta{ contents, entries };
+	bioscripts::gff::Records records;
+	//GFF positions 1-4 (ACGT) and 11-14 (GGGG), read from the right on the opposite strand
+	for (const auto span : { bioscripts::Range{ 1, 5 }, bioscripts::Range{ 11, 15 } }) {
+		records.add(bioscripts::gff::Record{
+			.type = bioscripts::gff::Record::Type::CDS,
+			.strand = bioscripts::Strand::Antisense,
+			.span = span,
+			.sequence_id = std::string{ "Chromosome_1" },
+			.attributes = "ID=CDS:AT1G00010.1;Parent=transcript:AT1G00010.1"
+		});
+	}
+	const bioscripts::coordinates::CoordinateMap map{ records };
+	bioscripts::fasta::CodingSequenceCache cache{ fasta, map };
+	const auto* bases = cache.get(*map.find("AT1G00010.1"));
+	ASSERT_NE(bases, nullptr);
+	EXPECT_EQ(*bases, "CCCCACGT");
+	EXPECT_EQ(cache.get(*map.find("AT1G00010.1")), bases);
+	EXPECT_EQ(cache.size(), 1);
+}
+
+TEST(TestFasta, parseFaiLine_MalformedRow_ReturnsEmptyOptional)
+{
+	EXPECT_TRUE(bioscripts::fasta::parseFaiLine("1\t30427671\t3\t79\t80"));
+	EXPECT_FALSE(bioscripts::fasta::parseFaiLine("1\t30427671\t3\t79"));
+	EXPECT_FALSE(bioscripts::fasta::parseFaiLine("1\tmany\t3\t79\t80"));
+	EXPECT_FALSE(bioscripts::fasta::parseFaiLine("1\t30427671\t3\t0\t1"));
+}
@@ -0,0 +1,173 @@
+#include "pch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <zlib.h>
+
+#include "../PeakAnalyzer/gff.h"
+#include "../PeakAnalyzer/gff_index.h"
+
+namespace
+{
+	void appendLittleEndian(std::string& bytes, uint32_t value, std::size_t width)
+	{
+		for (std::size_t i = 0; i < width; ++i) {
+			bytes += static_cast<char>((value >> (8 * i)) & 0xff);
+		}
+	}
+
+	/**
+	 * @brief  @a text as a single BGZF block: a gzip member whose extra field holds the block size.
+	 */
+	std::string bgzfBlock(const std::string& text)
+	{
+		z_stream stream{};
+		deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+		std::string compressed(deflateBound(&stream, static_cast<uLong>(text.size())), '\0');
+		stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(text.data()));
+		stream.avail_in = static_cast<uInt>(text.size());
+		stream.next_out = reinterpret_cast<Bytef*>(compressed.data());
+		stream.avail_out = static_cast<uInt>(compressed.size());
+		deflate(&stream, Z_FINISH);
+		compressed.resize(compressed.size() - stream.avail_out);
+		deflateEnd(&stream);
+
+		std::string block{ "\x1f\x8b\x08\x04\0\0\0\0\0\xff\x06\0BC\x02\0", 16 };
+		appendLittleEndian(block, static_cast<uint32_t>(compressed.size() + 25), 2);
+		block += compressed;
+		appendLittleEndian(block, static_cast<uint32_t>(crc32(crc32(0L, Z_NULL, 0), reinterpret_cast<const Bytef*>(text.data()), static_cast<uInt>(text.size()))), 4);
+		appendLittleEndian(block, static_cast<uint32_t>(text.size()), 4);
+		return block;
+	}
+
+	std::string gffLine(const std::string& sequence_id, const std::string& type, std::size_t start, std::size_t end, const std::string& id)
+	{
+		return sequence_id + "\tAraport11\t" + type + "\t" + std::to_string(start) + "\t" + std::to_string(end) + "\t.\t+\t.\tID=" + id + "\n";
+	}
+
+	std::vector<bioscripts::gff::Record> sortedRecordsOf(const bioscripts::gff::Records& records)
+	{
+		std::vector<bioscripts::gff::Record> sorted;
+		for (const auto& [sequence_id, entries] : records) {
+			sorted.insert(std::end(sorted), std::begin(entries), std::end(entries));
+		}
+		std::sort(std::begin(sorted), std::end(sorted), [](const auto& first, const auto& second) {
+			return std::make_tuple(first.sequence_id.to_string(), first.span.start, first.attributes) < std::make_tuple(second.sequence_id.to_string(), second.span.start, second.attributes);
+		});
+		return sorted;
+	}
+}
+
+class GffIndexTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		//Short CDS records every 50 bases, with genes spanning a few hundred kb so that several bin levels are used
+		std::string text = "##gff-version 3\n";
+		for (const auto& sequence_id : { std::string{ "1" }, std::string{ "2" } }) {
+			for (std::size_t i = 0; i < 3000; ++i) {
+				const auto start = 1 + i * 50;
+				if (i % 500 == 0) {
+					text += gffLine(sequence_id, "gene", start, start + 200000, "gene" + std::to_string(i));
+				}
+				text += gffLine(sequence_id, "CDS", start, start + 80, "cds" + std::to_string(i));
+			}
+		}
+
+		plain_file = std::filesystem::temp_directory_path() / "test_gff_index.gff3";
+		gff_file = std::filesystem::temp_directory_path() / "test_gff_index.gff3.gz";
+		std::ofstream{ plain_file, std::ios::binary } << text;
+		std::ofstream bgzf{ gff_file, std::ios::binary };
+		for (std::size_t start = 0; start < text.size(); start += 4000) {
+			bgzf << bgzfBlock(text.substr(start, 4000));
+		}
+		bgzf << bgzfBlock("");
+	}
+
+	void TearDown() override
+	{
+		std::filesystem::remove(plain_file);
+		std::filesystem::remove(gff_file);
+		std::filesystem::remove(bioscripts::gff::indexPath(gff_file));
+	}
+
+	/**
+	 * @brief  The records of the whole file that overlap one of the @a regions, found without an index.
+	 */
+	std::vector<bioscripts::gff::Record> overlappingRecords(const std::vector<bioscripts::Region>& regions) const
+	{
+		bioscripts::gff::Records all_records{ plain_file };
+		bioscripts::gff::Records overlapping;
+		for (const auto& [sequence_id, entries] : all_records) {
+			for (const auto& record : entries) {
+				if (std::any_of(std::begin(regions), std::end(regions), [&](const auto& region) { return bioscripts::overlap(region, sequence_id, record.span); })) {
+					overlapping.add(record);
+				}
+			}
+		}
+		return sortedRecordsOf(overlapping);
+	}
+
+	std::filesystem::path plain_file;
+	std::filesystem::path gff_file;
+};
+
+TEST_F(GffIndexTest, build_UncompressedFile_ReturnsEmptyOptional)
+{
+	EXPECT_FALSE(bioscripts::gff::RegionIndex::build(plain_file).has_value());
+}
+
+TEST_F(GffIndexTest, Records_IndexedRegions_ReturnsExactlyTheOverlappingRecords)
+{
+	const auto index = bioscripts::gff::RegionIndex::build(gff_file);
+	ASSERT_TRUE(index.has_value());
+	const std::vector<bioscripts::Region> regions = {
+		bioscripts::Region{ .sequence_id = "1", .span = bioscripts::Range{ 30000, 30100 } },
+		bioscripts::Region{ .sequence_id = "1", .span = bioscripts::Range{ 30050, 31000 } },
+		bioscripts::Region{ .sequence_id = "2", .span = bioscripts::Range{ 149000, 160000 } },
+		bioscripts::Region{ .sequence_id = "3", .span = bioscripts::Range{ 1, 1000 } }
+	};
+
+	const bioscripts::gff::Records records{ gff_file, *index, regions };
+
+	const auto expected = overlappingRecords(regions);
+	EXPECT_FALSE(expected.empty());
+	EXPECT_EQ(sortedRecordsOf(records), expected);
+}
+
+TEST_F(GffIndexTest, load_SavedIndex_FindsTheSameChunks)
+{
+	const auto index = bioscripts::gff::RegionIndex::build(gff_file);
+	ASSERT_TRUE(index.has_value());
+	ASSERT_TRUE(index->save(gff_file));
+
+	const auto loaded = bioscripts::gff::RegionIndex::load(gff_file);
+	ASSERT_TRUE(loaded.has_value());
+	const bioscripts::Region region{ .sequence_id = "2", .span = bioscripts::Range{ 100000, 100500 } };
+	const auto chunks = index->chunks(region);
+	const auto loaded_chunks = loaded->chunks(region);
+	ASSERT_EQ(loaded_chunks.size(), chunks.size());
+	for (std::size_t i = 0; i < chunks.size(); ++i) {
+		EXPECT_EQ(loaded_chunks[i].begin, chunks[i].begin);
+		EXPECT_EQ(loaded_chunks[i].end, chunks[i].end);
+	}
+}
+
+TEST_F(GffIndexTest, load_FileModifiedWithSameSize_ReturnsEmptyOptional)
+{
+	const auto index = bioscripts::gff::RegionIndex::build(gff_file);
+	ASSERT_TRUE(index.has_value());
+	ASSERT_TRUE(index->save(gff_file));
+
+	std::filesystem::last_write_time(gff_file, std::filesystem::last_write_time(gff_file) + std::chrono::hours{ 1 });
+
+	EXPECT_FALSE(bioscripts::gff::RegionIndex::load(gff_file).has_value());
+}
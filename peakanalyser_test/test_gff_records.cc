@@ -412,3 +412,90 @@ TEST(RecordsTest, size_EmptyRecordsObject_SizeIsZero)
 	bioscripts::gff::Records records;
 	EXPECT_EQ(records.size(), 0);
 }
+
+TEST(RecordsTest, collapseIsoforms_OverlappingIsoforms_MergedIntoUnionPerGene)
+{
+	bioscripts::gff::Records records;
+	auto addRecord = [&records](bioscripts::gff::Record::Type type, bioscripts::Strand strand, bioscripts::Range span, const std::string& transcript_id) {
+		records.add(bioscripts::gff::Record{
+			.type = type,
+			.strand = strand,
+			.span = span,
+			.sequence_id = std::string{ "Chromosome_1" },
+			.attributes = "ID=CDS:" + transcript_id + ";Parent=transcript:" + transcript_id
+		});
+	};
+	addRecord(bioscripts::gff::Record::Type::CDS, bioscripts::Strand::Sense, bioscripts::Range{ 100, 200 }, "AT1G12345.1");
+	addRecord(bioscripts::gff::Record::Type::CDS, bioscripts::Strand::Sense, bioscripts::Range{ 150, 250 }, "AT1G12345.2");
+	addRecord(bioscripts::gff::Record::Type::CDS, bioscripts::Strand::Sense, bioscripts::Range{ 300, 400 }, "AT1G12345.1");
+	addRecord(bioscripts::gff::Record::Type::CDS, bioscripts::Strand::Sense, bioscripts::Range{ 400, 450 }, "AT1G12345.2");
+	addRecord(bioscripts::gff::Record::Type::exon, bioscripts::Strand::Sense, bioscripts::Range{ 50, 500 }, "AT1G12345.1");
+	addRecord(bioscripts::gff::Record::Type::CDS, bioscripts::Strand::Antisense, bioscripts::Range{ 220, 320 }, "AT1G12350.1");
+
+	const auto collapsed = bioscripts::gff::collapseIsoforms(records);
+	const auto& collapsed_records = collapsed.data(bioscripts::Identifier<bioscripts::Full>{ "Chromosome_1" });
+	ASSERT_EQ(collapsed_records.size(), 3);
+	EXPECT_EQ(collapsed_records[0].span, (bioscripts::Range{ 100, 250 }));
+	EXPECT_EQ(bioscripts::gff::extractAttribute(collapsed_records[0], "ID=CDS"), "AT1G12345.union");
+	EXPECT_EQ(collapsed_records[1].span, (bioscripts::Range{ 220, 320 }));
+	EXPECT_EQ(bioscripts::gff::extractAttribute(collapsed_records[1], "ID=CDS"), "AT1G12350.union");
+	EXPECT_EQ(collapsed_records[1].strand, bioscripts::Strand::Antisense);
+	EXPECT_EQ(collapsed_records[2].span, (bioscripts::Range{ 300, 450 }));
+	EXPECT_EQ(collapsed_records[2].type, bioscripts::gff::Record::Type::CDS);
+}
+
+TEST(RecordsTest, widenToFeatures_RegionInsideOneGene_CoversOnlyThatGene)
+{
+	bioscripts::gff::Records records;
+	auto addRecord = [&records](bioscripts::gff::Record::Type type, bioscripts::Strand strand, bioscripts::Range span, const std::string& attributes) {
+		records.add(bioscripts::gff::Record{
+			.type = type,
+			.strand = strand,
+			.span = span,
+			.sequence_id = std::string{ "Chromosome_1" },
+			.attributes = attributes
+		});
+	};
+	addRecord(bioscripts::gff::Record::Type::chromosome, bioscripts::Strand::Sense, bioscripts::Range{ 1, 10000 }, "ID=chromosome:1");
+	addRecord(bioscripts::gff::Record::Type::gene, bioscripts::Strand::Sense, bioscripts::Range{ 100, 400 }, "ID=gene:AT1G00010");
+	addRecord(bioscripts::gff::Record::Type::mRNA, bioscripts::Strand::Sense, bioscripts::Range{ 100, 400 }, "ID=transcript:AT1G00010.1;Parent=gene:AT1G00010");
+	addRecord(bioscripts::gff::Record::Type::CDS, bioscripts::Strand::Sense, bioscripts::Range{ 150, 200 }, "ID=CDS:AT1G00010.1;Parent=transcript:AT1G00010.1");
+	addRecord(bioscripts::gff::Record::Type::CDS, bioscripts::Strand::Sense, bioscripts::Range{ 300, 350 }, "ID=CDS:AT1G00010.1;Parent=transcript:AT1G00010.1");
+	addRecord(bioscripts::gff::Record::Type::gene, bioscripts::Strand::Sense, bioscripts::Range{ 1000, 1400 }, "ID=gene:AT1G00020");
+	addRecord(bioscripts::gff::Record::Type::CDS, bioscripts::Strand::Sense, bioscripts::Range{ 1100, 1300 }, "ID=CDS:AT1G00020.1;Parent=transcript:AT1G00020.1");
+
+	std::vector<bioscripts::Region> regions{ bioscripts::Region{ .sequence_id = "Chromosome_1", .span = bioscripts::Range{ 160, 170 } } };
+	EXPECT_TRUE(bioscripts::gff::widenToFeatures(regions, records));
+	EXPECT_EQ(regions[0].span, (bioscripts::Range{ 100, 400 }));
+	EXPECT_FALSE(bioscripts::gff::widenToFeatures(regions, records));
+
+	std::size_t loaded_features = 0;
+	for (const auto& record : records.data(bioscripts::Identifier<bioscripts::Full>{ "Chromosome_1" })) {
+		if (record.type != bioscripts::gff::Record::Type::chromosome && bioscripts::overlap(regions[0], "Chromosome_1", record.span)) {
+			EXPECT_EQ(record.attributes.find("AT1G00020"), std::string::npos);
+			++loaded_features;
+		}
+	}
+	EXPECT_EQ(loaded_features, 4);
+}
+
+TEST(RecordsTest, widenToFeatures_OverlappingGenes_WidenedUntilNoFeatureSticksOut)
+{
+	bioscripts::gff::Records records;
+	auto addRecord = [&records](bioscripts::gff::Record::Type type, bioscripts::Strand strand, bioscripts::Range span, const std::string& attributes) {
+		records.add(bioscripts::gff::Record{
+			.type = type,
+			.strand = strand,
+			.span = span,
+			.sequence_id = std::string{ "Chromosome_1" },
+			.attributes = attributes
+		});
+	};
+	addRecord(bioscripts::gff::Record::Type::gene, bioscripts::Strand::Sense, bioscripts::Range{ 100, 400 }, "ID=gene:AT1G00010");
+	addRecord(bioscripts::gff::Record::Type::gene, bioscripts::Strand::Antisense, bioscripts::Range{ 380, 600 }, "ID=gene:AT1G00020");
+	addRecord(bioscripts::gff::Record::Type::exon, bioscripts::Strand::Sense, bioscripts::Range{ 550, 900 }, "Parent=transcript:AT1G00030.1");
+
+	std::vector<bioscripts::Region> regions{ bioscripts::Region{ .sequence_id = "Chromosome_1", .span = bioscripts::Range{ 150, 160 } } };
+	EXPECT_TRUE(bioscripts::gff::widenToFeatures(regions, records));
+	EXPECT_EQ(regions[0].span, (bioscripts::Range{ 100, 600 }));
+}
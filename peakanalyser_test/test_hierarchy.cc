@@ -0,0 +1,90 @@
+#include "pch.h"
+
+#include <vector>
+
+#include "../PeakAnalyzer/hierarchy.h"
+
+
+class HierarchyTest : public ::testing::Test
+{
+protected:
+	void SetUp()
+	{
+		addRecord("Chromosome_1", bioscripts::gff::Record::Type::gene, bioscripts::Range{ 100, 400 }, "ID=gene:AT1G00010;Name=AT1G00010");
+		addRecord("Chromosome_1", bioscripts::gff::Record::Type::mRNA, bioscripts::Range{ 100, 400 }, "ID=transcript:AT1G00010.1;Parent=gene:AT1G00010");
+		addRecord("Chromosome_1", bioscripts::gff::Record::Type::mRNA, bioscripts::Range{ 120, 400 }, "ID=transcript:AT1G00010.2;Parent=gene:AT1G00010");
+		addRecord("Chromosome_1", bioscripts::gff::Record::Type::five_prime_UTR, bioscripts::Range{ 100, 150 }, "Parent=transcript:AT1G00010.1");
+		addRecord("Chromosome_1", bioscripts::gff::Record::Type::CDS, bioscripts::Range{ 150, 350 }, "ID=CDS:AT1G00010.1;Parent=transcript:AT1G00010.1;protein_id=AT1G00010.1");
+		addRecord("Chromosome_1", bioscripts::gff::Record::Type::exon, bioscripts::Range{ 150, 400 }, "Parent=transcript:AT1G00010.1,transcript:AT1G00010.2");
+		addRecord("Chromosome_1", bioscripts::gff::Record::Type::three_prime_UTR, bioscripts::Range{ 350, 400 }, "Parent=transcript:AT1G00010.1");
+		addRecord("Chromosome_2", bioscripts::gff::Record::Type::CDS, bioscripts::Range{ 10, 20 }, "ID=CDS:AT2G00010.1;Parent=transcript:AT2G00010.1");
+	}
+
+	void addRecord(const std::string& sequence_id, bioscripts::gff::Record::Type type, bioscripts::Range span, const std::string& attributes)
+	{
+		records.add(bioscripts::gff::Record{
+			.type = type,
+			.strand = bioscripts::Strand::Sense,
+			.span = span,
+			.sequence_id = sequence_id,
+			.attributes = attributes
+		});
+	}
+
+	bioscripts::gff::Records records;
+};
+
+TEST_F(HierarchyTest, parent_CodingSequence_LeadsToTranscriptAndGene)
+{
+	const bioscripts::gff::Hierarchy hierarchy{ records };
+	ASSERT_EQ(hierarchy.size(), 8);
+	const auto cds = hierarchy.node("Chromosome_1", 4);
+	ASSERT_TRUE(cds);
+	const auto transcript = hierarchy.parent(*cds);
+	ASSERT_NE(transcript, bioscripts::gff::Hierarchy::no_node);
+	EXPECT_EQ(hierarchy.record(transcript).type, bioscripts::gff::Record::Type::mRNA);
+	EXPECT_EQ(hierarchy.parent(transcript), *hierarchy.find("gene:AT1G00010"));
+	EXPECT_EQ(hierarchy.ancestor(*cds, bioscripts::gff::Record::Type::gene), *hierarchy.find("gene:AT1G00010"));
+	EXPECT_EQ(hierarchy.parent(*hierarchy.find("gene:AT1G00010")), bioscripts::gff::Hierarchy::no_node);
+}
+
+TEST_F(HierarchyTest, children_Transcript_ListsItsRecordsInOrder)
+{
+	const bioscripts::gff::Hierarchy hierarchy{ records };
+	const auto transcript = hierarchy.find("transcript:AT1G00010.1");
+	ASSERT_TRUE(transcript);
+	std::vector<bioscripts::gff::Record::Type> child_types;
+	for (const auto child : hierarchy.children(*transcript)) {
+		child_types.push_back(hierarchy.record(child).type);
+	}
+	EXPECT_EQ(child_types, (std::vector<bioscripts::gff::Record::Type>{
+		bioscripts::gff::Record::Type::five_prime_UTR,
+		bioscripts::gff::Record::Type::CDS,
+		bioscripts::gff::Record::Type::exon,
+		bioscripts::gff::Record::Type::three_prime_UTR
+	}));
+	EXPECT_EQ(hierarchy.children(*hierarchy.find("gene:AT1G00010")).size(), 2);
+}
+
+TEST_F(HierarchyTest, parents_RecordOfSeveralTranscripts_ListsAllOfThem)
+{
+	const bioscripts::gff::Hierarchy hierarchy{ records };
+	const auto exon = hierarchy.node("Chromosome_1", 5);
+	ASSERT_TRUE(exon);
+	const auto parents = hierarchy.parents(*exon);
+	ASSERT_EQ(parents.size(), 2);
+	EXPECT_EQ(parents[0], *hierarchy.find("transcript:AT1G00010.1"));
+	EXPECT_EQ(parents[1], *hierarchy.find("transcript:AT1G00010.2"));
+	EXPECT_EQ(hierarchy.children(*hierarchy.find("transcript:AT1G00010.2")).size(), 1);
+}
+
+TEST_F(HierarchyTest, parent_ParentNotLoaded_HasNoParent)
+{
+	const bioscripts::gff::Hierarchy hierarchy{ records };
+	const auto cds = hierarchy.node("Chromosome_2", 0);
+	ASSERT_TRUE(cds);
+	EXPECT_EQ(hierarchy.parent(*cds), bioscripts::gff::Hierarchy::no_node);
+	EXPECT_EQ(hierarchy.ancestor(*cds, bioscripts::gff::Record::Type::gene), bioscripts::gff::Hierarchy::no_node);
+	EXPECT_FALSE(hierarchy.node("Chromosome_2", 1));
+	EXPECT_FALSE(hierarchy.node("Chromosome_3", 0));
+}
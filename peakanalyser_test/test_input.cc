@@ -0,0 +1,172 @@
+#include "pch.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <zlib.h>
+
+#include "../PeakAnalyzer/input.h"
+
+namespace
+{
+	void appendLittleEndian(std::string& bytes, uint32_t value, std::size_t width)
+	{
+		for (std::size_t i = 0; i < width; ++i) {
+			bytes += static_cast<char>((value >> (8 * i)) & 0xff);
+		}
+	}
+
+	/**
+	 * @brief  @a text as a single BGZF block: a gzip member whose extra field holds the block size.
+	 */
+	std::string bgzfBlock(const std::string& text)
+	{
+		z_stream stream{};
+		deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+		std::string compressed(deflateBound(&stream, static_cast<uLong>(text.size())), '\0');
+		stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(text.data()));
+		stream.avail_in = static_cast<uInt>(text.size());
+		stream.next_out = reinterpret_cast<Bytef*>(compressed.data());
+		stream.avail_out = static_cast<uInt>(compressed.size());
+		deflate(&stream, Z_FINISH);
+		compressed.resize(compressed.size() - stream.avail_out);
+		deflateEnd(&stream);
+
+		std::string block{ "\x1f\x8b\x08\x04\0\0\0\0\0\xff\x06\0BC\x02\0", 16 };
+		appendLittleEndian(block, static_cast<uint32_t>(compressed.size() + 25), 2);
+		block += compressed;
+		appendLittleEndian(block, static_cast<uint32_t>(crc32(crc32(0L, Z_NULL, 0), reinterpret_cast<const Bytef*>(text.data()), static_cast<uInt>(text.size()))), 4);
+		appendLittleEndian(block, static_cast<uint32_t>(text.size()), 4);
+		return block;
+	}
+
+	std::vector<std::string> readAllLines(bioscripts::io::LineReader& reader)
+	{
+		std::vector<std::string> lines;
+		std::string line;
+		while (reader.getline(line)) {
+			lines.push_back(line);
+		}
+		return lines;
+	}
+}
+
+class LineReaderTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		//Enough lines for several blocks per batch of parallel inflating, with lines running across block boundaries
+		for (std::size_t i = 0; i < 2000; ++i) {
+			lines.push_back("Chromosome_1\tAraport11\tCDS\t" + std::to_string(i * 100) + "\t" + std::to_string(i * 100 + 50));
+		}
+		for (const auto& line : lines) {
+			text += line + "\n";
+		}
+		input_file = std::filesystem::temp_directory_path() / "test_input.txt";
+	}
+
+	void TearDown() override
+	{
+		std::filesystem::remove(input_file);
+	}
+
+	void writeInput(const std::string& bytes) const
+	{
+		std::ofstream{ input_file, std::ios::binary } << bytes;
+	}
+
+	/**
+	 * @brief  The text split into BGZF blocks of @a block_text_size bytes, followed by the empty end-of-file block.
+	 */
+	std::string bgzfText(std::size_t block_text_size) const
+	{
+		std::string bytes;
+		for (std::size_t start = 0; start < text.size(); start += block_text_size) {
+			bytes += bgzfBlock(text.substr(start, block_text_size));
+		}
+		return bytes + bgzfBlock("");
+	}
+
+	std::vector<std::string> lines;
+	std::string text;
+	std::filesystem::path input_file;
+};
+
+TEST_F(LineReaderTest, getline_PlainFile_ReadsAllLines)
+{
+	writeInput(text);
+	bioscripts::io::LineReader reader{ input_file };
+
+	EXPECT_EQ(reader.compression(), bioscripts::io::Compression::None);
+	EXPECT_EQ(readAllLines(reader), lines);
+}
+
+TEST_F(LineReaderTest, getline_GzipFile_ReadsAllLines)
+{
+	const auto file = gzopen(input_file.string().c_str(), "wb");
+	gzwrite(file, text.data(), static_cast<unsigned>(text.size()));
+	gzclose(file);
+	bioscripts::io::LineReader reader{ input_file };
+
+	EXPECT_EQ(reader.compression(), bioscripts::io::Compression::Gzip);
+	EXPECT_EQ(readAllLines(reader), lines);
+}
+
+TEST_F(LineReaderTest, getline_MultiBlockBgzfFile_ReadsAllLines)
+{
+	writeInput(bgzfText(1000));
+	bioscripts::io::LineReader reader{ input_file };
+
+	EXPECT_EQ(reader.compression(), bioscripts::io::Compression::Bgzf);
+	EXPECT_EQ(readAllLines(reader), lines);
+}
+
+TEST_F(LineReaderTest, seek_OffsetReturnedByTell_ContinuesWithTheSameLines)
+{
+	writeInput(bgzfText(1000));
+	std::vector<std::pair<bioscripts::io::VirtualOffset, std::string>> positions;
+	{
+		bioscripts::io::LineReader reader{ input_file };
+		std::string line;
+		for (auto offset = reader.tell(); reader.getline(line); offset = reader.tell()) {
+			positions.emplace_back(offset, line);
+		}
+	}
+
+	bioscripts::io::LineReader reader{ input_file };
+	for (const auto i : { std::size_t{ 1500 }, std::size_t{ 17 }, std::size_t{ 18 }, std::size_t{ 0 } }) {
+		ASSERT_TRUE(reader.seek(positions[i].first));
+		std::string line;
+		ASSERT_TRUE(reader.getline(line));
+		EXPECT_EQ(line, positions[i].second);
+		EXPECT_EQ(line, lines[i]);
+	}
+}
+
+TEST_F(LineReaderTest, getline_CorruptBgzfBlock_Throws)
+{
+	auto bytes = bgzfText(1000);
+	//The first bytes of the deflate data of the second block
+	const auto second_block = bgzfBlock(text.substr(0, 1000)).size();
+	bytes[second_block + 20] = static_cast<char>(~bytes[second_block + 20]);
+	bytes[second_block + 21] = static_cast<char>(~bytes[second_block + 21]);
+	writeInput(bytes);
+	bioscripts::io::LineReader reader{ input_file };
+
+	EXPECT_THROW(readAllLines(reader), std::runtime_error);
+}
+
+TEST_F(LineReaderTest, getline_TruncatedBgzfFile_Throws)
+{
+	const auto bytes = bgzfText(1000);
+	writeInput(bytes.substr(0, bytes.size() / 2));
+	bioscripts::io::LineReader reader{ input_file };
+
+	EXPECT_THROW(readAllLines(reader), std::runtime_error);
+}
@@ -0,0 +1,98 @@
+#include "pch.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "../PeakAnalyzer/interval_tree.h"
+
+
+TEST(TestIntervalTree, overlapping_EmptyTree_ReturnsNothing)
+{
+	bioscripts::IntervalTree tree;
+	EXPECT_TRUE(tree.overlapping(bioscripts::Range{ 0, 100 }).empty());
+}
+
+TEST(TestIntervalTree, overlapping_HalfOpenEnds_AreNotOverlapping)
+{
+	bioscripts::IntervalTree tree{ { { bioscripts::Range{ 10, 20 }, 0 }, { bioscripts::Range{ 20, 30 }, 1 } } };
+	EXPECT_EQ(tree.overlapping(bioscripts::Range{ 15, 20 }), (std::vector<std::size_t>{ 0 }));
+	EXPECT_EQ(tree.overlapping(bioscripts::Range{ 19, 21 }), (std::vector<std::size_t>{ 0, 1 }));
+	EXPECT_EQ(tree.overlapping(20), (std::vector<std::size_t>{ 1 }));
+	EXPECT_TRUE(tree.overlapping(bioscripts::Range{ 30, 40 }).empty());
+}
+
+TEST(TestIntervalTree, overlapping_UnsortedIntervals_ReturnsIdsOrderedByStart)
+{
+	bioscripts::IntervalTree tree{ { { bioscripts::Range{ 50, 60 }, 7 }, { bioscripts::Range{ 10, 100 }, 3 }, { bioscripts::Range{ 55, 56 }, 5 } } };
+	EXPECT_EQ(tree.overlapping(55), (std::vector<std::size_t>{ 3, 7, 5 }));
+}
+
+TEST(TestIntervalTree, overlapping_LongIntervalBeforeShortOnes_IsFound)
+{
+	std::vector<bioscripts::Interval> intervals{ { bioscripts::Range{ 0, 1000000 }, 0 } };
+	for (std::size_t i = 1; i < 1000; ++i) {
+		intervals.push_back({ bioscripts::Range{ i * 10, i * 10 + 5 }, i });
+	}
+	bioscripts::IntervalTree tree{ intervals };
+	EXPECT_EQ(tree.overlapping(bioscripts::Range{ 5006, 5009 }), (std::vector<std::size_t>{ 0 }));
+	EXPECT_EQ(tree.overlapping(bioscripts::Range{ 5004, 5011 }), (std::vector<std::size_t>{ 0, 500, 501 }));
+}
+
+TEST(TestIntervalTree, overlapping_AnyQuery_MatchesLinearScan)
+{
+	std::vector<bioscripts::Interval> intervals;
+	std::size_t state = 12345;
+	auto next = [&state](std::size_t bound) {
+		state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+		return (state >> 33) % bound;
+	};
+	for (std::size_t i = 0; i < 300; ++i) {
+		const auto start = next(10000);
+		intervals.push_back({ bioscripts::Range{ start, start + 1 + next(i % 10 == 0 ? 2000 : 50) }, i });
+	}
+	bioscripts::IntervalTree tree{ intervals };
+	auto sorted = intervals;
+	std::stable_sort(std::begin(sorted), std::end(sorted), [](const auto& first, const auto& second) {
+		return first.span.start < second.span.start;
+	});
+
+	for (std::size_t q = 0; q < 200; ++q) {
+		const auto start = next(11000);
+		const auto query = bioscripts::Range{ start, start + 1 + next(300) };
+		std::vector<std::size_t> expected;
+		for (const auto& interval : sorted) {
+			if (bioscripts::overlap(interval.span, query)) {
+				expected.push_back(interval.id);
+			}
+		}
+		EXPECT_EQ(tree.overlapping(query), expected);
+	}
+}
+
+TEST(TestIntervalTree, nearest_AnyPosition_MatchesDistancesOfLinearScan)
+{
+	std::vector<bioscripts::Interval> intervals;
+	for (std::size_t i = 0; i < 100; ++i) {
+		const auto start = (i * 7919) % 5000;
+		intervals.push_back({ bioscripts::Range{ start, start + 1 + (i * 31) % 90 }, i });
+	}
+	bioscripts::IntervalTree tree{ intervals };
+
+	for (bioscripts::Position position = 0; position < 5200; position += 37) {
+		std::vector<bioscripts::Distance> expected;
+		for (const auto& interval : intervals) {
+			const auto& span = interval.span;
+			expected.push_back(span.end <= position ? position - span.end + 1 : span.start > position ? span.start - position : 0);
+		}
+		std::sort(std::begin(expected), std::end(expected));
+
+		const auto neighbours = tree.nearest(position, 10, 300);
+		std::vector<bioscripts::Distance> found;
+		for (const auto& neighbour : neighbours) {
+			found.push_back(neighbour.distance);
+		}
+		expected.resize(10);
+		expected.erase(std::remove_if(std::begin(expected), std::end(expected), [](auto distance) { return distance > 300; }), std::end(expected));
+		EXPECT_EQ(found, expected);
+	}
+}
@@ -0,0 +1,58 @@
+#include "pch.h"
+
+#include <numeric>
+
+#include "../PeakAnalyzer/metagene.h"
+
+
+TEST(TestMetagene, bin_FractionsAcrossFeatures_CountIntoTheirBins)
+{
+	const std::vector<uint8_t> features = { 0, 1, 1, 2, 2, 1 };
+	const std::vector<double> fractions = { 0.05, 0.0, 0.99, 0.5, -1.0, 0.45 };
+	std::vector<uint64_t> counts(3 * 10);
+	bioscripts::metagene::bin(features, fractions, 10, counts);
+	EXPECT_EQ(counts[0], 1);
+	EXPECT_EQ(counts[10], 1);
+	EXPECT_EQ(counts[14], 1);
+	EXPECT_EQ(counts[19], 1);
+	EXPECT_EQ(counts[25], 1);
+	EXPECT_EQ(std::accumulate(std::begin(counts), std::end(counts), uint64_t{ 0 }), 5);
+}
+
+TEST(TestMetagene, bin_MoreFractionsThanOneBlock_CountsEveryOne)
+{
+	const std::vector<uint8_t> features(5000, 1);
+	std::vector<double> fractions(5000);
+	for (std::size_t i = 0; i < fractions.size(); ++i) {
+		fractions[i] = static_cast<double>(i % 100) / 100.0;
+	}
+	std::vector<uint64_t> counts(3 * 4);
+	bioscripts::metagene::bin(features, fractions, 4, counts);
+	EXPECT_EQ(counts[4], 1250);
+	EXPECT_EQ(counts[7], 1250);
+	EXPECT_EQ(std::accumulate(std::begin(counts), std::end(counts), uint64_t{ 0 }), 5000);
+}
+
+TEST(TestMetagene, fractionAlong_AntisenseUtr_CountsFromTheFivePrimeEnd)
+{
+	bioscripts::gff::Records records;
+	records.add(bioscripts::gff::Record{
+		.type = bioscripts::gff::Record::Type::mRNA,
+		.strand = bioscripts::Strand::Antisense,
+		.span = bioscripts::Range{ 100, 1000 },
+		.sequence_id = std::string{ "Chromosome_1" },
+		.attributes = "ID=transcript:AT1G00010.1"
+	});
+	records.add(bioscripts::gff::Record{
+		.type = bioscripts::gff::Record::Type::five_prime_UTR,
+		.strand = bioscripts::Strand::Antisense,
+		.span = bioscripts::Range{ 900, 1000 },
+		.sequence_id = std::string{ "Chromosome_1" },
+		.attributes = "Parent=transcript:AT1G00010.1"
+	});
+	const bioscripts::metagene::FeatureMaps maps{ records, bioscripts::gff::Hierarchy{ records } };
+	EXPECT_DOUBLE_EQ(maps.fractionAlong(bioscripts::context::Feature::FivePrimeUTR, "AT1G00010.1", 999), 0.005);
+	EXPECT_DOUBLE_EQ(maps.fractionAlong(bioscripts::context::Feature::FivePrimeUTR, "AT1G00010.1", 900), 0.995);
+	EXPECT_LT(maps.fractionAlong(bioscripts::context::Feature::CDS, "AT1G00010.1", 950), 0);
+	EXPECT_LT(maps.fractionAlong(bioscripts::context::Feature::FivePrimeUTR, "AT1G00010.1", 1000), 0);
+}
@@ -0,0 +1,83 @@
+#include "pch.h"
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "../PeakAnalyzer/normalized.h"
+
+namespace
+{
+	bioscripts::annotation::CodingSequence makeTranscript(const std::string& transcript_id, const std::vector<bioscripts::Range>& spans)
+	{
+		bioscripts::annotation::CodingSequence transcript;
+		for (const auto& span : spans) {
+			transcript.push_back(bioscripts::annotation::CodingSegment{ .transcript_id = transcript_id, .span = span });
+		}
+		return transcript;
+	}
+
+	void expectSameRows(const std::vector<bioscripts::annotation::TranscriptData>& actual, const std::vector<bioscripts::annotation::TranscriptData>& expected)
+	{
+		ASSERT_EQ(actual.size(), expected.size());
+		for (std::size_t i = 0; i < expected.size(); ++i) {
+			EXPECT_EQ(actual[i].id, expected[i].id);
+			EXPECT_EQ(actual[i].start_pos, expected[i].start_pos);
+			EXPECT_EQ(actual[i].end_pos, expected[i].end_pos);
+			EXPECT_EQ(actual[i].transcript_id, expected[i].transcript_id);
+		}
+	}
+}
+
+class NormalizedTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		const auto first = makeTranscript("AT1G00010.1", { bioscripts::Range{ 100, 200 }, bioscripts::Range{ 300, 400 } });
+		const auto second = makeTranscript("AT1G00020.1", { bioscripts::Range{ 1200, 1300 } });
+		annotations = { { first }, {}, { first, second }, { second } };
+
+		const auto output_file = std::filesystem::temp_directory_path() / "test_normalized_transcript_data.txt";
+		transcripts_file = bioscripts::normalized::transcriptsPath(output_file);
+		references_file = bioscripts::normalized::referencesPath(output_file);
+	}
+
+	void TearDown() override
+	{
+		std::filesystem::remove(transcripts_file);
+		std::filesystem::remove(references_file);
+	}
+
+	std::vector<bioscripts::annotation::PeakAnnotation> annotations;
+	std::filesystem::path transcripts_file;
+	std::filesystem::path references_file;
+};
+
+TEST_F(NormalizedTest, normalize_TranscriptHitByTwoPeaks_StoredOnce)
+{
+	const auto normalized = bioscripts::normalized::normalize(annotations);
+
+	EXPECT_EQ(normalized.transcripts.size(), 2);
+	EXPECT_EQ(normalized.references.size(), 4);
+}
+
+TEST_F(NormalizedTest, expand_WrittenAndReadBack_EqualsFlattenedRows)
+{
+	ASSERT_TRUE(bioscripts::normalized::write(transcripts_file, references_file, bioscripts::normalized::normalize(annotations)));
+
+	const auto normalized = bioscripts::normalized::read(transcripts_file, references_file);
+	ASSERT_TRUE(normalized.has_value());
+	const auto rows = bioscripts::normalized::expand(*normalized);
+	ASSERT_TRUE(rows.has_value());
+
+	expectSameRows(*rows, bioscripts::annotation::flatten(annotations));
+}
+
+TEST_F(NormalizedTest, expand_ReferenceToMissingTranscript_ReturnsEmptyOptional)
+{
+	auto normalized = bioscripts::normalized::normalize(annotations);
+	normalized.references.push_back(bioscripts::normalized::TranscriptReference{ .peak_id = 5, .transcript_number = 2 });
+
+	EXPECT_FALSE(bioscripts::normalized::expand(normalized).has_value());
+}
@@ -0,0 +1,75 @@
+#include "pch.h"
+
+#include <vector>
+
+#include "../PeakAnalyzer/peak_merge.h"
+
+namespace
+{
+	bioscripts::peak::Peak makePeak(const std::string& sequence_id, bioscripts::Range span, bioscripts::Strand strand, const std::string& gene)
+	{
+		return bioscripts::peak::Peak{ .span = span, .strand = strand, .associated_identifier = gene, .sequence_id = sequence_id };
+	}
+
+	std::vector<bioscripts::Range> spans(const bioscripts::peak::Peaks& peaks)
+	{
+		std::vector<bioscripts::Range> peak_spans;
+		for (const auto& peak : peaks) {
+			peak_spans.push_back(peak.span);
+		}
+		return peak_spans;
+	}
+}
+
+TEST(TestPeakMerge, merge_OverlappingReplicatePeaks_MergedIntoOne)
+{
+	std::vector<bioscripts::peak::Peaks> replicates(2);
+	replicates[0].add(makePeak("1", bioscripts::Range{ 100, 200 }, bioscripts::Strand::Sense, "AT1G00010"));
+	replicates[0].add(makePeak("1", bioscripts::Range{ 500, 600 }, bioscripts::Strand::Sense, "AT1G00010"));
+	replicates[1].add(makePeak("1", bioscripts::Range{ 150, 250 }, bioscripts::Strand::Sense, "AT1G00010"));
+
+	const auto merged = bioscripts::peak::merge(replicates);
+	EXPECT_EQ(spans(merged), (std::vector<bioscripts::Range>{ bioscripts::Range{ 100, 250 }, bioscripts::Range{ 500, 600 } }));
+}
+
+TEST(TestPeakMerge, merge_PeaksWithinGap_MergedAcrossIt)
+{
+	std::vector<bioscripts::peak::Peaks> replicates(1);
+	replicates[0].add(makePeak("1", bioscripts::Range{ 300, 400 }, bioscripts::Strand::Sense, "AT1G00010"));
+	replicates[0].add(makePeak("1", bioscripts::Range{ 100, 200 }, bioscripts::Strand::Sense, "AT1G00010"));
+	replicates[0].add(makePeak("1", bioscripts::Range{ 450, 500 }, bioscripts::Strand::Sense, "AT1G00010"));
+
+	EXPECT_EQ(spans(bioscripts::peak::merge(replicates, 50)), (std::vector<bioscripts::Range>{ bioscripts::Range{ 100, 200 }, bioscripts::Range{ 300, 500 } }));
+	EXPECT_EQ(spans(bioscripts::peak::merge(replicates, 100)), (std::vector<bioscripts::Range>{ bioscripts::Range{ 100, 500 } }));
+}
+
+TEST(TestPeakMerge, merge_OtherStrandOrGene_KeptApart)
+{
+	std::vector<bioscripts::peak::Peaks> replicates(1);
+	replicates[0].add(makePeak("1", bioscripts::Range{ 100, 200 }, bioscripts::Strand::Sense, "AT1G00010"));
+	replicates[0].add(makePeak("1", bioscripts::Range{ 120, 220 }, bioscripts::Strand::Antisense, "AT1G00010"));
+	replicates[0].add(makePeak("1", bioscripts::Range{ 140, 240 }, bioscripts::Strand::Sense, "AT1G00020"));
+	//Interleaved with the peaks above, but still merged with the first one
+	replicates[0].add(makePeak("1", bioscripts::Range{ 190, 300 }, bioscripts::Strand::Sense, "AT1G00010"));
+
+	const auto merged = bioscripts::peak::merge(replicates);
+	ASSERT_EQ(merged.size(), 3);
+	EXPECT_EQ(spans(merged), (std::vector<bioscripts::Range>{ bioscripts::Range{ 100, 300 }, bioscripts::Range{ 120, 220 }, bioscripts::Range{ 140, 240 } }));
+	EXPECT_EQ(std::begin(merged)->associated_identifier.gene(), "AT1G00010");
+}
+
+TEST(TestPeakMerge, merge_SeveralSequences_OrderedBySequence)
+{
+	std::vector<bioscripts::peak::Peaks> replicates(2);
+	replicates[0].add(makePeak("2", bioscripts::Range{ 100, 200 }, bioscripts::Strand::Sense, "AT2G00010"));
+	replicates[1].add(makePeak("1", bioscripts::Range{ 100, 200 }, bioscripts::Strand::Sense, "AT1G00010"));
+	replicates[1].add(makePeak("2", bioscripts::Range{ 150, 160 }, bioscripts::Strand::Sense, "AT2G00010"));
+
+	const auto merged = bioscripts::peak::merge(replicates);
+	std::vector<std::string> sequence_ids;
+	for (const auto& peak : merged) {
+		sequence_ids.push_back(peak.sequence_id);
+	}
+	EXPECT_EQ(sequence_ids, (std::vector<std::string>{ "1", "2" }));
+	EXPECT_EQ(spans(merged), (std::vector<bioscripts::Range>{ bioscripts::Range{ 100, 200 }, bioscripts::Range{ 100, 200 } }));
+}
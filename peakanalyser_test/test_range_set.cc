@@ -0,0 +1,84 @@
+#include "pch.h"
+
+#include <array>
+#include <iterator>
+#include <vector>
+
+#include "../PeakAnalyzer/range_set.h"
+
+using bioscripts::Range;
+
+namespace
+{
+	constexpr std::array<Range, 4> overlapping = { Range{ 10, 20 }, Range{ 15, 30 }, Range{ 30, 35 }, Range{ 50, 60 } };
+
+	constexpr std::size_t unitedCount()
+	{
+		std::vector<Range> united;
+		bioscripts::unite(overlapping, std::back_inserter(united));
+		return united.size();
+	}
+
+	static_assert(bioscripts::coverage(overlapping) == 35);
+	static_assert(unitedCount() == 2);
+}
+
+TEST(TestRangeSet, unite_OverlappingAndAbuttingRanges_AreMerged)
+{
+	std::vector<Range> united;
+	bioscripts::unite(overlapping, std::back_inserter(united));
+	EXPECT_EQ(united, (std::vector<Range>{ Range{ 10, 35 }, Range{ 50, 60 } }));
+}
+
+TEST(TestRangeSet, unite_TwoInputs_InterleavedIntoOneSet)
+{
+	const std::vector<Range> first = { Range{ 0, 10 }, Range{ 40, 50 } };
+	const std::vector<Range> second = { Range{ 5, 20 }, Range{ 25, 30 }, Range{ 45, 60 } };
+	std::vector<Range> united;
+	bioscripts::unite(first, second, std::back_inserter(united));
+	EXPECT_EQ(united, (std::vector<Range>{ Range{ 0, 20 }, Range{ 25, 30 }, Range{ 40, 60 } }));
+}
+
+TEST(TestRangeSet, intersect_PartlyOverlappingSets_KeepCommonPositions)
+{
+	const std::vector<Range> first = { Range{ 0, 10 }, Range{ 20, 40 } };
+	const std::vector<Range> second = { Range{ 5, 25 }, Range{ 30, 35 }, Range{ 38, 50 } };
+	std::vector<Range> common;
+	bioscripts::intersect(first, second, std::back_inserter(common));
+	EXPECT_EQ(common, (std::vector<Range>{ Range{ 5, 10 }, Range{ 20, 25 }, Range{ 30, 35 }, Range{ 38, 40 } }));
+}
+
+TEST(TestRangeSet, subtract_RemovedRangesInsideAndAcross_LeaveTheRest)
+{
+	const std::vector<Range> ranges = { Range{ 0, 10 }, Range{ 20, 40 }, Range{ 50, 60 } };
+	const std::vector<Range> removed = { Range{ 2, 4 }, Range{ 8, 25 }, Range{ 30, 32 }, Range{ 50, 60 } };
+	std::vector<Range> remaining;
+	bioscripts::subtract(ranges, removed, std::back_inserter(remaining));
+	EXPECT_EQ(remaining, (std::vector<Range>{ Range{ 0, 2 }, Range{ 4, 8 }, Range{ 25, 30 }, Range{ 32, 40 } }));
+}
+
+TEST(TestRangeSet, complement_WithinBounds_ReturnsUncoveredPositions)
+{
+	std::vector<Range> uncovered;
+	bioscripts::complement(overlapping, Range{ 1, 56 }, std::back_inserter(uncovered));
+	EXPECT_EQ(uncovered, (std::vector<Range>{ Range{ 1, 10 }, Range{ 35, 50 } }));
+
+	uncovered.clear();
+	bioscripts::complement(std::span<const Range>{}, Range{ 1, 56 }, std::back_inserter(uncovered));
+	EXPECT_EQ(uncovered, (std::vector<Range>{ Range{ 1, 56 } }));
+}
+
+TEST(TestRangeSet, gaps_ExonsOfTranscript_ReturnIntrons)
+{
+	const std::vector<Range> exons = { Range{ 100, 200 }, Range{ 150, 220 }, Range{ 220, 250 }, Range{ 300, 400 } };
+	std::vector<Range> introns;
+	bioscripts::gaps(exons, std::back_inserter(introns));
+	EXPECT_EQ(introns, (std::vector<Range>{ Range{ 250, 300 } }));
+}
+
+TEST(TestRangeSet, coverage_NestedRanges_CountedOnce)
+{
+	const std::vector<Range> ranges = { Range{ 0, 100 }, Range{ 10, 20 }, Range{ 50, 150 }, Range{ 200, 201 } };
+	EXPECT_EQ(bioscripts::coverage(ranges), 151);
+	EXPECT_EQ(bioscripts::coverage(std::span<const Range>{}), 0);
+}
@@ -0,0 +1,98 @@
+#include "pch.h"
+
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../PeakAnalyzer/record_image.h"
+
+class RecordImageTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		gff_file = std::filesystem::temp_directory_path() / "test_record_image.gff3";
+		image_file = std::filesystem::temp_directory_path() / "test_record_image.img";
+		std::ofstream{ gff_file } << "##gff-version 3\n";
+
+		records.add(bioscripts::gff::Record{
+			.type = bioscripts::gff::Record::Type::CDS,
+			.strand = bioscripts::Strand::Sense,
+			.span = bioscripts::Range{ 100, 200 },
+			.sequence_id = std::string{ "Chromosome_1" },
+			.attributes = "ID=CDS:AT1G00010.1;Parent=transcript:AT1G00010.1"
+		});
+		records.add(bioscripts::gff::Record{
+			.type = bioscripts::gff::Record::Type::CDS,
+			.strand = bioscripts::Strand::Sense,
+			.span = bioscripts::Range{ 300, 400 },
+			.sequence_id = std::string{ "Chromosome_1" },
+			.attributes = "ID=CDS:AT1G00010.1;Parent=transcript:AT1G00010.1"
+		});
+		ASSERT_TRUE(bioscripts::gff::RecordImage::publish(records, image_file, gff_file));
+	}
+
+	void TearDown() override
+	{
+		std::filesystem::remove(gff_file);
+		std::filesystem::remove(image_file);
+	}
+
+	/**
+	 * @brief  Overwrite the 8 bytes at @a position of the image with @a value.
+	 */
+	void patchImage(std::streamoff position, uint64_t value) const
+	{
+		std::fstream f{ image_file, std::ios::binary | std::ios::in | std::ios::out };
+		f.seekp(position);
+		f.write(reinterpret_cast<const char*>(&value), sizeof(value));
+	}
+
+	/**
+	 * @brief  Offset of the first entry, read from the image header after its magic, byte order, sequence count,
+	 *		   source size, source modification time and sequence table offset.
+	 */
+	uint64_t entriesOffset() const
+	{
+		uint64_t entries_offset = 0;
+		std::ifstream f{ image_file, std::ios::binary };
+		f.seekg(40);
+		f.read(reinterpret_cast<char*>(&entries_offset), sizeof(entries_offset));
+		return entries_offset;
+	}
+
+	bioscripts::gff::Records records;
+	std::filesystem::path gff_file;
+	std::filesystem::path image_file;
+};
+
+TEST_F(RecordImageTest, attach_PublishedImage_RecordsReadBack)
+{
+	const auto image = bioscripts::gff::RecordImage::attach(image_file, gff_file);
+	ASSERT_TRUE(image.has_value());
+
+	const auto entries = image->recordsOn("Chromosome_1");
+	ASSERT_EQ(entries.size(), 2);
+	EXPECT_EQ(entries[0].span(), (bioscripts::Range{ 100, 200 }));
+	EXPECT_EQ(entries[1].span(), (bioscripts::Range{ 300, 400 }));
+	EXPECT_EQ(image->transcriptId(entries[1]), "AT1G00010.1");
+}
+
+TEST_F(RecordImageTest, attach_TranscriptIdPastEndOfImage_ReturnsEmptyOptional)
+{
+	const auto file_size = std::filesystem::file_size(image_file);
+	patchImage(static_cast<std::streamoff>(entriesOffset() + offsetof(bioscripts::gff::RecordImage::Entry, transcript_id_offset)), file_size - 2);
+
+	EXPECT_FALSE(bioscripts::gff::RecordImage::attach(image_file, gff_file).has_value());
+}
+
+#ifndef _WIN32
+TEST_F(RecordImageTest, attach_ImageWritableByOthers_ReturnsEmptyOptional)
+{
+	std::filesystem::permissions(image_file, std::filesystem::perms::group_write | std::filesystem::perms::others_write, std::filesystem::perm_options::add);
+
+	EXPECT_FALSE(bioscripts::gff::RecordImage::attach(image_file, gff_file).has_value());
+}
+#endif
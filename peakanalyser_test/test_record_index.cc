@@ -0,0 +1,83 @@
+#include "pch.h"
+
+#include "../PeakAnalyzer/record_index.h"
+
+
+class RecordIndexTest : public ::testing::Test
+{
+protected:
+	void SetUp()
+	{
+		addRecord(bioscripts::gff::Record::Type::CDS, bioscripts::Range{ 100, 200 });
+		addRecord(bioscripts::gff::Record::Type::CDS, bioscripts::Range{ 300, 400 });
+		addRecord(bioscripts::gff::Record::Type::CDS, bioscripts::Range{ 150, 160 });
+		addRecord(bioscripts::gff::Record::Type::CDS, bioscripts::Range{ 1000, 1100 });
+		addRecord(bioscripts::gff::Record::Type::gene, bioscripts::Range{ 0, 2000 });
+	}
+
+	void addRecord(bioscripts::gff::Record::Type type, bioscripts::Range span)
+	{
+		records.add(bioscripts::gff::Record{
+			.type = type,
+			.strand = bioscripts::Strand::Sense,
+			.span = span,
+			.sequence_id = std::string{ "Chromosome_1" },
+			.attributes = "ID=CDS:ATMG00180.1;Parent=transcript:ATMG00180.1;protein_id=ATMG00180.1"
+		});
+	}
+
+	bioscripts::gff::Records records;
+};
+
+TEST_F(RecordIndexTest, nearest_PositionInsideRecords_ReturnsThemAtDistanceZeroFirst)
+{
+	const bioscripts::gff::RecordIndex index{ records };
+	const auto neighbours = index.nearest("Chromosome_1", 155, 3, 1000, bioscripts::gff::Record::Type::CDS);
+	ASSERT_EQ(neighbours.size(), 3);
+	EXPECT_EQ(neighbours[0].record->span, (bioscripts::Range{ 100, 200 }));
+	EXPECT_EQ(neighbours[0].distance, 0);
+	EXPECT_EQ(neighbours[1].record->span, (bioscripts::Range{ 150, 160 }));
+	EXPECT_EQ(neighbours[1].distance, 0);
+	EXPECT_EQ(neighbours[2].record->span, (bioscripts::Range{ 300, 400 }));
+	EXPECT_EQ(neighbours[2].distance, 145);
+}
+
+TEST_F(RecordIndexTest, nearest_PositionBetweenRecords_ExpandsToBothSidesByDistance)
+{
+	const bioscripts::gff::RecordIndex index{ records };
+	const auto neighbours = index.nearest("Chromosome_1", 260, 10, 1000, bioscripts::gff::Record::Type::CDS);
+	ASSERT_EQ(neighbours.size(), 4);
+	EXPECT_EQ(neighbours[0].record->span, (bioscripts::Range{ 300, 400 }));
+	EXPECT_EQ(neighbours[0].distance, 40);
+	EXPECT_EQ(neighbours[1].record->span, (bioscripts::Range{ 100, 200 }));
+	EXPECT_EQ(neighbours[1].distance, 61);
+	EXPECT_EQ(neighbours[2].record->span, (bioscripts::Range{ 150, 160 }));
+	EXPECT_EQ(neighbours[3].record->span, (bioscripts::Range{ 1000, 1100 }));
+}
+
+TEST_F(RecordIndexTest, nearest_RecordsBeyondMaximumDistance_AreLeftOut)
+{
+	const bioscripts::gff::RecordIndex index{ records };
+	const auto neighbours = index.nearest("Chromosome_1", 260, 10, 50, bioscripts::gff::Record::Type::CDS);
+	ASSERT_EQ(neighbours.size(), 1);
+	EXPECT_EQ(neighbours[0].record->span, (bioscripts::Range{ 300, 400 }));
+}
+
+TEST_F(RecordIndexTest, nearest_OtherTypeOrSequence_ReturnsNothing)
+{
+	const bioscripts::gff::RecordIndex index{ records };
+	EXPECT_TRUE(index.nearest("Chromosome_1", 5000, 1, 1000, bioscripts::gff::Record::Type::mRNA).empty());
+	EXPECT_TRUE(index.nearest("Chromosome_2", 150, 1, 1000, bioscripts::gff::Record::Type::CDS).empty());
+	EXPECT_EQ(index.nearest("Chromosome_1", 5000, 1, 10000, bioscripts::gff::Record::Type::gene).size(), 1);
+}
+
+TEST_F(RecordIndexTest, within_Window_ReturnsRecordsReachingIntoIt)
+{
+	const bioscripts::gff::RecordIndex index{ records };
+	const auto found_records = index.within("Chromosome_1", 250, 51, bioscripts::gff::Record::Type::CDS);
+	ASSERT_EQ(found_records.size(), 2);
+	EXPECT_EQ(found_records[0]->span, (bioscripts::Range{ 100, 200 }));
+	EXPECT_EQ(found_records[1]->span, (bioscripts::Range{ 300, 400 }));
+	EXPECT_EQ(index.within("Chromosome_1", 250, 50, bioscripts::gff::Record::Type::CDS).size(), 1);
+	EXPECT_EQ(index.within("Chromosome_1", 10, 20, bioscripts::gff::Record::Type::CDS).size(), 0);
+}
@@ -0,0 +1,44 @@
+#include "pch.h"
+
+#include "../PeakAnalyzer/region.h"
+
+
+TEST(TestRegion, parseRegion_StartAndEnd_ReturnsInclusiveSpan)
+{
+	auto region = bioscripts::parseRegion("4:9449114-9450906");
+	ASSERT_TRUE(region.has_value());
+	EXPECT_EQ(region->sequence_id, "4");
+	EXPECT_EQ(region->span, (bioscripts::Range{ 9449114, 9450907 }));
+}
+
+TEST(TestRegion, parseRegion_ThousandsSeparators_AreIgnored)
+{
+	auto region = bioscripts::parseRegion("Chr1:1,000-2,000");
+	ASSERT_TRUE(region.has_value());
+	EXPECT_EQ(region->sequence_id, "Chr1");
+	EXPECT_EQ(region->span, (bioscripts::Range{ 1000, 2001 }));
+}
+
+TEST(TestRegion, parseRegion_SequenceOnly_CoversWholeSequence)
+{
+	auto region = bioscripts::parseRegion("Mt");
+	ASSERT_TRUE(region.has_value());
+	EXPECT_EQ(region->sequence_id, "Mt");
+	EXPECT_TRUE(bioscripts::overlap(*region, "Mt", bioscripts::Range{ 0, 1 }));
+	EXPECT_TRUE(bioscripts::overlap(*region, "Mt", bioscripts::Range{ 366000, 367000 }));
+}
+
+TEST(TestRegion, parseRegion_MalformedRegion_ReturnsEmptyOptional)
+{
+	EXPECT_FALSE(bioscripts::parseRegion("").has_value());
+	EXPECT_FALSE(bioscripts::parseRegion("1:abc").has_value());
+	EXPECT_FALSE(bioscripts::parseRegion("1:200-100").has_value());
+	EXPECT_FALSE(bioscripts::parseRegion("1:-100").has_value());
+}
+
+TEST(TestRegion, overlap_SpanOnOtherSequence_ReturnsFalse)
+{
+	auto region = bioscripts::Region{ .sequence_id = "1", .span = bioscripts::Range{ 100, 200 } };
+	EXPECT_FALSE(bioscripts::overlap(region, "2", bioscripts::Range{ 150, 160 }));
+	EXPECT_TRUE(bioscripts::overlap(region, "1", bioscripts::Range{ 150, 160 }));
+}
@@ -0,0 +1,113 @@
+#include "pch.h"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../PeakAnalyzer/results_cache.h"
+
+namespace
+{
+	bioscripts::peak::Peak makePeak(bioscripts::Range span, const std::string& gene)
+	{
+		return bioscripts::peak::Peak{ .span = span, .strand = bioscripts::Strand::Sense, .associated_identifier = gene, .sequence_id = "Chromosome_1" };
+	}
+
+	bioscripts::annotation::PeakAnnotation makeAnnotation(const std::string& transcript_id, const std::vector<bioscripts::Range>& spans)
+	{
+		bioscripts::annotation::CodingSequence transcript;
+		for (const auto& span : spans) {
+			transcript.push_back(bioscripts::annotation::CodingSegment{ .transcript_id = transcript_id, .span = span });
+		}
+		return { transcript };
+	}
+}
+
+class ResultsCacheTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		gff_file = std::filesystem::temp_directory_path() / "test_results_cache.gff3";
+		cache_file = bioscripts::cache::cachePath(std::filesystem::temp_directory_path() / "test_results_cache_transcript_data.txt");
+		std::ofstream{ gff_file } << "##gff-version 3\n";
+		fingerprint = *bioscripts::cache::annotationFingerprint(gff_file);
+
+		bioscripts::cache::ResultsCache cache{ fingerprint };
+		cache.insert(makePeak(bioscripts::Range{ 100, 121 }, "AT1G00010"), makeAnnotation("AT1G00010.1", { bioscripts::Range{ 100, 200 }, bioscripts::Range{ 300, 400 } }));
+		cache.insert(makePeak(bioscripts::Range{ 5000, 5021 }, "AT1G00020"), {});
+		ASSERT_TRUE(cache.save(cache_file));
+	}
+
+	void TearDown() override
+	{
+		std::filesystem::remove(gff_file);
+		std::filesystem::remove(cache_file);
+		std::filesystem::remove(partialFile());
+	}
+
+	std::filesystem::path partialFile() const
+	{
+		auto partial_file = cache_file;
+		partial_file += ".partial";
+		return partial_file;
+	}
+
+	std::filesystem::path gff_file;
+	std::filesystem::path cache_file;
+	std::string fingerprint;
+};
+
+TEST_F(ResultsCacheTest, load_SameFingerprintAndSettings_FindsSavedAnnotations)
+{
+	const auto cache = bioscripts::cache::ResultsCache::load(cache_file, fingerprint);
+
+	EXPECT_EQ(cache.size(), 2);
+	const auto cached = cache.find(makePeak(bioscripts::Range{ 100, 121 }, "AT1G00010"));
+	ASSERT_NE(cached, nullptr);
+	EXPECT_EQ(cached->size(), 1);
+	ASSERT_EQ(cached->front().size(), 2);
+	EXPECT_EQ(cached->front()[1].transcript_id, "AT1G00010.1");
+	EXPECT_EQ(cached->front()[1].span, (bioscripts::Range{ 300, 400 }));
+	const auto without_transcripts = cache.find(makePeak(bioscripts::Range{ 5000, 5021 }, "AT1G00020"));
+	ASSERT_NE(without_transcripts, nullptr);
+	EXPECT_TRUE(without_transcripts->empty());
+}
+
+TEST_F(ResultsCacheTest, load_ChangedGffFile_ReturnsEmptyCache)
+{
+	std::ofstream{ gff_file, std::ios::app } << "Chromosome_1\tAraport11\tgene\t100\t200\t.\t+\t.\tID=gene:AT1G00010\n";
+	const auto changed_fingerprint = bioscripts::cache::annotationFingerprint(gff_file);
+	ASSERT_TRUE(changed_fingerprint.has_value());
+	ASSERT_NE(*changed_fingerprint, fingerprint);
+
+	EXPECT_EQ(bioscripts::cache::ResultsCache::load(cache_file, *changed_fingerprint).size(), 0);
+}
+
+TEST_F(ResultsCacheTest, load_ChangedSettings_ReturnsEmptyCache)
+{
+	bioscripts::annotation::Settings settings;
+	settings.query = bioscripts::annotation::Query::Span;
+
+	EXPECT_EQ(bioscripts::cache::ResultsCache::load(cache_file, fingerprint, settings).size(), 0);
+}
+
+TEST_F(ResultsCacheTest, find_PeakWithOtherMidpointOrGene_Misses)
+{
+	const auto cache = bioscripts::cache::ResultsCache::load(cache_file, fingerprint);
+
+	EXPECT_EQ(cache.find(makePeak(bioscripts::Range{ 102, 123 }, "AT1G00010")), nullptr);
+	EXPECT_EQ(cache.find(makePeak(bioscripts::Range{ 100, 121 }, "AT1G00030")), nullptr);
+	//Only the midpoint matters when matching midpoints
+	EXPECT_NE(cache.find(makePeak(bioscripts::Range{ 90, 131 }, "AT1G00010")), nullptr);
+}
+
+TEST_F(ResultsCacheTest, load_TruncatedPartialFileLeftBehind_IsIgnored)
+{
+	const auto cache_size = std::filesystem::file_size(cache_file);
+	std::filesystem::copy_file(cache_file, partialFile());
+	std::filesystem::resize_file(partialFile(), cache_size / 2);
+
+	EXPECT_EQ(bioscripts::cache::ResultsCache::load(cache_file, fingerprint).size(), 2);
+}
@@ -0,0 +1,72 @@
+#include "pch.h"
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+
+#include "../PeakAnalyzer/server.h"
+
+namespace
+{
+	const std::string peak_table_header = "c0\tc1\tc2\tc3\tc4\tc5\tc6\tc7\tc8\tc9\tc10\tc11\tc12\tc13\tc14\tc15\tc16\tc17\tc18\tc19\tc20\n";
+
+	/**
+	 * @brief  A row of a peak file on sequence 1 for the given gene, with all columns the analysis ignores set to "x".
+	 */
+	std::string peakRow(std::size_t start, std::size_t end, const std::string& gene)
+	{
+		return "0\t1\t" + std::to_string(start) + "\t" + std::to_string(end) + "\tx\tx\tx\tx\tx\tx\tx\t" + gene + "\tx\tx\t+\tx\tx\tx\tx\tx\tx\n";
+	}
+}
+
+class ServerTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		for (const auto span : { bioscripts::Range{ 100, 200 }, bioscripts::Range{ 300, 400 } }) {
+			records.add(bioscripts::gff::Record{
+				.type = bioscripts::gff::Record::Type::CDS,
+				.strand = bioscripts::Strand::Sense,
+				.span = span,
+				.sequence_id = std::string{ "1" },
+				.attributes = "ID=CDS:AT1G00010.1;Parent=transcript:AT1G00010.1"
+			});
+		}
+		index = std::make_unique<bioscripts::annotation::RecordsIndex>(records);
+	}
+
+	bioscripts::gff::Records records;
+	std::unique_ptr<bioscripts::annotation::RecordsIndex> index;
+};
+
+TEST_F(ServerTest, answer_InlinePeaks_RepliesWithTranscriptRows)
+{
+	const auto reply = bioscripts::server::answer(bioscripts::server::inlinePeaksRequest(peak_table_header + peakRow(150, 160, "AT1G00010")), *index);
+
+	EXPECT_EQ(reply, "OK 2\n0\tAT1G00010.1\t100\t200\n0\tAT1G00010.1\t300\t400\n");
+}
+
+TEST_F(ServerTest, answer_PeakFile_RepliesWithTheSameRowsAsInline)
+{
+	const auto peaks_file = std::filesystem::temp_directory_path() / "test_server_peaks.txt";
+	std::ofstream{ peaks_file } << peak_table_header << peakRow(150, 160, "AT1G00010");
+
+	const auto reply = bioscripts::server::answer(bioscripts::server::peakFileRequest(peaks_file), *index);
+	std::filesystem::remove(peaks_file);
+
+	EXPECT_EQ(reply, bioscripts::server::answer(bioscripts::server::inlinePeaksRequest(peak_table_header + peakRow(150, 160, "AT1G00010")), *index));
+}
+
+TEST_F(ServerTest, answer_MissingPeakFile_RepliesWithError)
+{
+	const auto reply = bioscripts::server::answer(bioscripts::server::peakFileRequest(std::filesystem::temp_directory_path() / "test_server_missing.txt"), *index);
+
+	EXPECT_TRUE(reply.starts_with("ERROR Could not open"));
+}
+
+TEST_F(ServerTest, answer_UnknownRequest_RepliesWithError)
+{
+	EXPECT_EQ(bioscripts::server::answer("PEAKS\n", *index), "ERROR Unknown request\n");
+}
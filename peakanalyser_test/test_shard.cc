@@ -0,0 +1,133 @@
+#include "pch.h"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../PeakAnalyzer/shard.h"
+
+namespace
+{
+	bioscripts::annotation::CodingSequence makeTranscript(const std::string& transcript_id, const std::vector<bioscripts::Range>& spans)
+	{
+		bioscripts::annotation::CodingSequence transcript;
+		for (const auto& span : spans) {
+			transcript.push_back(bioscripts::annotation::CodingSegment{ .transcript_id = transcript_id, .span = span });
+		}
+		return transcript;
+	}
+
+	std::string readFile(const std::filesystem::path& file)
+	{
+		std::ifstream f{ file, std::ios::binary };
+		std::stringstream contents;
+		contents << f.rdbuf();
+		return contents.str();
+	}
+}
+
+class ShardTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		//Peaks spread unevenly over four sequences, some without transcripts and some with several
+		const std::vector<std::string> sequence_ids = { "Chromosome_1", "Chromosome_2", "Chromosome_3", "Mt" };
+		for (std::size_t i = 0; i < 40; ++i) {
+			const auto& sequence_id = sequence_ids[(i * i) % sequence_ids.size()];
+			peaks.add(bioscripts::peak::Peak{ .span = bioscripts::Range{ i * 100, i * 100 + 20 }, .strand = bioscripts::Strand::Sense, .associated_identifier = std::string{ "AT1G00010" }, .sequence_id = sequence_id });
+
+			bioscripts::annotation::PeakAnnotation annotation;
+			for (std::size_t t = 0; t < i % 3; ++t) {
+				const auto transcript_id = sequence_id + "_" + std::to_string(i) + "." + std::to_string(t + 1);
+				annotation.push_back(makeTranscript(transcript_id, { bioscripts::Range{ i * 100, i * 100 + 50 }, bioscripts::Range{ i * 100 + 80, i * 100 + 90 } }));
+			}
+			annotations.push_back(annotation);
+		}
+		output_file = std::filesystem::temp_directory_path() / "test_shard_transcript_data.txt";
+	}
+
+	void TearDown() override
+	{
+		std::filesystem::remove(output_file);
+		for (const auto& partial_file : partial_files) {
+			std::filesystem::remove(partial_file);
+		}
+	}
+
+	/**
+	 * @brief  Write the partial outputs of @a shard_count shards, each holding the annotations of the peaks on its sequences.
+	 */
+	void writePartials(std::size_t shard_count)
+	{
+		const auto shards = bioscripts::shard::assignSequences(peaks, shard_count);
+		for (std::size_t shard = 0; shard < shard_count; ++shard) {
+			bioscripts::shard::ShardAnnotations shard_annotations{ .shard = shard, .shard_count = shard_count, .total_peak_count = peaks.size(), .peak_indices = {}, .annotations = {} };
+			std::size_t peak_index = 0;
+			for (const auto& peak : peaks) {
+				if (shards[shard].contains(peak.sequence_id)) {
+					shard_annotations.peak_indices.push_back(peak_index);
+					shard_annotations.annotations.push_back(annotations[peak_index]);
+				}
+				++peak_index;
+			}
+			partial_files.push_back(bioscripts::shard::partialPath(output_file, shard, shard_count));
+			ASSERT_TRUE(bioscripts::shard::writePartial(partial_files.back(), shard_annotations));
+		}
+	}
+
+	bioscripts::peak::Peaks peaks;
+	std::vector<bioscripts::annotation::PeakAnnotation> annotations;
+	std::filesystem::path output_file;
+	std::vector<std::filesystem::path> partial_files;
+};
+
+TEST_F(ShardTest, assignSequences_ThreeShards_EverySequenceInExactlyOneShard)
+{
+	const auto shards = bioscripts::shard::assignSequences(peaks, 3);
+
+	ASSERT_EQ(shards.size(), 3);
+	for (const auto& sequence_id : bioscripts::peak::sequenceIds(peaks)) {
+		std::size_t holding_shards = 0;
+		for (const auto& shard : shards) {
+			holding_shards += shard.contains(sequence_id) ? 1 : 0;
+		}
+		EXPECT_EQ(holding_shards, 1);
+	}
+}
+
+TEST_F(ShardTest, merge_PartialsOfAllShards_EqualsSingleRun)
+{
+	writePartials(3);
+	std::ostringstream single_run;
+	bioscripts::annotation::write(single_run, bioscripts::annotation::flatten(annotations));
+
+	const auto rows_written = bioscripts::shard::merge({ partial_files[2], partial_files[0], partial_files[1] }, output_file);
+
+	ASSERT_TRUE(rows_written.has_value());
+	EXPECT_EQ(*rows_written, bioscripts::annotation::flatten(annotations).size());
+	EXPECT_EQ(readFile(output_file), single_run.str());
+}
+
+TEST_F(ShardTest, merge_MissingShard_ReturnsEmptyOptional)
+{
+	writePartials(3);
+
+	EXPECT_FALSE(bioscripts::shard::merge({ partial_files[0], partial_files[2] }, output_file).has_value());
+}
+
+TEST_F(ShardTest, merge_PartialsOfDifferentRuns_ReturnsEmptyOptional)
+{
+	writePartials(2);
+	writePartials(3);
+
+	EXPECT_FALSE(bioscripts::shard::merge({ partial_files[0], partial_files[3], partial_files[4] }, output_file).has_value());
+}
+
+TEST_F(ShardTest, runInProcesses_FailingShard_ReturnsOne)
+{
+	EXPECT_EQ(bioscripts::shard::runInProcesses(3, [](std::size_t) { return 0; }), 0);
+	EXPECT_EQ(bioscripts::shard::runInProcesses(3, [](std::size_t shard) { return shard == 1 ? 1 : 0; }), 1);
+}
@@ -0,0 +1,50 @@
+#include "pch.h"
+
+#include "../PeakAnalyzer/translation.h"
+
+using namespace bioscripts::translation;
+
+TEST(TestTranslation, translate_StandardCode_ReadsEveryCodon)
+{
+	EXPECT_EQ(translate("ATGTTTTGGAAATAA"), "MFWK*");
+}
+
+TEST(TestTranslation, translate_IncompleteLastCodon_IsDropped)
+{
+	EXPECT_EQ(translate("ATGGC"), "M");
+	EXPECT_EQ(translate("AT"), "");
+}
+
+TEST(TestTranslation, translate_LowercaseBases_AreTranslated)
+{
+	EXPECT_EQ(translate("atgGGcTaG"), "MG*");
+}
+
+TEST(TestTranslation, translate_CodonWithInvalidBase_IsX)
+{
+	EXPECT_EQ(translate("ATGNNNGCNTTT"), "MXXF");
+}
+
+TEST(TestTranslation, translateCodon_AllCodonsOfStandardCode_MatchTable)
+{
+	constexpr std::string_view bases = "TCAG";
+	constexpr std::string_view amino_acids = "FFLLSSSSYY**CC*WLLLLPPPPHHQQRRRRIIIMTTTTNNKKSSRRVVVVAAAADDEEGGGG";
+	for (std::size_t i = 0; i < 64; ++i) {
+		const std::string codon{ bases[i / 16], bases[i / 4 % 4], bases[i % 4] };
+		EXPECT_EQ(translateCodon(codon), amino_acids[i]) << codon;
+	}
+}
+
+TEST(TestTranslation, translate_PlastidCode_SameAsStandardInsideTheSequence)
+{
+	constexpr std::string_view bases = "TTGATGGTGTGAAGAATATAA";
+	EXPECT_EQ(translate(bases, GeneticCode::Plastid), translate(bases, GeneticCode::Standard));
+	EXPECT_EQ(translate(bases, GeneticCode::Plastid), "LMV*RI*");
+}
+
+TEST(TestTranslation, geneticCodeOf_OrganelleGenes_GetTheirCode)
+{
+	EXPECT_EQ(geneticCodeOf("ATCG00020.1"), GeneticCode::Plastid);
+	EXPECT_EQ(geneticCodeOf("ATMG00010.1"), GeneticCode::Standard);
+	EXPECT_EQ(geneticCodeOf("AT1G01010.1"), GeneticCode::Standard);
+}